@@ -0,0 +1,236 @@
+#ifndef BATTERY_DISPATCH_H
+#define BATTERY_DISPATCH_H
+
+#include <chrono>
+#include "community_graph.h"
+#include "thread_pool.h"
+using namespace std;
+
+// Battery dispatch over a planning horizon (normally 24 hourly steps).
+//
+// For each home, DP over quantized state of charge:
+//   level j = 0..L   <->   stored energy capacity * j / L  (Wh)
+//   best[t][j]       =  least grid import (Wh) from step t on, starting at
+//                       level j; among equal imports, the cheapest bill
+// A step may move from level j to any level j' the charge / discharge power
+// limits allow. The home's grid exchange in that step is
+//   consumption - production + chargeDraw - dischargeDelivered     (W)
+// and is billed at the step's import price (exports earn exportPrice).
+// By default the battery only charges from the home's own surplus: charging
+// from the grid always adds import (losses), so it is off unless
+// allowGridCharging is set. minimizeBill swaps the two goals (bill first,
+// import as tie-break) for price arbitrage with grid charging on.
+// O(T * L * reach) per home, with reach <= L + 1; homes are independent, so
+// the community is split over a ThreadPool.
+//
+// Each home's import is minimized on its own; energy moved between homes
+// within a step is left to sharing / dispatch.
+
+struct DispatchHorizon {
+    int steps;
+    float stepHours;
+    const float* importPrice;     // Rs per kWh, one per step
+    float exportPrice;            // Rs per kWh paid for energy fed back
+    bool keepFinalCharge;         // end with at least the starting charge
+    bool allowGridCharging;       // battery may charge on grid power, not just surplus
+    bool minimizeBill;            // bill first, import second (default: import first)
+
+    DispatchHorizon() : steps(24), stepHours(1.0f), importPrice(nullptr),
+                        exportPrice(0), keepFinalCharge(true), allowGridCharging(false),
+                        minimizeBill(false) {}
+};
+
+struct HomeBatteryPlan {
+    float startWh;
+    float importWhWithout;        // grid import if the battery sat idle
+    float importWh;               // grid import following the plan
+    float costWithout;            // Rs
+    float cost;                   // Rs
+    DynamicArray<float> batteryW; // per step: + charging, - discharging (at the battery)
+    DynamicArray<float> gridW;    // per step: + import, - export
+    DynamicArray<float> levelWh;  // stored energy at the end of each step
+
+    HomeBatteryPlan() : startWh(0), importWhWithout(0), importWh(0), costWithout(0), cost(0) {}
+};
+
+struct CommunityBatteryPlan {
+    DynamicArray<HomeBatteryPlan> homes;  // by dense home index
+    double importWhWithout;
+    double importWh;
+    double costWithout;
+    double cost;
+    double latencyMs;
+
+    CommunityBatteryPlan() : importWhWithout(0), importWh(0), costWithout(0), cost(0), latencyMs(0) {}
+};
+
+class BatteryDispatcher {
+public:
+    static const int DEFAULT_LEVELS = 48;
+
+    // Plans one home. production / consumption hold one average power (W)
+    // per step. levels = number of SoC steps (L).
+    static void planHome(const BatterySpec& spec, float startWh,
+                         const float* production, const float* consumption,
+                         const DispatchHorizon& horizon, int levels, HomeBatteryPlan& plan) {
+        int T = horizon.steps;
+        float h = horizon.stepHours;
+        plan.startWh = startWh;
+        plan.batteryW.resize(T);
+        plan.gridW.resize(T);
+        plan.levelWh.resize(T);
+        plan.importWhWithout = 0;
+        plan.costWithout = 0;
+        for (int t = 0; t < T; t++) {
+            float net = consumption[t] - production[t];
+            plan.importWhWithout += (net > 0 ? net : 0) * h;
+            plan.costWithout += billOf(net, t, horizon);
+        }
+
+        // No usable battery: the idle plan is the plan
+        if (spec.capacityWh <= 0 || levels < 1 || (spec.maxChargeW <= 0 && spec.maxDischargeW <= 0)) {
+            for (int t = 0; t < T; t++) {
+                plan.batteryW[t] = 0;
+                plan.gridW[t] = consumption[t] - production[t];
+                plan.levelWh[t] = startWh;
+            }
+            plan.importWh = plan.importWhWithout;
+            plan.cost = plan.costWithout;
+            return;
+        }
+
+        int L = levels;
+        float unit = spec.capacityWh / L;                   // Wh per level
+        float eff = spec.efficiency > 0 ? spec.efficiency : 1;
+        // Level steps reachable in one step
+        int upReach = (int)(spec.maxChargeW * h * eff / unit + 1e-4f);
+        int downReach = (int)(spec.maxDischargeW * h / eff / unit + 1e-4f);
+        if (upReach > L) upReach = L;
+        if (downReach > L) downReach = L;
+
+        int start = (int)(startWh / unit + 1e-4f);
+        if (start > L) start = L;
+        if (start < 0) start = 0;
+
+        // goalTo[j] / tieTo[j]: best primary goal from step t to the end
+        // starting at level j, and the secondary goal of that choice
+        const double INF = 1e30;
+        const double EPS = 1e-6;
+        double* goalTo = new double[L + 1];
+        double* goalNext = new double[L + 1];
+        double* tieTo = new double[L + 1];
+        double* tieNext = new double[L + 1];
+        short* choice = new short[(size_t)T * (L + 1)];
+        for (int j = 0; j <= L; j++) {
+            goalNext[j] = (horizon.keepFinalCharge && j < start) ? INF : 0;
+            tieNext[j] = 0;
+        }
+
+        for (int t = T - 1; t >= 0; t--) {
+            float base = consumption[t] - production[t];
+            short* row = choice + (size_t)t * (L + 1);
+            for (int j = 0; j <= L; j++) {
+                double best = INF, bestTie = INF;
+                short arg = (short)j;
+                int lo = j - downReach < 0 ? 0 : j - downReach;
+                int hi = j + upReach > L ? L : j + upReach;
+                for (int k = lo; k <= hi; k++) {
+                    if (goalNext[k] >= INF) continue;
+                    float grid = base + batteryToHome(k - j, unit, eff, h);
+                    if (k > j && grid > 1e-3f && !horizon.allowGridCharging) continue;
+                    double importWh = (grid > 0 ? grid : 0) * h;
+                    double bill = billOf(grid, t, horizon);
+                    double g = (horizon.minimizeBill ? bill : importWh) + goalNext[k];
+                    double tie = (horizon.minimizeBill ? importWh : bill) + tieNext[k];
+                    if (g < best - EPS || (g <= best + EPS && tie < bestTie)) {
+                        best = g;
+                        bestTie = tie;
+                        arg = (short)k;
+                    }
+                }
+                goalTo[j] = best;
+                tieTo[j] = bestTie;
+                row[j] = arg;
+            }
+            double* swap = goalTo;
+            goalTo = goalNext;
+            goalNext = swap;
+            swap = tieTo;
+            tieTo = tieNext;
+            tieNext = swap;
+        }
+
+        // Walk the choices forward from the starting level
+        plan.importWh = 0;
+        plan.cost = 0;
+        int j = start;
+        for (int t = 0; t < T; t++) {
+            int k = choice[(size_t)t * (L + 1) + j];
+            float extra = batteryToHome(k - j, unit, eff, h);
+            float grid = consumption[t] - production[t] + extra;
+            plan.batteryW[t] = (k - j) * unit / h;
+            plan.gridW[t] = grid;
+            plan.levelWh[t] = k * unit + (startWh - start * unit);   // keep the sub-level remainder
+            plan.importWh += (grid > 0 ? grid : 0) * h;
+            plan.cost += billOf(grid, t, horizon);
+            j = k;
+        }
+
+        delete[] goalTo;
+        delete[] goalNext;
+        delete[] tieTo;
+        delete[] tieNext;
+        delete[] choice;
+    }
+
+    // Plans every home of the graph. production / consumption are row-major
+    // [home][step] forecasts. Homes are split over `pool` if given.
+    static CommunityBatteryPlan planCommunity(CommunityGraph& graph,
+                                              const float* production, const float* consumption,
+                                              const DispatchHorizon& horizon,
+                                              int levels = DEFAULT_LEVELS, ThreadPool* pool = nullptr) {
+        auto begin = chrono::steady_clock::now();
+        CommunityBatteryPlan result;
+        int n = graph.getHomeCount();
+        int T = horizon.steps;
+        result.homes.resize(n);
+
+        auto planRange = [&](int, int lo, int hi) {
+            for (int i = lo; i < hi; i++) {
+                Home* home = graph.getHomeByIndex(i);
+                planHome(home->battery, home->batteryLevel,
+                         production + (size_t)i * T, consumption + (size_t)i * T,
+                         horizon, levels, result.homes[i]);
+            }
+        };
+        if (pool) pool->parallelFor(n, planRange);
+        else planRange(0, 0, n);
+
+        for (int i = 0; i < n; i++) {
+            result.importWhWithout += result.homes[i].importWhWithout;
+            result.importWh += result.homes[i].importWh;
+            result.costWithout += result.homes[i].costWithout;
+            result.cost += result.homes[i].cost;
+        }
+        result.latencyMs = chrono::duration<double, milli>(chrono::steady_clock::now() - begin).count();
+        return result;
+    }
+
+private:
+    // Grid bill (Rs) for one step at net exchange `gridW`
+    static float billOf(float gridW, int t, const DispatchHorizon& horizon) {
+        float kWh = gridW * horizon.stepHours / 1000.0f;
+        if (kWh > 0) return kWh * horizon.importPrice[t];
+        return kWh * horizon.exportPrice;                    // negative: earned
+    }
+
+    // Extra power (W) the home needs because the battery moves `delta`
+    // levels: charging draws more than it stores, discharging gives less
+    static float batteryToHome(int delta, float unit, float eff, float h) {
+        float storedWh = delta * unit;
+        if (delta > 0) return storedWh / eff / h;
+        return storedWh * eff / h;
+    }
+};
+
+#endif // BATTERY_DISPATCH_H
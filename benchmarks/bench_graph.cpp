@@ -0,0 +1,262 @@
+// Graph benchmarks on synthetic communities.
+// Build: g++ -std=c++17 -O2 benchmarks/bench_graph.cpp community_graph.cpp -o benchmarks/bench_graph
+// Run:   ./benchmarks/bench_graph [homes] [avgDegree]
+//        ./benchmarks/bench_graph bfs      (BFS sweep up to 10M edges)
+
+#include <iostream>
+#include <chrono>
+#include <cstdlib>
+#include <string>
+#include "../community_graph.h"
+#include "../community_simulation.h"
+
+using namespace std;
+
+double msSince(chrono::steady_clock::time_point start) {
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+// xorshift so large edge counts don't depend on RAND_MAX
+unsigned int nextRandom(unsigned int& state) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+// Ring (keeps it connected) plus random chords, distances 0.1 - 2.0 km
+void buildSyntheticCommunity(CommunityGraph& graph, int homes, int avgDegree, unsigned int seed) {
+    unsigned int state = seed;
+    for (int i = 0; i < homes; i++) {
+        graph.addHome(new Home("H" + to_string(i), "synthetic",
+                               (float)(nextRandom(state) % 3000), (float)(nextRandom(state) % 3000), 0));
+    }
+    for (int i = 0; i < homes; i++) {
+        graph.connectHomesByIndex(i, (i + 1) % homes, 0.1f + (nextRandom(state) % 20) / 10.0f);
+    }
+    long long chords = (long long)homes * (avgDegree - 2) / 2;
+    for (long long c = 0; c < chords; c++) {
+        int a = nextRandom(state) % homes, b = nextRandom(state) % homes;
+        if (a != b) {
+            graph.connectHomesByIndex(a, b, 0.1f + (nextRandom(state) % 20) / 10.0f);
+        }
+    }
+}
+
+void benchBFS(CommunityGraph& graph) {
+    int n = graph.getHomeCount();
+    int* order = new int[n];
+    int* level = new int[n];
+    const char* names[] = { "top-down", "bottom-up", "direction-optimizing" };
+    BFSMode modes[] = { BFS_TOP_DOWN, BFS_BOTTOM_UP, BFS_AUTO };
+    for (int m = 0; m < 3; m++) {
+        auto start = chrono::steady_clock::now();
+        int reached = graph.breadthFirstSearch(0, order, level, nullptr, modes[m]);
+        cout << "  BFS " << names[m] << ": " << msSince(start) << " ms (" << reached << " reached)" << endl;
+    }
+    delete[] order;
+    delete[] level;
+}
+
+// Repeated cost queries: plain Dijkstra vs cached trees vs hub labels
+void benchOracle(int homes, int degree, bool withLabels) {
+    CommunityGraph graph;
+    buildSyntheticCommunity(graph, homes, degree, 7);
+    graph.ensureCSR();
+    cout << homes << " homes / " << graph.getEdgeCount() << " edges" << endl;
+
+    const int QUERIES = 100000;
+    const int SOURCES = 16;                   // a handful of active requesters
+    int* qa = new int[QUERIES];
+    int* qb = new int[QUERIES];
+    unsigned int x = 99;
+    for (int i = 0; i < QUERIES; i++) {
+        x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+        qa[i] = x % SOURCES;
+        qb[i] = (x >> 8) % homes;
+    }
+
+    float* dist = new float[homes];
+    int* parent = new int[homes];
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < 100; i++) graph.computeShortestPaths(qa[i], dist, parent);
+    cout << "  Dijkstra per query:      " << msSince(start) * 1000.0 / 100 << " us" << endl;
+
+    DistanceOracle& oracle = graph.distances();
+    oracle.setCapacity(SOURCES);
+    volatile float sink = 0;
+    start = chrono::steady_clock::now();
+    for (int i = 0; i < QUERIES; i++) sink = sink + oracle.cost(qa[i], qb[i]);
+    cout << "  Tree cache per query:    " << msSince(start) * 1000.0 / QUERIES << " us ("
+         << oracle.getMisses() << " misses)" << endl;
+
+    if (!withLabels) {
+        delete[] qa;
+        delete[] qb;
+        delete[] dist;
+        delete[] parent;
+        return;
+    }
+
+    // Random graphs have no natural hubs, so labels stay large; keep this small
+    start = chrono::steady_clock::now();
+    oracle.buildHubLabels();
+    cout << "  Hub labels built in " << msSince(start) << " ms, "
+         << (double)oracle.hubLabelEntries() / homes << " entries/home" << endl;
+    start = chrono::steady_clock::now();
+    for (int i = 0; i < QUERIES; i++) sink = sink + oracle.cost(qb[i], qb[(i + 1) % QUERIES]);
+    cout << "  Hub label per query:     " << msSince(start) * 1000.0 / QUERIES << " us" << endl;
+
+    delete[] qa;
+    delete[] qb;
+    delete[] dist;
+    delete[] parent;
+}
+
+// Delta-stepping on 1, 2, 4, ... threads vs sequential Dijkstra
+void benchParallel(int homes, int degree) {
+    CommunityGraph graph;
+    buildSyntheticCommunity(graph, homes, degree, 3);
+    graph.ensureCSR();
+    cout << homes << " homes / " << graph.getEdgeCount() << " edges, "
+         << thread::hardware_concurrency() << " hardware threads" << endl;
+
+    float* dist = new float[homes];
+    int* parent = new int[homes];
+    float* check = new float[homes];
+    auto start = chrono::steady_clock::now();
+    graph.computeShortestPaths(0, dist, parent);
+    double sequential = msSince(start);
+    cout << "  Dijkstra:              " << sequential << " ms" << endl;
+
+    int maxThreads = (int)thread::hardware_concurrency();
+    if (maxThreads < 1) maxThreads = 1;
+    for (int threads = 1; threads <= maxThreads * 2 && threads <= 64; threads *= 2) {
+        ThreadPool pool(threads);
+        start = chrono::steady_clock::now();
+        graph.computeShortestPathsParallel(0, check, parent, pool);
+        double ms = msSince(start);
+        bool same = true;
+        for (int i = 0; i < homes; i++) if (check[i] != dist[i]) same = false;
+        cout << "  Delta-stepping x" << threads << ":" << (threads < 10 ? "     " : "    ") << ms
+             << " ms (speedup " << sequential / ms << ")" << (same ? "" : "  MISMATCH") << endl;
+    }
+
+    delete[] dist;
+    delete[] parent;
+    delete[] check;
+}
+
+// Point-to-point queries on a side x side street grid with map positions:
+// nearby targets (a few blocks) and random ones, per search mode
+void benchPointToPoint(int side) {
+    CommunityGraph graph;
+    unsigned int state = 11;
+    int n = side * side;
+    for (int i = 0; i < n; i++) {
+        Home* home = new Home("G" + to_string(i), "synthetic", 0, 0, 0);
+        home->setLocation((i % side) * 0.1f, (i / side) * 0.1f);
+        graph.addHome(home);
+    }
+    for (int i = 0; i < n; i++) {
+        if (i % side + 1 < side) graph.connectHomesByIndex(i, i + 1, 0.1f + (nextRandom(state) % 5) * 0.02f);
+        if (i + side < n) graph.connectHomesByIndex(i, i + side, 0.1f + (nextRandom(state) % 5) * 0.02f);
+    }
+    graph.ensureCSR();
+    cout << n << " homes on a grid, geographic: " << (graph.hasGeographicHeuristic() ? "yes" : "no") << endl;
+    
+    const int QUERIES = 200;
+    const char* names[3] = { "Dijkstra (early exit)", "Bidirectional", "A*" };
+    PathSearchMode modes[3] = { PATH_DIJKSTRA, PATH_BIDIRECTIONAL, PATH_ASTAR };
+    for (int nearby = 1; nearby >= 0; nearby--) {
+        cout << (nearby ? "  Targets within 10 blocks:" : "  Random targets:") << endl;
+        for (int m = 0; m < 3; m++) {
+            unsigned int q = 99;
+            long long settled = 0;
+            auto start = chrono::steady_clock::now();
+            for (int i = 0; i < QUERIES; i++) {
+                int s = nextRandom(q) % n;
+                int t = nextRandom(q) % n;
+                if (nearby) {
+                    int r = s / side + (int)(nextRandom(q) % 21) - 10;
+                    int c = s % side + (int)(nextRandom(q) % 21) - 10;
+                    r = r < 0 ? 0 : r >= side ? side - 1 : r;
+                    c = c < 0 ? 0 : c >= side ? side - 1 : c;
+                    t = r * side + c;
+                }
+                settled += graph.cheapestPath(s, t, modes[m]).settled;
+            }
+            double ms = msSince(start);
+            cout << "    " << names[m] << ": " << settled / QUERIES << " settled, "
+                 << ms * 1000 / QUERIES << " us/query" << endl;
+        }
+    }
+}
+
+// Year at 15-minute resolution (35040 steps); `days` to try a shorter run
+void benchSimulation(int homes, int days) {
+    SimulationConfig cfg;
+    cfg.homes = homes;
+    cfg.days = days;
+    auto start = chrono::steady_clock::now();
+    CommunitySimulation sim(cfg);
+    cout << "Built " << homes << " homes on " << sim.getFeederCount() << " feeders in "
+         << msSince(start) << " ms" << endl;
+    SimulationMetrics m = sim.run();
+    CommunitySimulation::printMetrics(m, cfg);
+}
+
+int main(int argc, char** argv) {
+    if (argc > 1 && string(argv[1]) == "p2p") {
+        benchPointToPoint(argc > 2 ? atoi(argv[2]) : 1000);
+        return 0;
+    }
+    if (argc > 1 && string(argv[1]) == "sim") {
+        benchSimulation(argc > 2 ? atoi(argv[2]) : 100000, argc > 3 ? atoi(argv[3]) : 365);
+        return 0;
+    }
+    if (argc > 1 && string(argv[1]) == "parallel") {
+        benchParallel(argc > 2 ? atoi(argv[2]) : 1000000, 8);
+        return 0;
+    }
+    if (argc > 1 && string(argv[1]) == "oracle") {
+        benchOracle(3000, 4, true);
+        benchOracle(200000, 4, false);
+        return 0;
+    }
+    if (argc > 1 && string(argv[1]) == "bfs") {
+        // (homes, avg degree): 100k edges -> 10M edges, sparse and dense
+        int configs[][2] = { {50000, 4}, {100000, 20}, {250000, 16}, {100000, 100}, {1000000, 20} };
+        for (int c = 0; c < 5; c++) {
+            CommunityGraph graph;
+            buildSyntheticCommunity(graph, configs[c][0], configs[c][1], 42 + c);
+            graph.ensureCSR();
+            cout << configs[c][0] << " homes / " << graph.getEdgeCount() << " edges" << endl;
+            benchBFS(graph);
+        }
+        return 0;
+    }
+
+    int homes = argc > 1 ? atoi(argv[1]) : 1000000;
+    int degree = argc > 2 ? atoi(argv[2]) : 4;
+
+    CommunityGraph graph;
+    auto start = chrono::steady_clock::now();
+    buildSyntheticCommunity(graph, homes, degree, 42);
+    graph.ensureCSR();
+    cout << "Built " << homes << " homes / " << graph.getEdgeCount() << " edges in "
+         << msSince(start) << " ms" << endl;
+
+    float* dist = new float[homes];
+    int* parent = new int[homes];
+
+    start = chrono::steady_clock::now();
+    graph.computeShortestPaths(0, dist, parent);
+    cout << "Dijkstra (indexed heap), full tree: " << msSince(start) << " ms" << endl;
+
+    benchBFS(graph);
+
+    delete[] dist;
+    delete[] parent;
+    return 0;
+}
@@ -0,0 +1,257 @@
+#ifndef COMMUNITY_FILE_H
+#define COMMUNITY_FILE_H
+
+#include <cstring>
+#include <cstdint>
+#include <string>
+#include "community_graph.h"
+#include "mapped_file.h"
+#include "utils.h"
+using namespace std;
+
+// Binary community file (community.dat), version 1. Native byte order.
+//
+//   CommunityFileHeader                  fixed 64 bytes
+//   CommunityHomeRecord[homeCount]       fixed 64 bytes each, dense home order
+//   uint32_t edgeOffsets[homeCount + 1]  edges of home u: [offsets[u], offsets[u+1])
+//   CommunityEdgeRecord[edgeCount]       grouped by `from` (CSR), each line once
+//   char strings[stringBytes]            home IDs and addresses, back to back
+//
+// Sections start on 8-byte boundaries and the header holds their offsets,
+// so loading is one mmap plus pointer arithmetic; the only per-home work
+// left is building the Home objects and indexes. Within a home, lines keep
+// the order they were added in.
+
+struct CommunityFileHeader {
+    char magic[8];                // "ECGRAPH"
+    uint32_t version;
+    uint32_t flags;               // FLAG_SETUP: community was set up
+    uint32_t homeCount;
+    uint32_t edgeCount;
+    uint64_t homesOffset;
+    uint64_t edgeOffsetsOffset;
+    uint64_t edgesOffset;
+    uint64_t stringsOffset;
+    uint64_t stringBytes;
+};
+
+struct CommunityHomeRecord {
+    uint32_t idOffset;            // into the string table
+    uint32_t idLength;
+    uint32_t addressOffset;
+    uint32_t addressLength;
+    float production;
+    float consumption;
+    float excess;
+    float batteryLevel;
+    float capacityWh;
+    float maxChargeW;
+    float maxDischargeW;
+    float efficiency;
+    float x;
+    float y;
+    uint32_t flags;               // HOME_LOCATED
+    uint32_t reserved;
+};
+
+struct CommunityEdgeRecord {
+    uint32_t to;
+    float distance;
+    float capacity;
+    float lossFraction;
+};
+
+class CommunityFile {
+public:
+    static const uint32_t VERSION = 1;
+    static const uint32_t FLAG_SETUP = 1;
+    static const uint32_t HOME_LOCATED = 1;
+
+    // Whole file image in memory; the caller decides where it goes
+    static bool encode(CommunityGraph& graph, bool communitySetup, string& out) {
+        int n = graph.getHomeCount();
+        int m = graph.getEdgeCount();
+
+        // String table
+        uint64_t stringBytes = 0;
+        for (int i = 0; i < n; i++) {
+            Home* home = graph.getHomeByIndex(i);
+            stringBytes += home->homeID.size() + home->address.size();
+        }
+        if (stringBytes > 0xFFFFFFFFull) return false;
+
+        CommunityFileHeader header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, "ECGRAPH", 8);
+        header.version = VERSION;
+        header.flags = communitySetup ? FLAG_SETUP : 0;
+        header.homeCount = n;
+        header.edgeCount = m;
+        header.homesOffset = sizeof(CommunityFileHeader);
+        header.edgeOffsetsOffset = align8(header.homesOffset + (uint64_t)n * sizeof(CommunityHomeRecord));
+        header.edgesOffset = align8(header.edgeOffsetsOffset + (uint64_t)(n + 1) * sizeof(uint32_t));
+        header.stringsOffset = align8(header.edgesOffset + (uint64_t)m * sizeof(CommunityEdgeRecord));
+        header.stringBytes = stringBytes;
+
+        CommunityHomeRecord* homes = new CommunityHomeRecord[n > 0 ? n : 1];
+        char* strings = new char[stringBytes > 0 ? stringBytes : 1];
+        uint32_t cursor = 0;
+        for (int i = 0; i < n; i++) {
+            Home* home = graph.getHomeByIndex(i);
+            CommunityHomeRecord& r = homes[i];
+            memset(&r, 0, sizeof(r));
+            r.idOffset = cursor;
+            r.idLength = home->homeID.size();
+            memcpy(strings + cursor, home->homeID.data(), r.idLength);
+            cursor += r.idLength;
+            r.addressOffset = cursor;
+            r.addressLength = home->address.size();
+            memcpy(strings + cursor, home->address.data(), r.addressLength);
+            cursor += r.addressLength;
+            r.production = home->currentProduction;
+            r.consumption = home->currentConsumption;
+            r.excess = home->excessEnergy;
+            r.batteryLevel = home->batteryLevel;
+            r.capacityWh = home->battery.capacityWh;
+            r.maxChargeW = home->battery.maxChargeW;
+            r.maxDischargeW = home->battery.maxDischargeW;
+            r.efficiency = home->battery.efficiency;
+            r.x = home->x;
+            r.y = home->y;
+            r.flags = home->hasLocation ? HOME_LOCATED : 0;
+        }
+
+        // Counting sort of the edge list by `from` (stable)
+        uint32_t* offsets = new uint32_t[n + 1];
+        for (int i = 0; i <= n; i++) offsets[i] = 0;
+        for (int e = 0; e < m; e++) offsets[graph.getEdge(e).from + 1]++;
+        for (int i = 0; i < n; i++) offsets[i + 1] += offsets[i];
+        CommunityEdgeRecord* edges = new CommunityEdgeRecord[m > 0 ? m : 1];
+        uint32_t* fill = new uint32_t[n + 1];
+        for (int i = 0; i <= n; i++) fill[i] = offsets[i];
+        for (int e = 0; e < m; e++) {
+            const GraphEdge& edge = graph.getEdge(e);
+            CommunityEdgeRecord& r = edges[fill[edge.from]++];
+            r.to = edge.to;
+            r.distance = edge.distance;
+            r.capacity = edge.capacity;
+            r.lossFraction = edge.lossFraction;
+        }
+        delete[] fill;
+
+        out.clear();
+        out.reserve(header.stringsOffset + stringBytes);
+        appendAt(out, 0, (const char*)&header, sizeof(header));
+        appendAt(out, header.homesOffset, (const char*)homes, (uint64_t)n * sizeof(CommunityHomeRecord));
+        appendAt(out, header.edgeOffsetsOffset, (const char*)offsets, (uint64_t)(n + 1) * sizeof(uint32_t));
+        appendAt(out, header.edgesOffset, (const char*)edges, (uint64_t)m * sizeof(CommunityEdgeRecord));
+        appendAt(out, header.stringsOffset, strings, stringBytes);
+        delete[] homes;
+        delete[] strings;
+        delete[] offsets;
+        delete[] edges;
+        return true;
+    }
+
+    // Written to a temp file and renamed, so a crash never leaves half a file
+    static bool save(CommunityGraph& graph, bool communitySetup, const string& path) {
+        string bytes;
+        return encode(graph, communitySetup, bytes) && writeFileAtomically(path, bytes);
+    }
+
+    // Loads into an empty graph (the Home objects are new'ed, as in
+    // setupCommunity). Returns false on a missing, foreign or damaged file
+    // (including one that lists a home ID twice); the graph is left
+    // untouched then.
+    static bool load(CommunityGraph& graph, bool& communitySetup, const string& path) {
+        if (graph.getHomeCount() != 0) return false;
+        MappedFile file;
+        if (!file.open(path)) return false;
+
+        const CommunityFileHeader* header = file.at<CommunityFileHeader>(0);
+        if (!header || memcmp(header->magic, "ECGRAPH", 8) != 0 || header->version != VERSION) return false;
+        uint32_t n = header->homeCount, m = header->edgeCount;
+        const CommunityHomeRecord* homes = file.at<CommunityHomeRecord>(header->homesOffset, n);
+        const uint32_t* offsets = file.at<uint32_t>(header->edgeOffsetsOffset, (uint64_t)n + 1);
+        const CommunityEdgeRecord* edges = file.at<CommunityEdgeRecord>(header->edgesOffset, m);
+        const char* strings = file.at<char>(header->stringsOffset, header->stringBytes);
+        if (!homes || !offsets || !edges || !strings) return false;
+
+        // Validate everything before touching the graph
+        if (offsets[0] != 0 || offsets[n] != m) return false;
+        for (uint32_t i = 0; i < n; i++) {
+            if (offsets[i] > offsets[i + 1]) return false;
+            const CommunityHomeRecord& r = homes[i];
+            if ((uint64_t)r.idOffset + r.idLength > header->stringBytes ||
+                (uint64_t)r.addressOffset + r.addressLength > header->stringBytes) return false;
+        }
+        for (uint32_t e = 0; e < m; e++) {
+            if (edges[e].to >= n) return false;
+        }
+        if (hasDuplicateIds(homes, n, strings)) return false;
+
+        // Homes go in with no excess and get it once the lines are in, so
+        // the provider index fills each component's heap once instead of
+        // pouring one heap per home into its neighbours line by line
+        graph.reserve(n, m);
+        for (uint32_t i = 0; i < n; i++) {
+            const CommunityHomeRecord& r = homes[i];
+            Home* home = new Home(string(strings + r.idOffset, r.idLength),
+                                  string(strings + r.addressOffset, r.addressLength),
+                                  r.production, r.consumption, 0);
+            home->excessEnergy = 0;
+            home->batteryLevel = r.batteryLevel;
+            home->battery = BatterySpec(r.capacityWh, r.maxChargeW, r.maxDischargeW, r.efficiency);
+            if (r.flags & HOME_LOCATED) home->setLocation(r.x, r.y);
+            graph.addHome(home);
+        }
+        for (uint32_t u = 0; u < n; u++) {
+            for (uint32_t e = offsets[u]; e < offsets[u + 1]; e++) {
+                graph.connectHomesByIndex(u, edges[e].to, edges[e].distance,
+                                          edges[e].capacity, edges[e].lossFraction);
+            }
+        }
+        for (uint32_t i = 0; i < n; i++) {
+            if (homes[i].excess != 0) graph.setHomeExcess(i, homes[i].excess);
+        }
+        communitySetup = (header->flags & FLAG_SETUP) != 0;
+        return true;
+    }
+
+private:
+    static uint64_t align8(uint64_t offset) { return (offset + 7) & ~(uint64_t)7; }
+
+    // Same home ID twice would make addHome replace a record while the lines
+    // still count both. Open addressing over record indices, comparing the
+    // IDs in place: no string or node per home.
+    static bool hasDuplicateIds(const CommunityHomeRecord* homes, uint32_t n, const char* strings) {
+        uint64_t slots = 16;
+        while (slots < 2 * (uint64_t)n) slots *= 2;
+        uint32_t* table = new uint32_t[slots];
+        for (uint64_t k = 0; k < slots; k++) table[k] = 0xFFFFFFFFu;
+        bool duplicate = false;
+        for (uint32_t i = 0; i < n && !duplicate; i++) {
+            const CommunityHomeRecord& r = homes[i];
+            uint64_t k = fnv1a64(strings + r.idOffset, r.idLength) & (slots - 1);
+            while (table[k] != 0xFFFFFFFFu) {
+                const CommunityHomeRecord& other = homes[table[k]];
+                if (other.idLength == r.idLength &&
+                    memcmp(strings + other.idOffset, strings + r.idOffset, r.idLength) == 0) {
+                    duplicate = true;
+                    break;
+                }
+                k = (k + 1) & (slots - 1);
+            }
+            if (!duplicate) table[k] = i;
+        }
+        delete[] table;
+        return duplicate;
+    }
+
+    static void appendAt(string& out, uint64_t offset, const char* data, uint64_t bytes) {
+        out.resize(offset, '\0');                    // pad up to the section start
+        out.append(data, bytes);
+    }
+};
+
+#endif // COMMUNITY_FILE_H
@@ -1,344 +1,787 @@
 #include "community_graph.h"
+#include <cstdint>
+#include <cstring>
+#include <atomic>
+#include <algorithm>
 
-void CommunityGraph::findAllNeighborsBFS(string startHomeID, string* neighbors, int& count) {
-    cout << "\n===== BFS: Finding All Neighbors =====" << endl;
-    cout << "Starting from: " << startHomeID << endl;
+// Counting-sort the edge list into CSR: count degrees, prefix-sum into
+// offsets, then scatter both directions of every edge.
+void CommunityGraph::rebuildCSR() {
+    int n = homeList.size();
+    int m = edgeList.size();
     
-    count = 0;
-    bool visited[100] = {false};
-    BFSQueue q;
+    delete[] csrOffsets;
+    delete[] csrTargets;
+    delete[] csrWeights;
+    csrOffsets = new int[n + 1];
+    csrTargets = new int[2 * m + 1];
+    csrWeights = new float[2 * m + 1];
     
-    int startIndex = hashHomeID(startHomeID);
-    visited[startIndex] = true;
-    q.enqueue(startHomeID);
+    for (int i = 0; i <= n; i++) csrOffsets[i] = 0;
+    for (int e = 0; e < m; e++) {
+        csrOffsets[edgeList[e].from + 1]++;
+        csrOffsets[edgeList[e].to + 1]++;
+    }
+    for (int i = 0; i < n; i++) csrOffsets[i + 1] += csrOffsets[i];
+    
+    int* cursor = new int[n + 1];
+    for (int i = 0; i < n; i++) cursor[i] = csrOffsets[i];
+    for (int e = 0; e < m; e++) {
+        const GraphEdge& edge = edgeList[e];
+        csrTargets[cursor[edge.from]] = edge.to;
+        csrWeights[cursor[edge.from]++] = edge.unitCost();
+        csrTargets[cursor[edge.to]] = edge.from;
+        csrWeights[cursor[edge.to]++] = edge.unitCost();
+    }
+    delete[] cursor;
     
-    int level = 0;
-    cout << "\nBFS Traversal:" << endl;
-    cout << "Level 0: " << startHomeID << " (Starting home)" << endl;
+    csrDirty = false;
+}
+
+// k-d tree over the located homes, and the check that makes the
+// straight-line bound safe for A*
+void CommunityGraph::rebuildSpatial() {
+    int n = homeList.size();
+    int* ids = new int[n + 1];
+    float* xs = new float[n + 1];
+    float* ys = new float[n + 1];
+    int located = 0;
+    for (int i = 0; i < n; i++) {
+        if (!homeList[i]->hasLocation) continue;
+        ids[located] = i;
+        xs[located] = homeList[i]->x;
+        ys[located] = homeList[i]->y;
+        located++;
+    }
+    spatial.build(ids, xs, ys, located);
+    delete[] ids;
+    delete[] xs;
+    delete[] ys;
     
-    while (!q.isEmpty()) {
-        int levelSize = q.getSize();
-        level++;
+    // The straight-line bound is only safe if no line is a shortcut
+    geographic = n > 0 && located == n;
+    for (int e = 0; geographic && e < edgeList.size(); e++) {
+        const Home* a = homeList[edgeList[e].from];
+        const Home* b = homeList[edgeList[e].to];
+        float dx = a->x - b->x, dy = a->y - b->y;
+        if (edgeList[e].distance < sqrt(dx * dx + dy * dy) * 0.9999f) geographic = false;
+    }
+    spatialDirty = false;
+}
+
+int CommunityGraph::nearestHomes(int i, int k, int* out, float* distKm) {
+    ensureSpatial();
+    Home* home = homeList[i];
+    if (!home->hasLocation || k <= 0) return 0;
+    auto notSelf = [i](int j) { return j != i; };
+    return spatial.nearest(home->x, home->y, k, out, distKm, notSelf);
+}
+
+void CommunityGraph::homesWithinRadius(int i, float radiusKm, DynamicArray<int>& out) {
+    ensureSpatial();
+    Home* home = homeList[i];
+    if (!home->hasLocation) return;
+    int first = out.size();
+    spatial.withinRadius(home->x, home->y, radiusKm, out);
+    // Drop i itself (swap with the last one)
+    for (int j = first; j < out.size(); j++) {
+        if (out[j] == i) {
+            out[j] = out.back();
+            out.pop();
+            break;
+        }
+    }
+}
+
+int CommunityGraph::nearestProviders(int i, float radiusKm, int k, int* out) {
+    ensureSpatial();
+    Home* home = homeList[i];
+    if (!home->hasLocation) return 0;
+    if (k <= 0) k = spatial.size();
+    int root = components.find(i);
+    auto isProvider = [&](int j) {
+        return j != i && homeList[j]->excessEnergy > 0 && components.find(j) == root;
+    };
+    float* dist = new float[k];
+    int found = spatial.nearest(home->x, home->y, k, out, dist, isProvider);
+    int inside = 0;
+    while (inside < found && dist[inside] <= radiusKm) inside++;
+    delete[] dist;
+    return inside;
+}
+
+int CommunityGraph::breadthFirstSearch(int source, int* order, int* level, int* parent, BFSMode mode) {
+    ensureCSR();
+    int n = homeList.size();
+    int words = (n + 63) / 64;
+    
+    uint64_t* visited = new uint64_t[words];
+    uint64_t* frontierBits = new uint64_t[words];   // only needed bottom-up
+    for (int w = 0; w < words; w++) visited[w] = 0;
+    for (int i = 0; i < n; i++) level[i] = -1;
+    if (parent) {
+        for (int i = 0; i < n; i++) parent[i] = -1;
+    }
+    
+    // order[] doubles as the frontier storage: [frontStart, frontEnd) is the
+    // current level, anything appended after it is the next one.
+    int reached = 0;
+    order[reached++] = source;
+    level[source] = 0;
+    visited[source >> 6] |= 1ULL << (source & 63);
+    
+    int frontStart = 0, frontEnd = 1, depth = 0;
+    long long edgesUnexplored = csrOffsets[n];
+    bool bottomUp = (mode == BFS_BOTTOM_UP);
+    const int ALPHA = 14, BETA = 24;                 // Beamer et al. switch thresholds
+    
+    while (frontStart < frontEnd) {
+        depth++;
         
-        if (levelSize > 0) {
-            cout << "Level " << level << ": ";
+        if (mode == BFS_AUTO) {
+            long long frontierEdges = 0;
+            for (int i = frontStart; i < frontEnd; i++) {
+                int u = order[i];
+                frontierEdges += csrOffsets[u + 1] - csrOffsets[u];
+            }
+            edgesUnexplored -= frontierEdges;
+            if (!bottomUp && frontierEdges > edgesUnexplored / ALPHA) bottomUp = true;
+            else if (bottomUp && (frontEnd - frontStart) < n / BETA) bottomUp = false;
         }
         
-        for (int i = 0; i < levelSize; i++) {
-            string currentHome = q.dequeue();
-            
-            GraphEdge** edgeList = adjacencyList.get(currentHome);
-            if (!edgeList || *edgeList == nullptr) continue;
-            
-            GraphEdge* edge = *edgeList;
-            while (edge != nullptr) {
-                int neighborIndex = hashHomeID(edge->neighborID);
-                
-                if (!visited[neighborIndex]) {
-                    visited[neighborIndex] = true;
-                    neighbors[count++] = edge->neighborID;
-                    q.enqueue(edge->neighborID);
-                    
-                    cout << edge->neighborID << "(" << edge->distance << "km) ";
+        if (!bottomUp) {
+            for (int i = frontStart; i < frontEnd; i++) {
+                int u = order[i];
+                for (int e = csrOffsets[u]; e < csrOffsets[u + 1]; e++) {
+                    int v = csrTargets[e];
+                    uint64_t bit = 1ULL << (v & 63);
+                    if (!(visited[v >> 6] & bit)) {
+                        visited[v >> 6] |= bit;
+                        level[v] = depth;
+                        if (parent) parent[v] = u;
+                        order[reached++] = v;
+                        emit(TRACE_BFS_VISIT, v, u, (float)depth);
+                    }
+                }
+            }
+        } else {
+            for (int w = 0; w < words; w++) frontierBits[w] = 0;
+            for (int i = frontStart; i < frontEnd; i++) {
+                frontierBits[order[i] >> 6] |= 1ULL << (order[i] & 63);
+            }
+            for (int w = 0; w < words; w++) {
+                uint64_t unvisited = ~visited[w];
+                if (w == words - 1 && (n & 63)) unvisited &= (1ULL << (n & 63)) - 1;
+                while (unvisited) {
+                    int v = (w << 6) + __builtin_ctzll(unvisited);
+                    unvisited &= unvisited - 1;
+                    for (int e = csrOffsets[v]; e < csrOffsets[v + 1]; e++) {
+                        int u = csrTargets[e];
+                        if (frontierBits[u >> 6] & (1ULL << (u & 63))) {
+                            visited[w] |= 1ULL << (v & 63);
+                            level[v] = depth;
+                            if (parent) parent[v] = u;
+                            order[reached++] = v;
+                            emit(TRACE_BFS_VISIT, v, u, (float)depth);
+                            break;                      // one parent is enough
+                        }
+                    }
                 }
-                edge = edge->next;
             }
         }
-        if (levelSize > 0) {
-            cout << endl;
-        }
+        
+        frontStart = frontEnd;
+        frontEnd = reached;
     }
     
-    cout << "\nTotal neighbors found: " << count << endl;
-    cout << "======================================" << endl;
+    delete[] visited;
+    delete[] frontierBits;
+    return reached;
 }
 
-float CommunityGraph::findCheapestPath(string startHome, string targetHome, string* path, int& pathLength) {
-    cout << "\n===== Dijkstra: Finding Cheapest Path =====" << endl;
-    cout << "From: " << startHome << " -> To: " << targetHome << endl;
-    
-    string allHomes[100];
-    int homeCountLocal;
-    homes.getAllKeys(allHomes, homeCountLocal);
+void CommunityGraph::findAllNeighborsBFS(string startHomeID, string* neighbors, int& count) {
+    count = 0;
+    int start = indexOf(startHomeID);
+    if (start == -1) return;
     
-    float distance[100];
-    string previous[100];
-    bool visited[100];
+    int n = homeList.size();
+    int* order = new int[n];
+    int* level = new int[n];
+    int reached = breadthFirstSearch(start, order, level);
     
-    for (int i = 0; i < 100; i++) {
-        distance[i] = 999999;
-        visited[i] = false;
+    for (int i = 1; i < reached; i++) {      // order[0] is the start home itself
+        neighbors[count++] = idOf(order[i]);
     }
     
-    int startIdx = -1;
-    for (int i = 0; i < homeCountLocal; i++) {
-        if (allHomes[i] == startHome) {
-            startIdx = i;
-            distance[i] = 0;
-            break;
-        }
+    delete[] order;
+    delete[] level;
+}
+
+void CommunityGraph::computeShortestPaths(int source, float* dist, int* parent) {
+    computeShortestPathsMulti(&source, 1, dist, parent);
+}
+
+void CommunityGraph::computeShortestPathsMulti(const int* sources, int sourceCount, float* dist, int* parent,
+                                               const float* startCost, int* root) {
+    ensureCSR();
+    int n = homeList.size();
+    for (int i = 0; i < n; i++) {
+        dist[i] = UNREACHABLE;
+        parent[i] = -1;
+        if (root) root[i] = -1;
     }
     
-    if (startIdx == -1) {
-        cout << "Start home not found!" << endl;
-        return -1;
+    IndexedMinHeap pq(n);
+    for (int i = 0; i < sourceCount; i++) {
+        float d = startCost ? startCost[i] : 0;
+        int s = sources[i];
+        if (d >= dist[s]) continue;          // same home listed twice: keep the cheaper start
+        dist[s] = d;
+        if (root) root[s] = s;
+        pq.pushOrDecrease(s, d);
     }
     
-    for (int iteration = 0; iteration < homeCountLocal; iteration++) {
-        int minIdx = -1;
-        float minDist = 999999;
+    while (!pq.isEmpty()) {
+        int u = pq.popMin();        // settled: dist[u] is final
+        emit(TRACE_SETTLE, u, -1, dist[u]);
         
-        for (int i = 0; i < homeCountLocal; i++) {
-            if (!visited[i] && distance[i] < minDist) {
-                minDist = distance[i];
-                minIdx = i;
+        for (int e = csrOffsets[u]; e < csrOffsets[u + 1]; e++) {
+            int v = csrTargets[e];
+            float newDist = dist[u] + csrWeights[e];
+            
+            if (newDist < dist[v]) {
+                dist[v] = newDist;
+                parent[v] = u;
+                if (root) root[v] = root[u];
+                pq.pushOrDecrease(v, newDist);
+                emit(TRACE_RELAX, v, u, newDist);
             }
         }
-        
-        if (minIdx == -1) break;
-        
-        visited[minIdx] = true;
-        string currentHome = allHomes[minIdx];
-        
-        cout << "Visiting: " << currentHome << " (Cost: " << distance[minIdx] << ")" << endl;
-        
-        GraphEdge** edgeList = adjacencyList.get(currentHome);
-        if (!edgeList || *edgeList == nullptr) continue;
-        
-        GraphEdge* edge = *edgeList;
-        while (edge != nullptr) {
-            int neighborIdx = -1;
-            for (int i = 0; i < homeCountLocal; i++) {
-                if (allHomes[i] == edge->neighborID) {
-                    neighborIdx = i;
-                    break;
+    }
+}
+
+// Non-negative floats order the same as their bit patterns, so an atomic
+// min over dist can be done with compare-exchange on the raw bits.
+static inline uint32_t floatBits(float f) {
+    uint32_t u;
+    memcpy(&u, &f, sizeof(u));
+    return u;
+}
+
+static inline float bitsFloat(uint32_t u) {
+    float f;
+    memcpy(&f, &u, sizeof(f));
+    return f;
+}
+
+struct RelaxedHome {
+    int home;
+    float dist;
+};
+
+// Delta-stepping: homes are kept in buckets of width delta by tentative
+// cost. The lowest non-empty bucket is relaxed in parallel (every edge of
+// every home in it, atomic min on the target) until it stops changing,
+// then the next bucket. Each worker records its successful relaxations
+// locally; the merge keeps only entries whose cost is still current, so a
+// home is queued at most once per improvement.
+// Final costs are the least fixed point of d[v] = min(d[u] + w), the same
+// values Dijkstra computes with the same float additions.
+void CommunityGraph::computeShortestPathsParallel(int source, float* dist, int* parent,
+                                                  ThreadPool& pool, float delta) {
+    ensureCSR();
+    int n = homeList.size();
+    const int SERIAL_FRONTIER = 1024;     // below this, threads cost more than they save
+    
+    atomic<uint32_t>* best = new atomic<uint32_t>[n];
+    uint32_t inf = floatBits(UNREACHABLE);
+    pool.parallelFor(n, [&](int, int begin, int end) {
+        for (int i = begin; i < end; i++) best[i].store(inf, memory_order_relaxed);
+    });
+    best[source].store(floatBits(0.0f));
+    
+    if (delta <= 0) {
+        int arcs = csrOffsets[n];
+        double sum = 0;
+        for (int e = 0; e < arcs; e++) sum += csrWeights[e];
+        delta = arcs > 0 ? (float)(sum / arcs) : 1.0f;
+        if (delta <= 0) delta = 1.0f;
+    }
+    
+    int workers = pool.size();
+    DynamicArray<RelaxedHome>* found = new DynamicArray<RelaxedHome>[workers];
+    DynamicArray<DynamicArray<int>*> buckets;
+    auto enqueue = [&](int home, float d) {
+        int b = (int)(d / delta);
+        while (buckets.size() <= b) buckets.push(nullptr);
+        if (!buckets[b]) buckets[b] = new DynamicArray<int>();
+        buckets[b]->push(home);
+    };
+    enqueue(source, 0.0f);
+    
+    DynamicArray<int> frontier;
+    auto relaxRange = [&](int worker, int begin, int end) {
+        DynamicArray<RelaxedHome>& out = found[worker];
+        for (int i = begin; i < end; i++) {
+            int u = frontier[i];
+            float du = bitsFloat(best[u].load(memory_order_relaxed));
+            for (int e = csrOffsets[u]; e < csrOffsets[u + 1]; e++) {
+                int v = csrTargets[e];
+                float nd = du + csrWeights[e];
+                uint32_t ndBits = floatBits(nd);
+                uint32_t cur = best[v].load(memory_order_relaxed);
+                while (ndBits < cur) {
+                    if (best[v].compare_exchange_weak(cur, ndBits, memory_order_relaxed)) {
+                        RelaxedHome r;
+                        r.home = v;
+                        r.dist = nd;
+                        out.push(r);
+                        break;
+                    }
                 }
             }
+        }
+    };
+    
+    for (int b = 0; b < buckets.size(); b++) {
+        while (buckets[b] && buckets[b]->size() > 0) {
+            frontier = *buckets[b];
+            buckets[b]->clear();
             
-            if (neighborIdx != -1 && !visited[neighborIdx]) {
-                float edgeCost = edge->distance * 5;
-                float newDist = distance[minIdx] + edgeCost;
-                
-                if (newDist < distance[neighborIdx]) {
-                    distance[neighborIdx] = newDist;
-                    previous[neighborIdx] = currentHome;
-                    cout << "  Updated " << edge->neighborID << " cost to " << newDist << endl;
-                }
+            if (frontier.size() < SERIAL_FRONTIER) {
+                relaxRange(0, 0, frontier.size());
+            } else {
+                pool.parallelFor(frontier.size(), relaxRange);
             }
             
-            edge = edge->next;
+            for (int w = 0; w < workers; w++) {
+                for (int i = 0; i < found[w].size(); i++) {
+                    const RelaxedHome& r = found[w][i];
+                    if (best[r.home].load(memory_order_relaxed) == floatBits(r.dist)) {
+                        enqueue(r.home, r.dist);
+                    }
+                }
+                found[w].clear();
+            }
         }
+        delete buckets[b];
+        buckets[b] = nullptr;
     }
     
-    int targetIdx = -1;
-    for (int i = 0; i < homeCountLocal; i++) {
-        if (allHomes[i] == targetHome) {
-            targetIdx = i;
-            break;
+    pool.parallelFor(n, [&](int, int begin, int end) {
+        for (int i = begin; i < end; i++) dist[i] = bitsFloat(best[i].load(memory_order_relaxed));
+    });
+    delete[] best;
+    delete[] found;
+    
+    // Parents: among neighbors with a strictly smaller cost that explain
+    // dist[v], take the one with the smallest (cost, index). Costs fall
+    // along every chain, so each chain ends at the source.
+    pool.parallelFor(n, [&](int, int begin, int end) {
+        for (int v = begin; v < end; v++) {
+            parent[v] = -1;
+            if (v == source || dist[v] >= UNREACHABLE) continue;
+            for (int e = csrOffsets[v]; e < csrOffsets[v + 1]; e++) {
+                int u = csrTargets[e];
+                if (dist[u] >= dist[v] || dist[u] + csrWeights[e] != dist[v]) continue;
+                if (parent[v] == -1 || dist[u] < dist[parent[v]] ||
+                    (dist[u] == dist[parent[v]] && u < parent[v])) {
+                    parent[v] = u;
+                }
+            }
+        }
+    });
+    
+    // Homes reached only over zero-length lines have no such neighbor;
+    // grow them off homes that already hang from the source.
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (int v = 0; v < n; v++) {
+            if (v == source || parent[v] != -1 || dist[v] >= UNREACHABLE) continue;
+            for (int e = csrOffsets[v]; e < csrOffsets[v + 1]; e++) {
+                int u = csrTargets[e];
+                if ((u == source || parent[u] != -1) && dist[u] + csrWeights[e] == dist[v]) {
+                    parent[v] = u;
+                    changed = true;
+                    break;
+                }
+            }
         }
     }
+}
+
+int CommunityGraph::buildPath(int target, const int* parent, string* path) {
+    int length = 0;
+    for (int current = target; current != -1; current = parent[current]) {
+        length++;
+    }
+    int i = length;
+    for (int current = target; current != -1; current = parent[current]) {
+        path[--i] = idOf(current);
+    }
+    return length;
+}
+
+float CommunityGraph::findCheapestPath(string startHome, string targetHome, string* path, int& pathLength,
+                                       PathSearchMode mode) {
+    int startIdx = indexOf(startHome);
+    int targetIdx = indexOf(targetHome);
+    if (startIdx == -1 || targetIdx == -1) return -1;
     
-    if (targetIdx == -1 || distance[targetIdx] == 999999) {
-        cout << "No path found!" << endl;
-        return -1;
+    PathQuery query = cheapestPath(startIdx, targetIdx, mode);
+    if (query.cost >= UNREACHABLE) return -1;
+    pathLength = query.nodes.size();
+    for (int i = 0; i < pathLength; i++) path[i] = homeList[query.nodes[i]]->homeID;
+    return query.cost;
+}
+
+PathQuery CommunityGraph::cheapestPath(int source, int target, PathSearchMode mode) {
+    PathQuery query;
+    if (mode == PATH_AUTO) {
+        if (oracle.hasTree(source)) mode = PATH_TREE;
+        else if (hasGeographicHeuristic()) mode = PATH_ASTAR;
+        else mode = PATH_BIDIRECTIONAL;
     }
+    if (mode == PATH_ASTAR && !hasGeographicHeuristic()) mode = PATH_DIJKSTRA;   // bound would be 0 anyway
+    query.mode = mode;
     
-    string reversePath[100];
-    int revCount = 0;
-    string current = targetHome;
+    if (mode == PATH_TREE) {
+        const ShortestPathTree* t = oracle.tree(source);
+        if (t->dist[target] >= UNREACHABLE) return query;
+        query.cost = t->dist[target];
+        for (int v = target; v != -1; v = t->parent[v]) query.nodes.push(v);
+    } else if (mode == PATH_BIDIRECTIONAL) {
+        searchBidirectional(source, target, query);
+        return query;
+    } else {
+        searchToTarget(source, target, mode == PATH_ASTAR, query);
+    }
     
-    while (current != startHome) {
-        reversePath[revCount++] = current;
-        bool found = false;
-        for (int i = 0; i < homeCountLocal; i++) {
-            if (allHomes[i] == current) {
-                current = previous[i];
-                found = true;
-                break;
+    // Collected target -> source; flip
+    int len = query.nodes.size();
+    for (int i = 0; i < len / 2; i++) {
+        int t = query.nodes[i];
+        query.nodes[i] = query.nodes[len - 1 - i];
+        query.nodes[len - 1 - i] = t;
+    }
+    return query;
+}
+
+// Dijkstra from source that stops when target is settled. With the
+// heuristic the heap is keyed by cost + bound(v, target) (A*); the bound is
+// consistent, so a settled home is final just like in plain Dijkstra.
+void CommunityGraph::searchToTarget(int source, int target, bool useHeuristic, PathQuery& query) {
+    ensureCSR();
+    SearchSpace& space = forwardSpace;
+    space.begin(homeList.size());
+    space.set(source, 0, -1);
+    space.heap->pushOrDecrease(source, useHeuristic ? heuristicCost(source, target) : 0);
+    
+    while (!space.heap->isEmpty()) {
+        int u = space.heap->popMin();
+        float du = space.distOf(u);
+        query.settled++;
+        emit(TRACE_SETTLE, u, -1, du);
+        if (u == target) {
+            query.cost = du;
+            for (int v = target; v != -1; v = space.parentOf(v)) query.nodes.push(v);
+            return;
+        }
+        
+        for (int e = csrOffsets[u]; e < csrOffsets[u + 1]; e++) {
+            int v = csrTargets[e];
+            float nd = du + csrWeights[e];
+            if (nd < space.distOf(v)) {
+                space.set(v, nd, u);
+                space.heap->pushOrDecrease(v, useHeuristic ? nd + heuristicCost(v, target) : nd);
+                emit(TRACE_RELAX, v, u, nd);
             }
         }
-        if (!found) break;
     }
-    reversePath[revCount++] = startHome;
+}
+
+// Two Dijkstra searches, from source and from target, always advancing the
+// one with the smaller frontier key. best tracks the cheapest source-target
+// route seen through an edge joining the two; once the frontier keys add up
+// to at least best, nothing left can beat it.
+void CommunityGraph::searchBidirectional(int source, int target, PathQuery& query) {
+    ensureCSR();
+    int n = homeList.size();
+    forwardSpace.begin(n);
+    backwardSpace.begin(n);
+    forwardSpace.set(source, 0, -1);
+    backwardSpace.set(target, 0, -1);
+    forwardSpace.heap->pushOrDecrease(source, 0);
+    backwardSpace.heap->pushOrDecrease(target, 0);
     
-    pathLength = revCount;
-    for (int i = 0; i < revCount; i++) {
-        path[i] = reversePath[revCount - 1 - i];
-    }
+    float best = source == target ? 0 : UNREACHABLE;
+    int meetForward = source == target ? source : -1;    // route = source..meetForward + meetBackward..target
+    int meetBackward = source == target ? target : -1;
     
-    cout << "\nCheapest path: ";
-    for (int i = 0; i < pathLength; i++) {
-        cout << path[i];
-        if (i < pathLength - 1) cout << " -> ";
+    while (!forwardSpace.heap->isEmpty() && !backwardSpace.heap->isEmpty()) {
+        float topF = forwardSpace.heap->peekMinKey();
+        float topB = backwardSpace.heap->peekMinKey();
+        if (topF + topB >= best) break;
+        
+        bool forward = topF <= topB;
+        SearchSpace& side = forward ? forwardSpace : backwardSpace;
+        SearchSpace& other = forward ? backwardSpace : forwardSpace;
+        int u = side.heap->popMin();
+        float du = side.distOf(u);
+        query.settled++;
+        emit(TRACE_SETTLE, u, -1, du);
+        
+        for (int e = csrOffsets[u]; e < csrOffsets[u + 1]; e++) {
+            int v = csrTargets[e];
+            float nd = du + csrWeights[e];
+            if (nd < side.distOf(v)) {
+                side.set(v, nd, u);
+                side.heap->pushOrDecrease(v, nd);
+                emit(TRACE_RELAX, v, u, nd);
+            }
+            if (other.reached(v) && nd + other.distOf(v) < best) {
+                best = nd + other.distOf(v);
+                meetForward = forward ? u : v;
+                meetBackward = forward ? v : u;
+            }
+        }
     }
-    cout << endl;
-    cout << "Total cost: Rs " << distance[targetIdx] << endl;
-    cout << "======================================" << endl;
     
-    return distance[targetIdx];
+    if (best >= UNREACHABLE) return;
+    query.cost = best;
+    for (int v = meetForward; v != -1; v = forwardSpace.parentOf(v)) query.nodes.push(v);
+    int len = query.nodes.size();
+    for (int i = 0; i < len / 2; i++) {
+        int t = query.nodes[i];
+        query.nodes[i] = query.nodes[len - 1 - i];
+        query.nodes[len - 1 - i] = t;
+    }
+    if (meetBackward != meetForward) {
+        for (int v = meetBackward; v != -1; v = backwardSpace.parentOf(v)) query.nodes.push(v);
+    }
 }
 
 void CommunityGraph::displayCommunityStatus() {
     cout << "\n===== Community Energy Status =====" << endl;
     cout << "Total homes in network: " << homeCount << endl;
-    
-    string homeIDs[100];
-    int count;
-    homes.getAllKeys(homeIDs, count);
+    cout << "Connected groups: " << components.componentCount() << endl;
     
     cout << "\nHome ID\tProduction(W)\tConsumption(W)\tExcess(W)" << endl;
     cout << "--------------------------------------------------------" << endl;
     
-    for (int i = 0; i < count; i++) {
-        Home** home = homes.get(homeIDs[i]);
-        if (home && *home) {
-            (*home)->updateEnergy();
-            cout << (*home)->homeID << "\t"
-                 << (*home)->currentProduction << "\t\t"
-                 << (*home)->currentConsumption << "\t\t"
-                 << (*home)->excessEnergy << endl;
+    for (int i = 0; i < homeList.size(); i++) {
+        refreshHomeEnergy(i);
+        Home* home = homeList[i];
+        cout << home->homeID << "\t"
+             << home->currentProduction << "\t\t"
+             << home->currentConsumption << "\t\t"
+             << home->excessEnergy << endl;
+    }
+    
+    if (gridTopology) {
+        cout << "\nGrid node\tSurplus(W)\tLoad(W)\tShared(W)\tRating(W)" << endl;
+        cout << "--------------------------------------------------------" << endl;
+        for (int v = 0; v < gridTopology->nodeCount(); v++) {
+            cout << string(2 * gridTopology->depthOf(v), ' ') << gridTopology->nameOf(v) << "\t"
+                 << gridTopology->subtreeSurplus(v) << "\t\t"
+                 << gridTopology->subtreeLoad(v) << "\t"
+                 << gridTopology->reservedOf(v) << "\t\t";
+            if (gridTopology->ratingOf(v) >= GridTopology::UNLIMITED) cout << "-" << endl;
+            else cout << gridTopology->ratingOf(v) << endl;
         }
     }
 }
 
-void CommunityGraph::findEnergySharing(string requestingHomeID, float requiredEnergy) {
+SharingPlan CommunityGraph::planEnergySharing(string requestingHomeID, float requiredEnergy, int maxProviders,
+                                              float radiusKm) {
+    SharingPlan plan;
+    plan.requestedEnergy = requiredEnergy;
+    plan.gridCost = (requiredEnergy / 1000.0f) * GRID_PRICE_PER_KWH;
+    
+    int requester = indexOf(requestingHomeID);
+    if (requester == -1) return plan;
+    plan.requester = requester;
+    
+    // Phase 1/2: the component index knows who is connected and the provider
+    // index who has surplus - no walk over the neighborhood
+    int n = homeList.size();
+    int root = components.find(requester);
+    plan.reachableCount = components.componentSize(requester) - 1;
+    plan.groupSurplus = (float)components.componentSurplus(requester);
+    
+    // ... or, with a radius, the spatial index who is close enough
+    int available = providers.providerCount(root);
+    int k = (maxProviders > 0 && maxProviders < available) ? maxProviders + 1 : available;
+    bool byRadius = radiusKm > 0 && homeList[requester]->hasLocation;
+    int* top = new int[(byRadius ? n : k) + 1];
+    int got;
+    if (byRadius) {
+        got = nearestProviders(requester, radiusKm, maxProviders, top);
+    } else {
+        got = providers.topK(root, k, top);
+    }
+    for (int i = 0; i < got && (maxProviders <= 0 || plan.providers.size() < maxProviders); i++) {
+        if (top[i] == requester) continue;
+        SharingProvider p;
+        p.homeIndex = top[i];
+        p.excessEnergy = homeList[top[i]]->excessEnergy;
+        p.pathCost = 0;
+        plan.providers.push(p);
+        emit(TRACE_PROVIDER, top[i], -1, p.excessEnergy);
+    }
+    delete[] top;
+    
+    int providerCount = plan.providers.size();
+    if (providerCount == 0) return plan;
+    
+    // Phase 3: one shortest-path tree from the requester covers every provider
+    const ShortestPathTree* t = oracle.tree(requester);
+    plan.parent.resize(n);
+    for (int i = 0; i < n; i++) plan.parent[i] = t->parent[i];
+    for (int i = 0; i < providerCount; i++) {
+        plan.providers[i].pathCost = t->dist[plan.providers[i].homeIndex];
+    }
+    
+    // Phase 4: rank providers by cost (ties: larger surplus, then index)
+    SharingProvider* ranked = plan.providers.raw();
+    sort(ranked, ranked + providerCount, [](const SharingProvider& a, const SharingProvider& b) {
+        if (a.pathCost != b.pathCost) return a.pathCost < b.pathCost;
+        if (a.excessEnergy != b.excessEnergy) return a.excessEnergy > b.excessEnergy;
+        return a.homeIndex < b.homeIndex;
+    });
+    
+    // Phase 5: take from the cheapest providers first, as far as the
+    // transformers on the way let through (booked as we go, released below)
+    float remainingNeed = requiredEnergy;
+    for (int i = 0; i < providerCount && remainingNeed > 0; i++) {
+        const SharingProvider& p = plan.providers[i];
+        SharingTransfer t;
+        t.providerIndex = p.homeIndex;
+        t.energy = (p.excessEnergy < remainingNeed) ? p.excessEnergy : remainingNeed;
+        if (gridTopology) {
+            float room = gridTopology->pathHeadroom(p.homeIndex, requester);
+            if (room < t.energy) {
+                plan.heldBackByTransformers += t.energy - room;
+                t.energy = room;
+            }
+            if (t.energy <= 0) continue;
+            gridTopology->reserve(p.homeIndex, requester, t.energy);
+        }
+        t.cost = (t.energy / 1000.0f) * p.pathCost;
+        plan.transfers.push(t);
+        emit(TRACE_TRANSFER, p.homeIndex, requester, t.energy);
+        
+        remainingNeed -= t.energy;
+        plan.communityCost += t.cost;
+    }
+    plan.energyReceived = requiredEnergy - remainingNeed;
+    if (gridTopology) {
+        for (int i = 0; i < plan.transfers.size(); i++) {
+            gridTopology->release(plan.transfers[i].providerIndex, requester, plan.transfers[i].energy);
+        }
+    }
+    
+    return plan;
+}
+
+// Transfers come out of the providers' current surplus (W), so only that
+// goes down; stored energy (batteryLevel, Wh) is left to BatteryDispatcher
+void CommunityGraph::commitSharingPlan(const SharingPlan& plan) {
+    for (int i = 0; i < plan.transfers.size(); i++) {
+        int p = plan.transfers[i].providerIndex;
+        if (gridTopology) gridTopology->reserve(p, plan.requester, plan.transfers[i].energy);
+        setHomeExcess(p, homeList[p]->excessEnergy - plan.transfers[i].energy);
+    }
+}
+
+void CommunityGraph::printSharingPlan(const SharingPlan& plan) {
     cout << "\n############################################" << endl;
     cout << "#   COMMUNITY ENERGY SHARING SYSTEM        #" << endl;
     cout << "############################################" << endl;
     
-    Home** requester = homes.get(requestingHomeID);
-    if (!requester || *requester == nullptr) {
+    if (plan.requester == -1) {
         cout << "\n  Error: Home not found!" << endl;
         return;
     }
     
+    Home* requester = homeList[plan.requester];
     cout << "\n  Requesting Home Details:" << endl;
-    cout << "   ID: " << requestingHomeID << endl;
-    cout << "   Address: " << (*requester)->address << endl;
-    cout << "   Production: " << (*requester)->currentProduction << " W" << endl;
-    cout << "   Consumption: " << (*requester)->currentConsumption << " W" << endl;
-    cout << "   Deficit: " << requiredEnergy << " W" << endl;
+    cout << "   ID: " << requester->homeID << endl;
+    cout << "   Address: " << requester->address << endl;
+    cout << "   Production: " << requester->currentProduction << " W" << endl;
+    cout << "   Consumption: " << requester->currentConsumption << " W" << endl;
+    cout << "   Deficit: " << plan.requestedEnergy << " W" << endl;
     
-    cout << "\n  Phase 1: Finding All Connected Homes (BFS)" << endl;
+    cout << "\n  Phase 1: Finding All Connected Homes" << endl;
     cout << "============================================" << endl;
+    cout << "Connected homes found: " << plan.reachableCount << endl;
+    cout << "Surplus in this group: " << plan.groupSurplus << " W" << endl;
     
-    string allNeighbors[100];
-    int neighborCount = 0;
-    findAllNeighborsBFS(requestingHomeID, allNeighbors, neighborCount);
-    
-    if (neighborCount == 0) {
+    if (plan.reachableCount == 0) {
         cout << "\n  No connected homes found!" << endl;
         return;
     }
     
     cout << "\n  Phase 2: Identifying Energy Providers" << endl;
     cout << "============================================" << endl;
-    
-    struct Provider {
-        string homeID;
-        float excessEnergy;
-        float pathCost;
-        string path[100];
-        int pathLength;
-    };
-    
-    Provider providers[100];
-    int providerCount = 0;
-    
-    for (int i = 0; i < neighborCount; i++) {
-        Home** neighbor = homes.get(allNeighbors[i]);
-        if (!neighbor || *neighbor == nullptr) continue;
-        
-        (*neighbor)->updateEnergy();
-        
-        if ((*neighbor)->excessEnergy > 0) {
-            cout << "✓ " << allNeighbors[i] << " has " 
-                 << (*neighbor)->excessEnergy << " W excess" << endl;
-            
-            providers[providerCount].homeID = allNeighbors[i];
-            providers[providerCount].excessEnergy = (*neighbor)->excessEnergy;
-            providerCount++;
-        } else {
-            cout << "✗ " << allNeighbors[i] << " has deficit" << endl;
-        }
+    for (int i = 0; i < plan.providers.size(); i++) {
+        cout << "✓ " << idOf(plan.providers[i].homeIndex) << " has " 
+             << plan.providers[i].excessEnergy << " W excess" << endl;
+    }
+    int withoutSurplus = plan.reachableCount - plan.providers.size();
+    if (withoutSurplus > 0) {
+        cout << "✗ " << withoutSurplus << " other connected home(s) have no surplus" << endl;
     }
     
-    if (providerCount == 0) {
+    if (plan.providers.size() == 0) {
         cout << "\n  No providers with excess energy!" << endl;
         return;
     }
     
-    cout << "\n  Phase 3: Finding Cheapest Routes (Dijkstra)" << endl;
-    cout << "============================================" << endl;
-    
-    for (int i = 0; i < providerCount; i++) {
-        providers[i].pathCost = findCheapestPath(
-            requestingHomeID,
-            providers[i].homeID,
-            providers[i].path,
-            providers[i].pathLength
-        );
-    }
-    
-    cout << "\n  Phase 4: Ranking Providers by Cost" << endl;
+    cout << "\n  Phase 3/4: Cheapest Routes (Dijkstra) & Ranking" << endl;
     cout << "============================================" << endl;
-    
-    for (int i = 0; i < providerCount - 1; i++) {
-        for (int j = 0; j < providerCount - i - 1; j++) {
-            if (providers[j].pathCost > providers[j + 1].pathCost) {
-                Provider temp = providers[j];
-                providers[j] = providers[j + 1];
-                providers[j + 1] = temp;
-            }
-        }
-    }
-    
     cout << "\nRank\tHome\tExcess(W)\tCost(Rs)" << endl;
     cout << "----------------------------------------" << endl;
-    for (int i = 0; i < providerCount; i++) {
-        cout << (i+1) << "\t" << providers[i].homeID << "\t"
-             << providers[i].excessEnergy << "\t\t"
-             << providers[i].pathCost << endl;
+    for (int i = 0; i < plan.providers.size(); i++) {
+        cout << (i+1) << "\t" << idOf(plan.providers[i].homeIndex) << "\t"
+             << plan.providers[i].excessEnergy << "\t\t"
+             << plan.providers[i].pathCost << endl;
     }
     
     cout << "\n Phase 5: Optimal Energy Distribution" << endl;
     cout << "============================================" << endl;
     
-    float remainingNeed = requiredEnergy;
-    float totalCost = 0;
-    int transferCount = 0;
-    
-    for (int i = 0; i < providerCount && remainingNeed > 0; i++) {
-        float energyFromProvider = (providers[i].excessEnergy < remainingNeed)
-                                    ? providers[i].excessEnergy : remainingNeed;
-        
-        float transferCost = (energyFromProvider / 1000.0f) * providers[i].pathCost;
-        
-        cout << "\n Transfer #" << (++transferCount) << ":" << endl;
-        cout << "   From: " << providers[i].homeID << endl;
-        cout << "   Energy: " << energyFromProvider << " W" << endl;
+    for (int i = 0; i < plan.transfers.size(); i++) {
+        const SharingTransfer& t = plan.transfers[i];
+        cout << "\n Transfer #" << (i + 1) << ":" << endl;
+        cout << "   From: " << idOf(t.providerIndex) << endl;
+        cout << "   Energy: " << t.energy << " W" << endl;
         cout << "   Route: ";
-        for (int j = 0; j < providers[i].pathLength; j++) {
-            cout << providers[i].path[j];
-            if (j < providers[i].pathLength - 1) cout << " -> ";
+        // parent[] walks provider -> requester; print it requester first
+        int hops = 0;
+        for (int v = t.providerIndex; v != -1; v = plan.parent[v]) hops++;
+        int* route = new int[hops];
+        int k = hops;
+        for (int v = t.providerIndex; v != -1; v = plan.parent[v]) route[--k] = v;
+        for (int j = 0; j < hops; j++) {
+            cout << idOf(route[j]);
+            if (j < hops - 1) cout << " -> ";
         }
+        delete[] route;
         cout << endl;
-        cout << "   Cost: Rs " << transferCost << endl;
-        
-        remainingNeed -= energyFromProvider;
-        totalCost += transferCost;
-        
-        Home** provider = homes.get(providers[i].homeID);
-        if (provider && *provider) {
-            (*provider)->excessEnergy -= energyFromProvider;
-            (*provider)->batteryLevel -= energyFromProvider;
-        }
+        cout << "   Cost: Rs " << t.cost << endl;
     }
     
+    float remainingNeed = plan.requestedEnergy - plan.energyReceived;
     cout << "\n  SUMMARY" << endl;
     cout << "============================================" << endl;
-    cout << "Requested Energy: " << requiredEnergy << " W" << endl;
-    cout << "Energy Received: " << (requiredEnergy - remainingNeed) << " W" << endl;
+    cout << "Requested Energy: " << plan.requestedEnergy << " W" << endl;
+    cout << "Energy Received: " << plan.energyReceived << " W" << endl;
+    
+    if (plan.heldBackByTransformers > 0) {
+        cout << "Held back by transformer ratings: " << plan.heldBackByTransformers << " W" << endl;
+    }
     
     if (remainingNeed > 0) {
         cout << "   Still Need: " << remainingNeed << " W (buy from grid)" << endl;
@@ -348,16 +791,468 @@ void CommunityGraph::findEnergySharing(string requestingHomeID, float requiredEn
     
     cout << "\n  COST ANALYSIS" << endl;
     cout << "============================================" << endl;
-    cout << "Community Cost: Rs " << totalCost << endl;
+    cout << "Community Cost: Rs " << plan.communityCost << endl;
+    cout << "Grid Cost: Rs " << plan.gridCost << endl;
     
-    float gridCost = (requiredEnergy / 1000.0f) * 20.0f;
-    cout << "Grid Cost: Rs " << gridCost << endl;
-    
-    float savings = gridCost - totalCost;
+    float savings = plan.gridCost - plan.communityCost;
     cout << "\n  You SAVED: Rs " << savings << " (" 
-         << (gridCost > 0 ? (savings / gridCost * 100) : 0) << "%)" << endl;
+         << (plan.gridCost > 0 ? (savings / plan.gridCost * 100) : 0) << "%)" << endl;
     
     cout << "\n############################################" << endl;
 }
 
+void CommunityGraph::findEnergySharing(string requestingHomeID, float requiredEnergy) {
+    beginSharingInterval();
+    SharingPlan plan = planEnergySharing(requestingHomeID, requiredEnergy);
+    commitSharingPlan(plan);
+    printSharingPlan(plan);
+}
+
+// Console renderer for trace events (same wording as the old inline output)
+void ConsoleTrace::record(const TraceEvent& event) {
+    switch (event.type) {
+        case TRACE_BFS_VISIT:
+            cout << "BFS level " << (int)event.value << ": " << graph->idOf(event.home)
+                 << " (via " << graph->idOf(event.other) << ")" << endl;
+            break;
+        case TRACE_SETTLE:
+            cout << "Visiting: " << graph->idOf(event.home) << " (Cost: " << event.value << ")" << endl;
+            break;
+        case TRACE_RELAX:
+            cout << "  Updated " << graph->idOf(event.home) << " cost to " << event.value << endl;
+            break;
+        case TRACE_PROVIDER:
+            cout << "Provider " << graph->idOf(event.home) << ": " << event.value << " W excess" << endl;
+            break;
+        case TRACE_TRANSFER:
+            cout << "Transfer " << event.value << " W: " << graph->idOf(event.home)
+                 << " -> " << graph->idOf(event.other) << endl;
+            break;
+    }
+}
+
+DispatchPlan CommunityGraph::planDispatch(const EnergyDemand* demands, int demandCount) {
+    DispatchPlan plan;
+    int n = homeList.size();
+    int m = edgeList.size();
+    int source = n, sink = n + 1;
+    MinCostFlow flow(n + 2);
+    
+    // Edge e owns arcs 4e (from -> to) and 4e + 2 (to -> from)
+    for (int e = 0; e < m; e++) {
+        const GraphEdge& edge = edgeList[e];
+        float unit = edge.unitCost();
+        flow.addArc(edge.from, edge.to, edge.capacity, unit);
+        flow.addArc(edge.to, edge.from, edge.capacity, unit);
+    }
+    
+    bool* isRequester = new bool[n + 2]();      // indexed like the flow nodes
+    int* demandArc = new int[demandCount];
+    for (int d = 0; d < demandCount; d++) {
+        isRequester[demands[d].homeIndex] = true;
+        demandArc[d] = flow.addArc(demands[d].homeIndex, sink, demands[d].energy, 0);
+        plan.requested += demands[d].energy;
+    }
+    for (int i = 0; i < n; i++) {
+        if (isRequester[i]) continue;
+        refreshHomeEnergy(i);
+        Home* home = homeList[i];
+        if (home->excessEnergy > 0) {
+            flow.addArc(source, i, home->excessEnergy, 0);
+            emit(TRACE_PROVIDER, i, -1, home->excessEnergy);
+        }
+    }
+    
+    float rawCost = 0;
+    plan.delivered = flow.solve(source, sink, GRID_PRICE_PER_KWH, rawCost, &plan.augmentations);
+    plan.communityCost = rawCost / 1000.0f;
+    plan.gridCost = (plan.requested / 1000.0f) * GRID_PRICE_PER_KWH;
+    
+    plan.edgeFlow.resize(m);
+    for (int e = 0; e < m; e++) {
+        plan.edgeFlow[e] = flow.flowOn(4 * e) - flow.flowOn(4 * e + 2);
+    }
+    plan.unmet.resize(demandCount);
+    for (int d = 0; d < demandCount; d++) {
+        plan.unmet[d] = demands[d].energy - flow.flowOn(demandArc[d]);
+    }
+    
+    // Decompose into provider -> requester transfers: source, provider, ..., requester, sink
+    DynamicArray<int> path, arcPath;
+    float amount;
+    while ((amount = flow.nextFlowPath(source, sink, path, &arcPath)) > 0) {
+        DispatchTransfer t;
+        t.provider = path[1];
+        t.requester = path[path.size() - 2];
+        t.energy = amount;
+        float unit = 0;
+        for (int i = 1; i < arcPath.size() - 1; i++) {   // skip source / sink arcs
+            unit += edgeList[arcPath[i] / 4].unitCost();
+        }
+        t.cost = (amount / 1000.0f) * unit;
+        t.pathStart = plan.pathNodes.size();
+        t.pathLength = path.size() - 2;
+        for (int i = 1; i < path.size() - 1; i++) plan.pathNodes.push(path[i]);
+        plan.transfers.push(t);
+        emit(TRACE_TRANSFER, t.provider, t.requester, t.energy);
+    }
+    
+    delete[] isRequester;
+    delete[] demandArc;
+    return plan;
+}
+
+void CommunityGraph::commitDispatchPlan(const DispatchPlan& plan) {
+    for (int i = 0; i < plan.transfers.size(); i++) {
+        int p = plan.transfers[i].provider;
+        setHomeExcess(p, homeList[p]->excessEnergy - plan.transfers[i].energy);
+    }
+}
+
+void CommunityGraph::printDispatchPlan(const DispatchPlan& plan) {
+    cout << "\n############################################" << endl;
+    cout << "#   COMMUNITY DISPATCH (MIN-COST FLOW)     #" << endl;
+    cout << "############################################" << endl;
+    
+    if (plan.transfers.size() == 0) {
+        cout << "\n  Nothing could be routed (no providers, no capacity, or grid is cheaper)." << endl;
+    }
+    
+    for (int i = 0; i < plan.transfers.size(); i++) {
+        const DispatchTransfer& t = plan.transfers[i];
+        cout << "\n Transfer #" << (i + 1) << ": " << idOf(t.provider) << " -> " << idOf(t.requester) << endl;
+        cout << "   Energy: " << t.energy << " W" << endl;
+        cout << "   Route: ";
+        for (int j = 0; j < t.pathLength; j++) {
+            cout << idOf(plan.pathNodes[t.pathStart + j]);
+            if (j < t.pathLength - 1) cout << " -> ";
+        }
+        cout << endl;
+        cout << "   Cost: Rs " << t.cost << endl;
+    }
+    
+    bool anySaturated = false;
+    for (int e = 0; e < plan.edgeFlow.size(); e++) {
+        const GraphEdge& edge = edgeList[e];
+        float f = plan.edgeFlow[e] < 0 ? -plan.edgeFlow[e] : plan.edgeFlow[e];
+        if (edge.capacity < UNLIMITED_CAPACITY && f >= edge.capacity - MinCostFlow::EPS) {
+            if (!anySaturated) cout << "\n  Lines at capacity:" << endl;
+            anySaturated = true;
+            cout << "   " << idOf(edge.from) << " - " << idOf(edge.to) << " (" << edge.capacity << " W)" << endl;
+        }
+    }
+    
+    cout << "\n  SUMMARY" << endl;
+    cout << "============================================" << endl;
+    cout << "Requested Energy: " << plan.requested << " W" << endl;
+    cout << "Delivered by Community: " << plan.delivered << " W" << endl;
+    if (plan.requested - plan.delivered > MinCostFlow::EPS) {
+        cout << "   From Grid: " << (plan.requested - plan.delivered) << " W" << endl;
+    }
+    float gridForRest = ((plan.requested - plan.delivered) / 1000.0f) * GRID_PRICE_PER_KWH;
+    cout << "Community Cost: Rs " << plan.communityCost << " (+ Rs " << gridForRest << " grid)" << endl;
+    cout << "All-Grid Cost: Rs " << plan.gridCost << endl;
+    cout << "\n  You SAVED: Rs " << (plan.gridCost - plan.communityCost - gridForRest) << endl;
+    cout << "\n############################################" << endl;
+}
+
+void CommunityGraph::dispatchAllDeficits() {
+    beginSharingInterval();
+    DynamicArray<EnergyDemand> demands;
+    for (int i = 0; i < homeList.size(); i++) {
+        refreshHomeEnergy(i);
+        Home* home = homeList[i];
+        if (home->excessEnergy < 0) {
+            EnergyDemand d;
+            d.homeIndex = i;
+            d.energy = -home->excessEnergy;
+            demands.push(d);
+        }
+    }
+    if (demands.size() == 0) {
+        cout << "\n  No home is in deficit right now." << endl;
+        return;
+    }
+    
+    DispatchPlan plan = planDispatch(demands.raw(), demands.size());
+    commitDispatchPlan(plan);
+    printDispatchPlan(plan);
+}
+
+// ---------------- DistanceOracle ----------------
+
+DistanceOracle::DistanceOracle(CommunityGraph* g, int maxTrees)
+    : graph(g), capacity(0), trees(nullptr), prevSlot(nullptr), nextSlot(nullptr),
+      mru(-1), lru(-1), usedSlots(0), seenEdges(0), labels(nullptr), labelCount(0),
+      hits(0), misses(0), invalidations(0) {
+    setCapacity(maxTrees);
+}
 
+DistanceOracle::~DistanceOracle() {
+    for (int i = 0; i < usedSlots; i++) {
+        delete[] trees[i].dist;
+        delete[] trees[i].parent;
+    }
+    delete[] trees;
+    delete[] prevSlot;
+    delete[] nextSlot;
+    freeLabels();
+}
+
+void DistanceOracle::setCapacity(int maxTrees) {
+    clear();
+    delete[] trees;
+    delete[] prevSlot;
+    delete[] nextSlot;
+    capacity = maxTrees > 0 ? maxTrees : 1;
+    trees = new ShortestPathTree[capacity];
+    prevSlot = new int[capacity];
+    nextSlot = new int[capacity];
+}
+
+void DistanceOracle::unlink(int slot) {
+    if (prevSlot[slot] != -1) nextSlot[prevSlot[slot]] = nextSlot[slot];
+    else mru = nextSlot[slot];
+    if (nextSlot[slot] != -1) prevSlot[nextSlot[slot]] = prevSlot[slot];
+    else lru = prevSlot[slot];
+}
+
+void DistanceOracle::pushFront(int slot) {
+    prevSlot[slot] = -1;
+    nextSlot[slot] = mru;
+    if (mru != -1) prevSlot[mru] = slot;
+    mru = slot;
+    if (lru == -1) lru = slot;
+}
+
+// Frees a slot by moving the last used slot into it (keeps slots 0..used-1 dense)
+void DistanceOracle::dropSlot(int slot) {
+    unlink(slot);
+    slotOf[trees[slot].source] = -1;
+    delete[] trees[slot].dist;
+    delete[] trees[slot].parent;
+    
+    int last = --usedSlots;
+    if (slot != last) {
+        trees[slot] = trees[last];
+        slotOf[trees[slot].source] = slot;
+        prevSlot[slot] = prevSlot[last];
+        nextSlot[slot] = nextSlot[last];
+        if (prevSlot[slot] != -1) nextSlot[prevSlot[slot]] = slot; else mru = slot;
+        if (nextSlot[slot] != -1) prevSlot[nextSlot[slot]] = slot; else lru = slot;
+    }
+    trees[last] = ShortestPathTree();
+}
+
+void DistanceOracle::freeLabels() {
+    delete[] labels;
+    labels = nullptr;
+    labelCount = 0;
+}
+
+void DistanceOracle::clear() {
+    while (usedSlots > 0) dropSlot(usedSlots - 1);
+    mru = lru = -1;
+    freeLabels();
+}
+
+void DistanceOracle::sync() {
+    int m = graph->getEdgeCount();
+    if (seenEdges == m) return;
+    if (labels) freeLabels();             // labels can't be patched, rebuild on demand
+    
+    for (int e = seenEdges; e < m; e++) {
+        const GraphEdge& edge = graph->getEdge(e);
+        float w = edge.unitCost();
+        for (int s = usedSlots - 1; s >= 0; s--) {
+            const ShortestPathTree& t = trees[s];
+            float da = edge.from < t.size ? t.dist[edge.from] : UNREACHABLE;
+            float db = edge.to < t.size ? t.dist[edge.to] : UNREACHABLE;
+            if (da + w < db || db + w < da) {
+                dropSlot(s);
+                invalidations++;
+            }
+        }
+    }
+    seenEdges = m;
+}
+
+bool DistanceOracle::hasTree(int source) {
+    sync();
+    return source < slotOf.size() && slotOf[source] != -1;
+}
+
+const ShortestPathTree* DistanceOracle::tree(int source) {
+    sync();
+    int n = graph->getHomeCount();
+    while (slotOf.size() < n) slotOf.push(-1);
+    
+    int slot = slotOf[source];
+    if (slot != -1) {
+        ShortestPathTree& t = trees[slot];
+        if (t.size < n) {
+            // Homes added since: sync() kept this tree, so no new edge reaches them
+            float* dist = new float[n];
+            int* parent = new int[n];
+            for (int i = 0; i < t.size; i++) {
+                dist[i] = t.dist[i];
+                parent[i] = t.parent[i];
+            }
+            for (int i = t.size; i < n; i++) {
+                dist[i] = UNREACHABLE;
+                parent[i] = -1;
+            }
+            delete[] t.dist;
+            delete[] t.parent;
+            t.dist = dist;
+            t.parent = parent;
+            t.size = n;
+        }
+        hits++;
+        if (mru != slot) {
+            unlink(slot);
+            pushFront(slot);
+        }
+        return &t;
+    }
+    
+    misses++;
+    if (usedSlots == capacity) dropSlot(lru);
+    slot = usedSlots++;
+    ShortestPathTree& t = trees[slot];
+    t.source = source;
+    t.size = n;
+    t.dist = new float[n];
+    t.parent = new int[n];
+    graph->computeShortestPaths(source, t.dist, t.parent);
+    slotOf[source] = slot;
+    pushFront(slot);
+    return &t;
+}
+
+float DistanceOracle::cost(int from, int to) {
+    sync();
+    if (labels && from < labelCount && to < labelCount) {
+        hits++;
+        return labelQuery(from, to);
+    }
+    // Costs are symmetric, so a cached tree of either end will do
+    if (to < slotOf.size() && slotOf[to] != -1 && from < trees[slotOf[to]].size) {
+        return tree(to)->dist[from];
+    }
+    const ShortestPathTree* t = tree(from);
+    return t->dist[to];
+}
+
+float DistanceOracle::labelQuery(int a, int b) const {
+    const DynamicArray<HubEntry>& la = labels[a];
+    const DynamicArray<HubEntry>& lb = labels[b];
+    float best = UNREACHABLE;
+    int i = 0, j = 0;
+    while (i < la.size() && j < lb.size()) {
+        if (la[i].hub == lb[j].hub) {
+            float d = la[i].dist + lb[j].dist;
+            if (d < best) best = d;
+            i++;
+            j++;
+        } else if (la[i].hub < lb[j].hub) {
+            i++;
+        } else {
+            j++;
+        }
+    }
+    return best;
+}
+
+// Pruned landmark labeling: run Dijkstra from each home in order of
+// decreasing degree, but stop expanding wherever the labels built so far
+// already give a path at least as short. High-degree hubs cover most pairs,
+// so later searches die out quickly.
+void DistanceOracle::buildHubLabels() {
+    sync();
+    freeLabels();
+    int n = graph->getHomeCount();
+    const int* offsets = graph->getCSROffsets();
+    const int* targets = graph->getCSRTargets();
+    const float* weights = graph->getCSRWeights();
+    
+    // Rank homes by degree (counting sort, highest first)
+    int maxDegree = 0;
+    for (int v = 0; v < n; v++) {
+        int d = offsets[v + 1] - offsets[v];
+        if (d > maxDegree) maxDegree = d;
+    }
+    int* bucketStart = new int[maxDegree + 2]();
+    for (int v = 0; v < n; v++) bucketStart[maxDegree - (offsets[v + 1] - offsets[v]) + 1]++;
+    for (int d = 1; d <= maxDegree + 1; d++) bucketStart[d] += bucketStart[d - 1];
+    int* order = new int[n];
+    for (int v = 0; v < n; v++) order[bucketStart[maxDegree - (offsets[v + 1] - offsets[v])]++] = v;
+    delete[] bucketStart;
+    
+    labels = new DynamicArray<HubEntry>[n > 0 ? n : 1];
+    labelCount = n;
+    float* dist = new float[n];
+    float* hubDist = new float[n];        // hubDist[rank] = cost from current root to that hub
+    for (int i = 0; i < n; i++) {
+        dist[i] = UNREACHABLE;
+        hubDist[i] = UNREACHABLE;
+    }
+    IndexedMinHeap pq(n);
+    int* touched = new int[n];
+    
+    for (int rank = 0; rank < n; rank++) {
+        int root = order[rank];
+        for (int k = 0; k < labels[root].size(); k++) {
+            hubDist[labels[root][k].hub] = labels[root][k].dist;
+        }
+        
+        int touchedCount = 0;
+        dist[root] = 0;
+        touched[touchedCount++] = root;
+        pq.pushOrDecrease(root, 0);
+        while (!pq.isEmpty()) {
+            int u = pq.popMin();
+            float du = dist[u];
+            
+            // Prune if an earlier hub already covers root -> u
+            bool pruned = false;
+            for (int k = 0; k < labels[u].size(); k++) {
+                float via = hubDist[labels[u][k].hub];
+                if (via < UNREACHABLE && via + labels[u][k].dist <= du) {
+                    pruned = true;
+                    break;
+                }
+            }
+            if (pruned) continue;
+            
+            HubEntry entry;
+            entry.hub = rank;
+            entry.dist = du;
+            labels[u].push(entry);
+            
+            for (int e = offsets[u]; e < offsets[u + 1]; e++) {
+                int v = targets[e];
+                float nd = du + weights[e];
+                if (nd < dist[v]) {
+                    if (dist[v] >= UNREACHABLE) touched[touchedCount++] = v;
+                    dist[v] = nd;
+                    pq.pushOrDecrease(v, nd);
+                }
+            }
+        }
+        
+        for (int i = 0; i < touchedCount; i++) dist[touched[i]] = UNREACHABLE;
+        for (int k = 0; k < labels[root].size(); k++) hubDist[labels[root][k].hub] = UNREACHABLE;
+    }
+    
+    delete[] order;
+    delete[] dist;
+    delete[] hubDist;
+    delete[] touched;
+}
+
+long long DistanceOracle::hubLabelEntries() const {
+    long long total = 0;
+    for (int i = 0; i < labelCount; i++) total += labels[i].size();
+    return total;
+}
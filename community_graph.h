@@ -4,8 +4,37 @@
 #include <iostream>
 #include <string>
 #include "hashmap.h"
+#include "dynamic_array.h"
+#include "indexed_heap.h"
+#include "graph_trace.h"
+#include "min_cost_flow.h"
+#include "distance_oracle.h"
+#include "thread_pool.h"
+#include "component_index.h"
+#include "provider_index.h"
+#include "spatial_index.h"
+#include "path_search.h"
+#include "grid_topology.h"
 using namespace std;
 
+const float COST_PER_KM = 5.0f;          // Rs per km of line used for a transfer
+const float UNREACHABLE = 1e30f;         // distance of homes with no path
+const float GRID_PRICE_PER_KWH = 20.0f;  // Rs, used for the savings comparison
+const float UNLIMITED_CAPACITY = MinCostFlow::UNLIMITED;   // line with no rating (W)
+const float HEURISTIC_SLACK = 0.999f;    // keeps the A* bound below float-rounded edge costs
+
+// Home battery. batteryLevel on Home is the stored energy (Wh) in it.
+struct BatterySpec {
+    float capacityWh;
+    float maxChargeW;         // drawn from the home's supply while charging
+    float maxDischargeW;      // delivered to the home while discharging
+    float efficiency;         // one-way (charge and discharge each lose 1 - efficiency)
+    
+    BatterySpec() : capacityWh(0), maxChargeW(0), maxDischargeW(0), efficiency(1) {}
+    BatterySpec(float capacity, float chargeW, float dischargeW, float eff)
+        : capacityWh(capacity), maxChargeW(chargeW), maxDischargeW(dischargeW), efficiency(eff) {}
+};
+
 struct Home {
     string homeID;
     string address;
@@ -13,127 +42,413 @@ struct Home {
     float currentConsumption;
     float excessEnergy;
     float batteryLevel;
+    BatterySpec battery;
+    bool hasLocation;     // optional map position, km on a flat projection
+    float x;
+    float y;
     
     Home() : currentProduction(0), currentConsumption(0), 
-             excessEnergy(0), batteryLevel(0) {}
+             excessEnergy(0), batteryLevel(0), hasLocation(false), x(0), y(0) {}
     
+    // Without an explicit spec the battery is taken to be full at `battery`
+    // Wh, charging / discharging at C/2 with 95% efficiency each way
     Home(string id, string addr, float prod, float cons, float battery)
         : homeID(id), address(addr), currentProduction(prod), 
-          currentConsumption(cons), batteryLevel(battery) {
+          currentConsumption(cons), batteryLevel(battery),
+          battery(battery > 0 ? battery : 0, battery / 2, battery / 2, 0.95f),
+          hasLocation(false), x(0), y(0) {
         excessEnergy = prod - cons;
     }
     
+    void setBattery(const BatterySpec& spec) {
+        battery = spec;
+        if (batteryLevel > spec.capacityWh) batteryLevel = spec.capacityWh;
+    }
+    
+    // Once the home is in a CommunityGraph, use setHomeLocation instead
+    void setLocation(float px, float py) {
+        hasLocation = true;
+        x = px;
+        y = py;
+    }
+    
     void updateEnergy() {   // Recalculate excess energy
         excessEnergy = currentProduction - currentConsumption;
     }
 };
 
+// One connection as added by connectHomes (undirected, dense home indices).
+// capacity is the line rating in W (per direction); lossFraction is the
+// share of the energy lost on the line, priced at the grid rate.
 struct GraphEdge {
-    string neighborID;
+    int from;
+    int to;
     float distance;
-    GraphEdge* next;
+    float capacity;
+    float lossFraction;
+    
+    GraphEdge() : from(-1), to(-1), distance(0), capacity(UNLIMITED_CAPACITY), lossFraction(0) {}
+    GraphEdge(int a, int b, float dist, float cap = UNLIMITED_CAPACITY, float loss = 0)
+        : from(a), to(b), distance(dist), capacity(cap), lossFraction(loss) {}
     
-    GraphEdge(string id, float dist) : neighborID(id), distance(dist), next(nullptr) {}
+    // Rs per kWh moved across this line: distance charge + lost energy bought back
+    float unitCost() const { return distance * COST_PER_KM + lossFraction * GRID_PRICE_PER_KWH; }
 };
 
-class BFSQueue {
-private:
-    string data[100];
-    int front, rear;
-    
-public:
-    BFSQueue() : front(0), rear(0) {}
-    
-    void enqueue(string item) {
-        if (rear < 100) {
-            data[rear++] = item;
-        }
-    }
-    
-    string dequeue() {
-        if (front < rear) {
-            return data[front++];
-        }
-        return "";
-    }
+// BFS strategy. TOP_DOWN expands the frontier edge by edge; BOTTOM_UP lets
+// every unvisited home look for a parent in the frontier, which is cheaper
+// once the frontier covers a large part of a dense graph. AUTO switches
+// between the two per level (direction-optimizing BFS).
+enum BFSMode { BFS_TOP_DOWN, BFS_BOTTOM_UP, BFS_AUTO };
+
+// Result of planning one energy request; produced silently by
+// planEnergySharing and rendered by printSharingPlan (or any other caller).
+struct SharingProvider {
+    int homeIndex;
+    float excessEnergy;
+    float pathCost;       // Rs per kWh along the cheapest route to the requester
+};
+
+struct SharingTransfer {
+    int providerIndex;    // dense home index of the provider
+    float energy;         // W
+    float cost;           // Rs
+};
+
+struct SharingPlan {
+    int requester;                          // -1 if the home does not exist
+    float requestedEnergy;
+    int reachableCount;                     // connected homes, excluding the requester
+    float groupSurplus;                     // total surplus of the requester's component
+    DynamicArray<SharingProvider> providers;   // ranked by path cost
+    DynamicArray<SharingTransfer> transfers;
+    DynamicArray<int> parent;               // shortest-path tree rooted at the requester
+    float energyReceived;
+    float communityCost;
+    float gridCost;
+    float heldBackByTransformers;           // surplus providers could not send (ratings)
     
-    bool isEmpty() {
-        return front >= rear;
-    }
+    SharingPlan() : requester(-1), requestedEnergy(0), reachableCount(0), groupSurplus(0),
+                    energyReceived(0), communityCost(0), gridCost(0), heldBackByTransformers(0) {}
+};
+
+// Community-wide dispatch: many requesters served in one min-cost flow solve
+struct EnergyDemand {
+    int homeIndex;
+    float energy;         // W
+};
+
+struct DispatchTransfer {
+    int provider;
+    int requester;
+    float energy;         // W
+    float cost;           // Rs
+    int pathStart;        // route (provider first) in DispatchPlan::pathNodes
+    int pathLength;
+};
+
+struct DispatchPlan {
+    DynamicArray<DispatchTransfer> transfers;
+    DynamicArray<int> pathNodes;
+    DynamicArray<float> edgeFlow;           // per edge, + means from -> to
+    DynamicArray<float> unmet;              // per demand, W left for the grid
+    float requested;
+    float delivered;
+    float communityCost;
+    float gridCost;                         // cost of buying `requested` from the grid
+    int augmentations;
     
-    int getSize() {
-        return rear - front;
-    }
+    DispatchPlan() : requested(0), delivered(0), communityCost(0), gridCost(0), augmentations(0) {}
 };
 
+// Home IDs are interned to dense indices 0..n-1 when added. Adjacency is kept
+// in compressed-sparse-row form: the neighbors of home u are
+//   csrTargets[csrOffsets[u] .. csrOffsets[u+1])  with weights in csrWeights
+// (each line's unitCost(), so every path query prices losses the way
+// planDispatch does)
+// so a traversal walks contiguous int/float arrays instead of hashing string
+// IDs and chasing linked-list nodes. connectHomes appends to edgeList and
+// marks the CSR dirty; it is rebuilt (O(V + E)) before the next traversal.
 class CommunityGraph {
 private:
-    HashMap<string, Home*> homes;
-    HashMap<string, GraphEdge*> adjacencyList;
+    HashMap<string, int> homeIndex;       // homeID -> dense index
+    DynamicArray<Home*> homeList;         // dense index -> Home
+    DynamicArray<GraphEdge> edgeList;     // every connection, in insertion order
     int homeCount;
     
-    int hashHomeID(const string& id) {
-        unsigned int h = hashString(id);
-        return h % 100;
+    // CSR adjacency (each undirected edge stored in both directions)
+    int* csrOffsets;
+    int* csrTargets;
+    float* csrWeights;
+    bool csrDirty;
+    
+    TraceSink* trace;                     // optional, nullptr = silent
+    
+    DistanceOracle oracle;                // cached shortest-path trees / hub labels
+    ComponentIndex components;            // connectivity + per-component excess totals
+    ProviderIndex providers;              // surplus homes per component, largest first
+    SpatialIndex spatial;                 // located homes, rebuilt lazily
+    bool spatialDirty;                    // homes, locations or edges changed
+    bool geographic;                      // every home located, no line shorter than the crow flies
+    GridTopology* gridTopology;           // optional transformer tree, not owned
+    SearchSpace forwardSpace;             // point-to-point search scratch
+    SearchSpace backwardSpace;
+    
+    void rebuildCSR();
+    void rebuildSpatial();
+    void searchToTarget(int source, int target, bool useHeuristic, PathQuery& query);
+    void searchBidirectional(int source, int target, PathQuery& query);
+    
+    void emit(TraceEventType type, int home, int other, float value) {
+        if (trace) trace->record(TraceEvent(type, home, other, value));
     }
     
 public:
-    CommunityGraph() : homeCount(0) {}
+    CommunityGraph() : homeCount(0), csrOffsets(nullptr), csrTargets(nullptr),
+                       csrWeights(nullptr), csrDirty(true), trace(nullptr), oracle(this),
+                       spatialDirty(true), geographic(false), gridTopology(nullptr) {}
     
     ~CommunityGraph() {
-        string keys[100];
-        int keyCount;
-        adjacencyList.getAllKeys(keys, keyCount);
-        
-        for (int i = 0; i < keyCount; i++) {
-            GraphEdge** edgePtr = adjacencyList.get(keys[i]);
-            if (edgePtr && *edgePtr) {
-                GraphEdge* current = *edgePtr;
-                while (current != nullptr) {
-                    GraphEdge* temp = current;
-                    current = current->next;
-                    delete temp;
-                }
-            }
-        }
+        delete[] csrOffsets;
+        delete[] csrTargets;
+        delete[] csrWeights;
     }
     
     void addHome(Home* home) {
-        homes.insert(home->homeID, home);
-        adjacencyList.insert(home->homeID, nullptr);
-        homeCount++;
+        bool added;
+        int index = *homeIndex.getOrInsert(home->homeID, homeList.size(), added);
+        if (!added) {
+            homeList[index] = home;            // same ID re-added: replace the record
+            setHomeExcess(index, home->excessEnergy);
+        } else {
+            homeList.push(home);
+            components.add(home->excessEnergy);
+            providers.add(home->excessEnergy);
+            homeCount++;
+            csrDirty = true;
+        }
+        spatialDirty = true;
     }
     
-    void connectHomes(string home1, string home2, float distance) {
-        GraphEdge** list1 = adjacencyList.get(home1);
-        if (list1) {
-            GraphEdge* newEdge = new GraphEdge(home2, distance);
-            newEdge->next = *list1;
-            *list1 = newEdge;
-        }
-        
-        GraphEdge** list2 = adjacencyList.get(home2);
-        if (list2) {
-            GraphEdge* newEdge = new GraphEdge(home1, distance);
-            newEdge->next = *list2;
-            *list2 = newEdge;
+    void connectHomes(string home1, string home2, float distance,
+                      float capacity = UNLIMITED_CAPACITY, float lossFraction = 0) {
+        int a = indexOf(home1);
+        int b = indexOf(home2);
+        if (a == -1 || b == -1) return;
+        connectHomesByIndex(a, b, distance, capacity, lossFraction);
+    }
+    
+    // Room for this many homes / lines up front (bulk loads)
+    void reserve(int homeTotal, int edgeTotal) {
+        homeIndex.reserve(homeTotal);
+        homeList.reserve(homeTotal);
+        edgeList.reserve(edgeTotal);
+    }
+    
+    // Same as connectHomes for callers that already hold dense indices (bulk loads)
+    void connectHomesByIndex(int a, int b, float distance,
+                             float capacity = UNLIMITED_CAPACITY, float lossFraction = 0) {
+        edgeList.push(GraphEdge(a, b, distance, capacity, lossFraction));
+        int ra = components.find(a), rb = components.find(b);
+        if (components.unite(a, b)) {
+            int root = components.find(a);
+            providers.merge(root, root == ra ? rb : ra);
         }
+        csrDirty = true;
+        spatialDirty = true;
+    }
+    
+    // Transformer / feeder tree the homes hang off (nullptr to detach).
+    // Pushes every home's current excess into it; sharing then respects
+    // the node ratings.
+    void attachGrid(GridTopology* grid) {
+        gridTopology = grid;
+        if (!grid) return;
+        for (int i = 0; i < homeList.size(); i++) grid->setHomeExcess(i, homeList[i]->excessEnergy);
     }
+    GridTopology* getGrid() { return gridTopology; }
     
     // ← NEW METHOD: Get a specific home
     Home** getHome(string homeID) {
-        return homes.get(homeID);
+        int* idx = homeIndex.get(homeID);
+        return idx ? &homeList[*idx] : nullptr;
+    }
+    
+    // Attach a trace sink (RingBufferTrace, ConsoleTrace, ...) or nullptr for silence
+    void setTraceSink(TraceSink* sink) { trace = sink; }
+    TraceSink* getTraceSink() { return trace; }
+    
+    // ---- Connectivity (no BFS needed) ----
+    bool areConnected(const string& home1, const string& home2) {
+        int a = indexOf(home1), b = indexOf(home2);
+        return a != -1 && b != -1 && components.connected(a, b);
+    }
+    ComponentIndex& getComponents() { return components; }
+    
+    // Change a home's excess through these so component totals and the
+    // provider index stay current
+    void setHomeExcess(int i, float excess) {
+        homeList[i]->excessEnergy = excess;
+        components.setValue(i, excess);
+        providers.update(i, components.find(i), excess);
+        if (gridTopology) gridTopology->setHomeExcess(i, excess);
+    }
+    void refreshHomeEnergy(int i) {
+        homeList[i]->updateEnergy();
+        setHomeExcess(i, homeList[i]->excessEnergy);
+    }
+    Home* updateHomeConsumption(const string& homeID, float consumption) {
+        int i = indexOf(homeID);
+        if (i == -1) return nullptr;
+        homeList[i]->currentConsumption = consumption;
+        refreshHomeEnergy(i);
+        return homeList[i];
+    }
+    Home* updateHomeProduction(const string& homeID, float production) {
+        int i = indexOf(homeID);
+        if (i == -1) return nullptr;
+        homeList[i]->currentProduction = production;
+        refreshHomeEnergy(i);
+        return homeList[i];
+    }
+    
+    // Up to k homes with the largest surplus in home i's component (largest
+    // first, may include i itself). O(k log k).
+    int topProviders(int i, int k, int* out) {
+        return providers.topK(components.find(i), k, out);
+    }
+    
+    // ---- Locations (optional) ----
+    bool setHomeLocation(const string& homeID, float x, float y) {
+        int i = indexOf(homeID);
+        if (i == -1) return false;
+        homeList[i]->setLocation(x, y);
+        spatialDirty = true;
+        return true;
+    }
+    void ensureSpatial() {
+        if (spatialDirty) rebuildSpatial();
+    }
+    
+    // Up to k located homes closest to home i in a straight line (i itself
+    // excluded), closest first. distKm (optional) gets the distances.
+    int nearestHomes(int i, int k, int* out, float* distKm = nullptr);
+    
+    // Located homes within radiusKm of home i (i excluded), any order
+    void homesWithinRadius(int i, float radiusKm, DynamicArray<int>& out);
+    
+    // Up to k homes with surplus in home i's component within radiusKm of
+    // it, closest first (k <= 0: all of them). Candidate filter for sharing.
+    int nearestProviders(int i, float radiusKm, int k, int* out);
+    
+    // True when every home has a location and no line is shorter than the
+    // straight distance between its ends; then heuristicCost() never
+    // overestimates and A* may use it.
+    bool hasGeographicHeuristic() {
+        ensureSpatial();
+        return geographic;
     }
     
+    // Lower bound on the path cost (Rs per kWh) from -> to: straight-line
+    // km * COST_PER_KM on geographic graphs (line losses only add to it),
+    // 0 otherwise
+    float heuristicCost(int from, int to) {
+        if (!hasGeographicHeuristic()) return 0;
+        float dx = homeList[from]->x - homeList[to]->x;
+        float dy = homeList[from]->y - homeList[to]->y;
+        return sqrt(dx * dx + dy * dy) * COST_PER_KM * HEURISTIC_SLACK;
+    }
+    
+    // Cached cost queries; sharing and findCheapestPath go through it
+    DistanceOracle& distances() { return oracle; }
+    
+    // ---- Dense index access ----
+    int indexOf(const string& homeID) {
+        int* idx = homeIndex.get(homeID);
+        return idx ? *idx : -1;
+    }
+    Home* getHomeByIndex(int i) { return homeList[i]; }
+    const string& idOf(int i) { return homeList[i]->homeID; }
+    int getHomeCount() const { return homeCount; }
+    int getEdgeCount() const { return edgeList.size(); }
+    const GraphEdge& getEdge(int e) const { return edgeList[e]; }
+    
+    // ---- CSR access (rebuilds if connections changed) ----
+    void ensureCSR() {
+        if (csrDirty) rebuildCSR();
+    }
+    const int* getCSROffsets() { ensureCSR(); return csrOffsets; }
+    const int* getCSRTargets() { ensureCSR(); return csrTargets; }
+    const float* getCSRWeights() { ensureCSR(); return csrWeights; }
+    
+    // `neighbors` must have room for getHomeCount() entries
     void findAllNeighborsBFS(string startHomeID, string* neighbors, int& count);
     
-    float findCheapestPath(string startHome, string targetHome, string* path, int& pathLength);
+    // Level-synchronous BFS over dense indices with a bitset visited set.
+    // order[] receives reached homes grouped by level (source first), level[]
+    // the hop count (-1 if unreached), parent[] (optional) the BFS tree.
+    // Arrays must hold getHomeCount() entries. Returns the number reached.
+    int breadthFirstSearch(int source, int* order, int* level, int* parent = nullptr,
+                           BFSMode mode = BFS_AUTO);
+    
+    // Heap-based Dijkstra from `source` over dense indices: fills dist[] (Rs,
+    // UNREACHABLE if no path) and parent[] (-1 at the source / unreachable).
+    // Both arrays must hold getHomeCount() entries. O((V + E) log V).
+    void computeShortestPaths(int source, float* dist, int* parent);
+    
+    // Same from several sources at once: dist[v] is the cost from the
+    // nearest source, and following parent[] from v ends at that source.
+    // startCost (optional) gives each source a head start cost instead of 0,
+    // and root (optional) receives the source each home was reached from.
+    void computeShortestPathsMulti(const int* sources, int sourceCount, float* dist, int* parent,
+                                   const float* startCost = nullptr, int* root = nullptr);
+    
+    // Parallel delta-stepping on `pool`: same dist[] as computeShortestPaths,
+    // bit for bit. parent[] is a valid shortest-path tree, but on equal-cost
+    // ties it may pick a different predecessor than sequential Dijkstra.
+    // delta <= 0 picks the average edge cost. Does not emit trace events.
+    void computeShortestPathsParallel(int source, float* dist, int* parent,
+                                      ThreadPool& pool, float delta = 0);
+    
+    // Writes the route source -> target using parent[]; returns its length
+    int buildPath(int target, const int* parent, string* path);
+    
+    // Cheapest route between two homes; see path_search.h for the modes.
+    // query.settled tells how much of the graph the search touched.
+    PathQuery cheapestPath(int source, int target, PathSearchMode mode = PATH_AUTO);
+    
+    float findCheapestPath(string startHome, string targetHome, string* path, int& pathLength,
+                           PathSearchMode mode = PATH_AUTO);
     
     void displayCommunityStatus();
     
+    // Silent planning / committing / console rendering of an energy request
+    // maxProviders > 0 only considers that many largest-surplus homes
+    // radiusKm > 0 (and the requester located) only considers homes within
+    // that straight-line distance; maxProviders then keeps the closest ones
+    SharingPlan planEnergySharing(string requestingHomeID, float requiredEnergy, int maxProviders = 0,
+                                  float radiusKm = 0);
+    void commitSharingPlan(const SharingPlan& plan);
+    void printSharingPlan(const SharingPlan& plan);
+    
+    // Transformer bookings only hold for the interval they were made in;
+    // this drops the last interval's before the next one is planned
+    void beginSharingInterval() {
+        if (gridTopology) gridTopology->clearReservations();
+    }
+    
+    // New interval + plan + commit + print (interactive entry point)
     void findEnergySharing(string requestingHomeID, float requiredEnergy);
+    
+    // Min-cost flow over line capacities for several requesters at once.
+    // Every other home with surplus is a provider; routes that cost more
+    // than the grid price are left to the grid.
+    DispatchPlan planDispatch(const EnergyDemand* demands, int demandCount);
+    void commitDispatchPlan(const DispatchPlan& plan);
+    void printDispatchPlan(const DispatchPlan& plan);
+    
+    // Every home currently in deficit requests its shortfall (new interval)
+    void dispatchAllDeficits();
 };
 
 #endif // COMMUNITY_GRAPH_H
-
-
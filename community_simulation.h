@@ -0,0 +1,331 @@
+#ifndef COMMUNITY_SIMULATION_H
+#define COMMUNITY_SIMULATION_H
+
+#include <iostream>
+#include <cmath>
+#include <chrono>
+#include <string>
+#include "community_graph.h"
+#include "thread_pool.h"
+using namespace std;
+
+// Time-stepped community simulation.
+//
+// Builds a synthetic community of N homes on feeders (each feeder is a
+// street: a chain of homes plus a few cross links, and a connected
+// component of its own). Every step, for every home:
+//   production  = pvPeak * daylight(time of day) * season(day) * clouds
+//   consumption = baseLoad * loadShape(time of day, shifted per home) * noise
+//   the home battery soaks up surplus / covers deficit (self-consumption)
+// then each feeder pools what is left: surplus of some homes covers the
+// deficit of others, the rest is grid import / export. Optionally, every
+// `dispatchEvery` steps the min-cost flow dispatch runs on the real graph
+// instead of the pooling (small communities only - it is far slower).
+//
+// Home state lives in flat arrays (SoA) rather than in the Home objects, so
+// a step streams through a handful of float arrays. Homes of a feeder are
+// contiguous, so feeders are the work items: the WorkStealingPool hands out
+// chunks of feeders and every worker accumulates its own metrics, with no
+// shared writes inside a step.
+
+struct SimulationConfig {
+    int homes;
+    int days;
+    int stepsPerDay;              // 96 = 15 minutes
+    int minFeeder;                // homes per feeder, drawn uniformly
+    int maxFeeder;
+    int threads;                  // 0 = one per hardware thread
+    int feedersPerChunk;
+    int dispatchEvery;            // steps between min-cost flow dispatches, 0 = never
+    unsigned int seed;
+
+    SimulationConfig() : homes(1000), days(1), stepsPerDay(96), minFeeder(20), maxFeeder(80),
+                         threads(0), feedersPerChunk(16), dispatchEvery(0), seed(1) {}
+};
+
+struct SimulationMetrics {
+    double demandKWh;
+    double productionKWh;
+    double directUseKWh;          // production used in the same home right away
+    double batteryInKWh;          // stored (after charging losses)
+    double batteryOutKWh;         // delivered to the home
+    double sharedKWh;             // moved between homes of a feeder
+    double importKWh;
+    double exportKWh;
+    double peakImportKW;
+    int peakStep;
+    long long homeSteps;
+    int dispatchRuns;
+    double wallMs;
+
+    SimulationMetrics() : demandKWh(0), productionKWh(0), directUseKWh(0), batteryInKWh(0),
+                          batteryOutKWh(0), sharedKWh(0), importKWh(0), exportKWh(0),
+                          peakImportKW(0), peakStep(-1), homeSteps(0), dispatchRuns(0), wallMs(0) {}
+
+    // Share of demand not bought from the grid
+    double selfSufficiency() const {
+        return demandKWh > 0 ? 1.0 - importKWh / demandKWh : 0;
+    }
+};
+
+class CommunitySimulation {
+private:
+    SimulationConfig config;
+    CommunityGraph graph;
+    int homeCount;
+    int feederCount;
+    int* feederStart;             // homes of feeder f: feederStart[f] .. feederStart[f+1]
+
+    // Per-home state (SoA)
+    float* pvPeak;                // W
+    float* baseLoad;              // W
+    float* batteryWh;
+    float* batteryCap;
+    float* batteryRate;           // W, charge and discharge
+    int* loadShift;               // steps
+    unsigned int* rng;
+    float* net;                   // W after the battery, + surplus / - deficit (this step)
+
+    // Shapes, precomputed
+    float* daylight;              // per step of the day
+    float* loadShape;             // per step of the day
+
+    static float nextUnit(unsigned int& s) {          // xorshift32 -> [0, 1)
+        s ^= s << 13;
+        s ^= s >> 17;
+        s ^= s << 5;
+        return (s >> 8) * (1.0f / 16777216.0f);
+    }
+
+    void build() {
+        int n = config.homes;
+        homeCount = n;
+        pvPeak = new float[n];
+        baseLoad = new float[n];
+        batteryWh = new float[n];
+        batteryCap = new float[n];
+        batteryRate = new float[n];
+        loadShift = new int[n];
+        rng = new unsigned int[n];
+        net = new float[n];
+
+        unsigned int s = config.seed ? config.seed : 1;
+        for (int i = 0; i < n; i++) {
+            rng[i] = (unsigned int)(i * 2654435761u) ^ s;
+            if (rng[i] == 0) rng[i] = 1;
+            pvPeak[i] = (nextUnit(s) < 0.6f) ? 2000 + 4000 * nextUnit(s) : 0;   // 60% have panels
+            baseLoad[i] = 300 + 700 * nextUnit(s);
+            batteryCap[i] = (pvPeak[i] > 0 && nextUnit(s) < 0.5f) ? 5000 + 5000 * nextUnit(s) : 0;
+            batteryRate[i] = batteryCap[i] / 2;
+            batteryWh[i] = batteryCap[i] / 2;
+            loadShift[i] = (int)(nextUnit(s) * config.stepsPerDay / 12);
+            graph.addHome(new Home("S" + to_string(i), "sim", 0, 0, batteryWh[i]));
+        }
+
+        // Feeders: contiguous runs of homes, chain + a chord every ~8 homes
+        DynamicArray<int> starts;
+        int h = 0;
+        while (h < n) {
+            starts.push(h);
+            int span = config.minFeeder + (int)(nextUnit(s) * (config.maxFeeder - config.minFeeder + 1));
+            if (span < 1) span = 1;
+            int end = h + span < n ? h + span : n;
+            for (int i = h + 1; i < end; i++) {
+                graph.connectHomesByIndex(i - 1, i, 0.05f + 0.1f * nextUnit(s));
+                if ((i - h) % 8 == 0 && i - 5 >= h) {
+                    graph.connectHomesByIndex(i - 5, i, 0.2f + 0.2f * nextUnit(s));
+                }
+            }
+            h = end;
+        }
+        feederCount = starts.size();
+        feederStart = new int[feederCount + 1];
+        for (int f = 0; f < feederCount; f++) feederStart[f] = starts[f];
+        feederStart[feederCount] = n;
+
+        int spd = config.stepsPerDay;
+        daylight = new float[spd];
+        loadShape = new float[spd];
+        for (int t = 0; t < spd; t++) {
+            float hour = 24.0f * t / spd;
+            daylight[t] = (hour > 6 && hour < 18) ? (float)sin((hour - 6) / 12.0 * 3.14159265) : 0;
+            // Morning bump, evening peak, low at night
+            float shape = 0.6f + 0.4f * (float)exp(-(hour - 8) * (hour - 8) / 4.0)
+                               + 0.9f * (float)exp(-(hour - 19.5f) * (hour - 19.5f) / 6.0);
+            loadShape[t] = shape;
+        }
+    }
+
+    // One feeder range for one step; adds into `m` (the worker's own metrics)
+    void stepFeeders(int firstFeeder, int endFeeder, int tod, float season, float stepHours,
+                     SimulationMetrics& m) {
+        int spd = config.stepsPerDay;
+        for (int f = firstFeeder; f < endFeeder; f++) {
+            double surplus = 0, deficit = 0;
+            for (int i = feederStart[f]; i < feederStart[f + 1]; i++) {
+                float clouds = 0.6f + 0.4f * nextUnit(rng[i]);
+                float prod = pvPeak[i] * daylight[tod] * season * clouds;
+                int shifted = tod + loadShift[i];
+                if (shifted >= spd) shifted -= spd;
+                float cons = baseLoad[i] * loadShape[shifted] * (0.8f + 0.4f * nextUnit(rng[i]));
+
+                m.demandKWh += cons * stepHours / 1000.0;
+                m.productionKWh += prod * stepHours / 1000.0;
+                m.directUseKWh += (prod < cons ? prod : cons) * stepHours / 1000.0;
+
+                float balance = prod - cons;
+                if (batteryCap[i] > 0) {
+                    const float EFF = 0.95f;
+                    if (balance > 0) {
+                        float room = (batteryCap[i] - batteryWh[i]) / (EFF * stepHours);
+                        float charge = balance < batteryRate[i] ? balance : batteryRate[i];
+                        if (charge > room) charge = room;
+                        batteryWh[i] += charge * EFF * stepHours;
+                        balance -= charge;
+                        m.batteryInKWh += charge * EFF * stepHours / 1000.0;
+                    } else if (balance < 0) {
+                        float available = batteryWh[i] * EFF / stepHours;
+                        float give = -balance < batteryRate[i] ? -balance : batteryRate[i];
+                        if (give > available) give = available;
+                        batteryWh[i] -= give / EFF * stepHours;
+                        balance += give;
+                        m.batteryOutKWh += give * stepHours / 1000.0;
+                    }
+                }
+                net[i] = balance;
+                if (balance > 0) surplus += balance;
+                else deficit -= balance;
+            }
+            double shared = surplus < deficit ? surplus : deficit;
+            m.sharedKWh += shared * stepHours / 1000.0;
+            m.importKWh += (deficit - shared) * stepHours / 1000.0;
+            m.exportKWh += (surplus - shared) * stepHours / 1000.0;
+        }
+    }
+
+    // Replaces this step's pooling with a min-cost flow dispatch on the graph
+    void dispatchStep(float stepHours, SimulationMetrics& m, double pooledShared,
+                      double pooledImport, double pooledExport) {
+        DynamicArray<EnergyDemand> demands;
+        for (int i = 0; i < homeCount; i++) {
+            // The graph sees each home's net after its battery
+            Home* home = graph.getHomeByIndex(i);
+            home->currentProduction = net[i] > 0 ? net[i] : 0;
+            home->currentConsumption = net[i] < 0 ? -net[i] : 0;
+            home->batteryLevel = batteryWh[i];
+            graph.refreshHomeEnergy(i);
+            if (net[i] < 0) {
+                EnergyDemand d;
+                d.homeIndex = i;
+                d.energy = -net[i];
+                demands.push(d);
+            }
+        }
+        DispatchPlan plan = graph.planDispatch(demands.raw(), demands.size());
+        double delivered = plan.delivered * stepHours / 1000.0;
+        double demand = pooledShared + pooledImport;
+        double supply = pooledShared + pooledExport;
+        m.sharedKWh += delivered - pooledShared;
+        m.importKWh += (demand - delivered) - pooledImport;
+        m.exportKWh += (supply - delivered) - pooledExport;
+        m.dispatchRuns++;
+    }
+
+public:
+    CommunitySimulation(const SimulationConfig& cfg) : config(cfg) {
+        build();
+    }
+
+    ~CommunitySimulation() {
+        delete[] feederStart;
+        delete[] pvPeak;
+        delete[] baseLoad;
+        delete[] batteryWh;
+        delete[] batteryCap;
+        delete[] batteryRate;
+        delete[] loadShift;
+        delete[] rng;
+        delete[] net;
+        delete[] daylight;
+        delete[] loadShape;
+        for (int i = 0; i < graph.getHomeCount(); i++) delete graph.getHomeByIndex(i);
+    }
+
+    CommunityGraph& getGraph() { return graph; }
+    int getFeederCount() const { return feederCount; }
+    int getFeederStart(int f) const { return feederStart[f]; }
+
+    SimulationMetrics run() {
+        auto start = chrono::steady_clock::now();
+        ThreadPool threads(config.threads);
+        WorkStealingPool pool(threads);
+        int workers = pool.size();
+        SimulationMetrics* local = new SimulationMetrics[workers];
+        SimulationMetrics total;
+
+        int spd = config.stepsPerDay;
+        float stepHours = 24.0f / spd;
+        int steps = config.days * spd;
+        for (int step = 0; step < steps; step++) {
+            int day = step / spd;
+            int tod = step % spd;
+            // Stronger sun mid-year (northern hemisphere), 0.5 .. 1.0
+            float season = 0.75f + 0.25f * (float)sin((day - 80) / 365.0 * 2 * 3.14159265);
+
+            for (int w = 0; w < workers; w++) local[w] = SimulationMetrics();
+            pool.parallelFor(feederCount, config.feedersPerChunk, [&](int worker, int begin, int end) {
+                stepFeeders(begin, end, tod, season, stepHours, local[worker]);
+            });
+
+            double stepImport = 0, stepShared = 0, stepExport = 0;
+            for (int w = 0; w < workers; w++) {
+                total.demandKWh += local[w].demandKWh;
+                total.productionKWh += local[w].productionKWh;
+                total.directUseKWh += local[w].directUseKWh;
+                total.batteryInKWh += local[w].batteryInKWh;
+                total.batteryOutKWh += local[w].batteryOutKWh;
+                stepShared += local[w].sharedKWh;
+                stepImport += local[w].importKWh;
+                stepExport += local[w].exportKWh;
+            }
+            total.sharedKWh += stepShared;
+            total.importKWh += stepImport;
+            total.exportKWh += stepExport;
+            if (config.dispatchEvery > 0 && step % config.dispatchEvery == 0) {
+                double before = total.importKWh;
+                dispatchStep(stepHours, total, stepShared, stepImport, stepExport);
+                stepImport += total.importKWh - before;
+            }
+
+            double importKW = stepImport / stepHours;
+            if (importKW > total.peakImportKW) {
+                total.peakImportKW = importKW;
+                total.peakStep = step;
+            }
+        }
+
+        total.homeSteps = (long long)homeCount * steps;
+        delete[] local;
+        total.wallMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        return total;
+    }
+
+    static void printMetrics(const SimulationMetrics& m, const SimulationConfig& cfg) {
+        cout << "\n========== SIMULATION RESULTS ==========" << endl;
+        cout << "Homes: " << cfg.homes << ", days: " << cfg.days
+             << ", step: " << 24 * 60 / cfg.stepsPerDay << " min" << endl;
+        cout << "Demand:         " << m.demandKWh << " kWh" << endl;
+        cout << "Solar produced: " << m.productionKWh << " kWh" << endl;
+        cout << "  used at home:   " << m.directUseKWh << " kWh" << endl;
+        cout << "  into batteries: " << m.batteryInKWh << " kWh (out: " << m.batteryOutKWh << " kWh)" << endl;
+        cout << "Shared between homes: " << m.sharedKWh << " kWh" << endl;
+        cout << "Grid import:    " << m.importKWh << " kWh (peak " << m.peakImportKW << " kW)" << endl;
+        cout << "Grid export:    " << m.exportKWh << " kWh" << endl;
+        cout << "Self-sufficiency: " << m.selfSufficiency() * 100 << "%" << endl;
+        if (m.dispatchRuns > 0) cout << "Min-cost flow dispatches: " << m.dispatchRuns << endl;
+        cout << "Simulated " << m.homeSteps << " home-steps in " << m.wallMs / 1000 << " s ("
+             << (m.wallMs > 0 ? m.homeSteps / m.wallMs / 1000.0 : 0) << " M/s)" << endl;
+    }
+};
+
+#endif // COMMUNITY_SIMULATION_H
@@ -0,0 +1,112 @@
+#ifndef COMPONENT_INDEX_H
+#define COMPONENT_INDEX_H
+
+#include "dynamic_array.h"
+using namespace std;
+
+// Connected components of the community, maintained incrementally.
+// Connections are only ever added, so a disjoint-set forest (union by size,
+// path halving) answers "same component?" in O(α(n)) without any BFS.
+// Each component also keeps:
+//   - a circular member list (next[]): unions splice two rings in O(1),
+//     so listing a component costs only its own size
+//   - running totals of surplus (positive excess) and deficit, updated
+//     whenever a home's excess changes through setValue()
+class ComponentIndex {
+private:
+    DynamicArray<int> parent;
+    DynamicArray<int> size;               // valid at roots
+    DynamicArray<int> next;               // circular member list
+    DynamicArray<float> value;            // current excess of each home (W)
+    DynamicArray<double> surplus;         // valid at roots
+    DynamicArray<double> deficit;         // valid at roots
+    int components;
+
+    static double positivePart(float v) { return v > 0 ? v : 0; }
+    static double negativePart(float v) { return v < 0 ? -v : 0; }
+
+public:
+    ComponentIndex() : components(0) {}
+
+    // New singleton component; returns its element index
+    int add(float excess) {
+        int id = parent.size();
+        parent.push(id);
+        size.push(1);
+        next.push(id);
+        value.push(excess);
+        surplus.push(positivePart(excess));
+        deficit.push(negativePart(excess));
+        components++;
+        return id;
+    }
+
+    int find(int x) {
+        while (parent[x] != x) {
+            parent[x] = parent[parent[x]];   // path halving
+            x = parent[x];
+        }
+        return x;
+    }
+
+    bool connected(int a, int b) { return find(a) == find(b); }
+
+    // Merges the components of a and b; false if they were already one
+    bool unite(int a, int b) {
+        int ra = find(a), rb = find(b);
+        if (ra == rb) return false;
+        if (size[ra] < size[rb]) {
+            int t = ra;
+            ra = rb;
+            rb = t;
+        }
+        parent[rb] = ra;
+        size[ra] += size[rb];
+        surplus[ra] += surplus[rb];
+        deficit[ra] += deficit[rb];
+
+        // Splice the two rings: ra -> (rb ... ) -> old next of ra
+        int t = next[ra];
+        next[ra] = next[rb];
+        next[rb] = t;
+        components--;
+        return true;
+    }
+
+    // Records a home's new excess and updates its component's totals
+    void setValue(int x, float excess) {
+        int r = find(x);
+        float old = value[x];
+        surplus[r] += positivePart(excess) - positivePart(old);
+        deficit[r] += negativePart(excess) - negativePart(old);
+        value[x] = excess;
+    }
+
+    float getValue(int x) const { return value[x]; }
+
+    int componentSize(int x) { return size[find(x)]; }
+    double componentSurplus(int x) { return surplus[find(x)]; }
+    double componentDeficit(int x) { return deficit[find(x)]; }
+
+    // Walk a component: start at x, follow nextMember until back at x
+    int nextMember(int x) const { return next[x]; }
+
+    int elementCount() const { return parent.size(); }
+    int componentCount() const { return components; }
+
+    // Recomputes every component total from the stored values (drift check)
+    void rebuildTotals() {
+        int n = parent.size();
+        for (int i = 0; i < n; i++) {
+            surplus[i] = 0;
+            deficit[i] = 0;
+        }
+        for (int i = 0; i < n; i++) {
+            int r = find(i);
+            surplus[r] += positivePart(value[i]);
+            deficit[r] += negativePart(value[i]);
+        }
+    }
+};
+
+#endif // COMPONENT_INDEX_H
@@ -3,27 +3,34 @@
 
 #include <string>
 #include <ctime>
+#include "device_table.h"
 using namespace std;
 
+enum DeviceStatus { STATUS_OFF = 0, STATUS_ON = 1 };
+
 class Device {
 public:
     string deviceID;
     string deviceName;
     float consumptionRate;
-    string status;
+    DeviceStatus status;
     int timestamp;
     float unitsUsed;
     bool isCritical;
     int priority;
     int startTime;
+    DeviceTable* table;     // SoA mirror this device is registered in (optional)
+    int tableSlot;
+    bool shedPending;       // turned off by load shedding, waiting in the restore queue
     
-    Device() : consumptionRate(0), timestamp(0), unitsUsed(0), 
-               isCritical(false), priority(5), startTime(0) {}
+    Device() : consumptionRate(0), status(STATUS_OFF), timestamp(0), unitsUsed(0), 
+               isCritical(false), priority(5), startTime(0), table(nullptr), tableSlot(-1),
+               shedPending(false) {}
     
     Device(string id, string name, float rate, bool critical = false, int prio = 5) 
         : deviceID(id), deviceName(name), consumptionRate(rate), 
-          status("OFF"), unitsUsed(0), isCritical(critical), 
-          priority(prio), startTime(0) {
+          status(STATUS_OFF), unitsUsed(0), isCritical(critical), 
+          priority(prio), startTime(0), table(nullptr), tableSlot(-1), shedPending(false) {
         timestamp = time(0);
         // Critical devices automatically get higher priority
         if (critical && prio < 8) {
@@ -31,24 +38,50 @@ public:
         }
     }
     
+    bool isOn() const { return status == STATUS_ON; }
+    
+    const char* statusString() const { return status == STATUS_ON ? "ON" : "OFF"; }
+    
+    static DeviceStatus parseStatus(const string& s) {
+        return s == "ON" ? STATUS_ON : STATUS_OFF;
+    }
+    
+    // Register this device in a DeviceTable so aggregates see it
+    void attachTo(DeviceTable* t) {
+        if (table) detach();
+        table = t;
+        tableSlot = t->add(this, consumptionRate, isOn(), isCritical, priority);
+    }
+    
+    void detach() {
+        if (!table) return;
+        Device* moved = table->removeSlot(tableSlot);
+        if (moved) moved->tableSlot = tableSlot;   // last slot was swapped into ours
+        table = nullptr;
+        tableSlot = -1;
+    }
+    
     void turnOn() {
-        status = "ON";
+        status = STATUS_ON;
+        shedPending = false;    // any turn-on supersedes a pending restore
+        if (table) table->setOn(tableSlot, true);
         startTime = time(0);
         timestamp = startTime;
     }
     
     void turnOff() {
-        if (status == "ON") {
+        if (status == STATUS_ON) {
             int duration = time(0) - startTime;
             float hours = duration / 3600.0;
             unitsUsed += (consumptionRate * hours) / 1000.0;   //// Convert to kWh      // The += ensures that every time you turn the device on and off, the energy consumed in that session is added to the running total. This gives you an accurate picture of total energy consumption over the device's lifetime.Without +=, you'd only know about the last session, and all previous usage data would be lost!
         }
-        status = "OFF";
+        status = STATUS_OFF;
+        if (table) table->setOn(tableSlot, false);
         timestamp = time(0);
     }
     
     float getCurrentConsumption() const {
-        if (status == "ON") {
+        if (status == STATUS_ON) {
             return consumptionRate;
         }
         return 0;
@@ -0,0 +1,240 @@
+#ifndef DEVICE_FILE_H
+#define DEVICE_FILE_H
+
+#include <cstring>
+#include <cstdint>
+#include <string>
+#include "device.h"
+#include "device_table.h"
+#include "dynamic_array.h"
+#include "hashmap.h"
+#include "mapped_file.h"
+#include "utils.h"
+using namespace std;
+
+// Binary device registry file (devices.dat), version 2. Native byte order.
+//
+//   DeviceFileHeader                 fixed 48 bytes
+//   DeviceFileRecord[deviceCount]    fixed 40 bytes each
+//   char strings[stringBytes]        device IDs and names, back to back
+//
+// Loading maps the file, checks the header (and the checksum, if the file
+// has one), then fills one block of Devices straight from the records - no
+// per-field reads and no fixed-size string buffers.
+//
+// Version 1 files (what saveDevices wrote before: a count, then each field
+// written separately with length-prefixed strings) have no magic; they are
+// still read, with every length checked against the file size.
+
+struct DeviceFileHeader {
+    char magic[8];                // "ECDEVICE"
+    uint32_t version;
+    uint32_t flags;               // FLAG_CHECKSUM
+    uint32_t deviceCount;
+    uint32_t reserved;
+    uint64_t recordsOffset;
+    uint64_t stringsOffset;
+    uint64_t stringBytes;
+    uint64_t checksum;            // FNV-1a over records + strings
+};
+
+struct DeviceFileRecord {
+    uint32_t idOffset;            // into the string table
+    uint32_t idLength;
+    uint32_t nameOffset;
+    uint32_t nameLength;
+    float consumptionRate;
+    float unitsUsed;
+    int32_t timestamp;
+    int32_t startTime;
+    int32_t priority;
+    uint32_t flags;               // RECORD_ON, RECORD_CRITICAL
+};
+
+class DeviceFile {
+public:
+    static const uint32_t VERSION = 2;
+    static const uint32_t FLAG_CHECKSUM = 1;
+    static const uint32_t RECORD_ON = 1;
+    static const uint32_t RECORD_CRITICAL = 2;
+
+    // Whole file image in memory; the caller decides where it goes
+    static bool encode(HashMap<string, Device*>& registry, string& out, bool withChecksum = true) {
+        int n = registry.size();
+        Device** devices = new Device*[n > 0 ? n : 1];
+        int size;
+        registry.getAllValues(devices, size);
+
+        uint64_t stringBytes = 0;
+        for (int i = 0; i < size; i++) {
+            stringBytes += devices[i]->deviceID.size() + devices[i]->deviceName.size();
+        }
+        if (stringBytes > 0xFFFFFFFFull) {
+            delete[] devices;
+            return false;
+        }
+
+        DeviceFileHeader header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, "ECDEVICE", 8);
+        header.version = VERSION;
+        header.flags = withChecksum ? FLAG_CHECKSUM : 0;
+        header.deviceCount = size;
+        header.recordsOffset = sizeof(DeviceFileHeader);
+        header.stringsOffset = header.recordsOffset + (uint64_t)size * sizeof(DeviceFileRecord);
+        header.stringBytes = stringBytes;
+
+        // Records and strings go straight into the output buffer
+        out.assign(header.stringsOffset + stringBytes, '\0');
+        DeviceFileRecord* records = (DeviceFileRecord*)&out[header.recordsOffset];
+        char* strings = &out[0] + header.stringsOffset;
+        uint32_t cursor = 0;
+        for (int i = 0; i < size; i++) {
+            const Device* d = devices[i];
+            DeviceFileRecord& r = records[i];
+            r.idOffset = cursor;
+            r.idLength = d->deviceID.size();
+            memcpy(strings + cursor, d->deviceID.data(), r.idLength);
+            cursor += r.idLength;
+            r.nameOffset = cursor;
+            r.nameLength = d->deviceName.size();
+            memcpy(strings + cursor, d->deviceName.data(), r.nameLength);
+            cursor += r.nameLength;
+            r.consumptionRate = d->consumptionRate;
+            r.unitsUsed = d->unitsUsed;
+            r.timestamp = d->timestamp;
+            r.startTime = d->startTime;
+            r.priority = d->priority;
+            r.flags = (d->isOn() ? RECORD_ON : 0) | (d->isCritical ? RECORD_CRITICAL : 0);
+        }
+        delete[] devices;
+
+        if (withChecksum) {
+            uint64_t h = fnv1a64((const char*)records, (uint64_t)size * sizeof(DeviceFileRecord));
+            header.checksum = fnv1a64(strings, stringBytes, h);
+        }
+        memcpy(&out[0], &header, sizeof(header));
+        return true;
+    }
+
+    // Temp file + rename: a crash mid-save keeps the previous file
+    static bool save(HashMap<string, Device*>& registry, const string& path, bool withChecksum = true) {
+        string bytes;
+        return encode(registry, bytes, withChecksum) && writeFileAtomically(path, bytes);
+    }
+
+    // Adds the file's devices to registry / table. Returns false on a
+    // missing or damaged file (nothing is added then).
+    static bool load(HashMap<string, Device*>& registry, DeviceTable& table, int& deviceCount,
+                     const string& path) {
+        MappedFile file;
+        if (!file.open(path)) return false;
+        if (file.size() >= sizeof(DeviceFileHeader) && memcmp(file.data(), "ECDEVICE", 8) == 0) {
+            return loadVersion2(file, registry, table, deviceCount);
+        }
+        return loadVersion1(file, registry, table, deviceCount);
+    }
+
+private:
+    static bool loadVersion2(const MappedFile& file, HashMap<string, Device*>& registry,
+                             DeviceTable& table, int& deviceCount) {
+        const DeviceFileHeader* header = file.at<DeviceFileHeader>(0);
+        if (header->version != VERSION) return false;
+        uint32_t n = header->deviceCount;
+        const DeviceFileRecord* records = file.at<DeviceFileRecord>(header->recordsOffset, n);
+        const char* strings = file.at<char>(header->stringsOffset, header->stringBytes);
+        if (!records || !strings) return false;
+        if (header->flags & FLAG_CHECKSUM) {
+            uint64_t h = fnv1a64((const char*)records, (uint64_t)n * sizeof(DeviceFileRecord));
+            if (fnv1a64(strings, header->stringBytes, h) != header->checksum) return false;
+        }
+        for (uint32_t i = 0; i < n; i++) {
+            const DeviceFileRecord& r = records[i];
+            if ((uint64_t)r.idOffset + r.idLength > header->stringBytes ||
+                (uint64_t)r.nameOffset + r.nameLength > header->stringBytes) return false;
+        }
+
+        // One block for all loaded devices (they live as long as the registry)
+        Device* block = new Device[n > 0 ? n : 1];
+        registry.reserve(registry.size() + n);
+        for (uint32_t i = 0; i < n; i++) {
+            const DeviceFileRecord& r = records[i];
+            Device* d = &block[i];
+            d->deviceID.assign(strings + r.idOffset, r.idLength);
+            d->deviceName.assign(strings + r.nameOffset, r.nameLength);
+            d->consumptionRate = r.consumptionRate;
+            d->unitsUsed = r.unitsUsed;
+            d->timestamp = r.timestamp;
+            d->startTime = r.startTime;
+            d->priority = r.priority;
+            d->isCritical = (r.flags & RECORD_CRITICAL) != 0;
+            d->status = (r.flags & RECORD_ON) ? STATUS_ON : STATUS_OFF;
+            d->attachTo(&table);
+            registry.insert(d->deviceID, d);
+        }
+        deviceCount += n;
+        return true;
+    }
+
+    // Bounds-checked reader for the old field-by-field layout
+    struct Cursor {
+        const char* p;
+        const char* end;
+
+        template <class T>
+        bool read(T& value) {
+            if (end - p < (long)sizeof(T)) return false;
+            memcpy(&value, p, sizeof(T));
+            p += sizeof(T);
+            return true;
+        }
+
+        bool readString(string& s) {
+            int len;
+            if (!read(len) || len < 0 || end - p < len) return false;
+            s.assign(p, len);
+            p += len;
+            return true;
+        }
+    };
+
+    static bool loadVersion1(const MappedFile& file, HashMap<string, Device*>& registry,
+                             DeviceTable& table, int& deviceCount) {
+        Cursor in = { file.data(), file.data() + file.size() };
+        int size;
+        if (!in.read(size) || size < 0) return false;
+
+        // Parse everything first so a damaged file adds nothing
+        DynamicArray<Device*> parsed;
+        bool ok = true;
+        for (int i = 0; i < size && ok; i++) {
+            string id, name, status;
+            float rate, units;
+            int timestamp, priority, startTime;
+            bool critical;
+            ok = in.readString(id) && in.readString(name) && in.read(rate) && in.readString(status)
+              && in.read(timestamp) && in.read(units) && in.read(critical) && in.read(priority)
+              && in.read(startTime);
+            if (!ok) break;
+            Device* d = new Device(id, name, rate, critical, priority);
+            d->priority = priority;
+            d->status = Device::parseStatus(status);
+            d->timestamp = timestamp;
+            d->unitsUsed = units;
+            d->startTime = startTime;
+            parsed.push(d);
+        }
+        if (!ok) {
+            for (int i = 0; i < parsed.size(); i++) delete parsed[i];
+            return false;
+        }
+        for (int i = 0; i < parsed.size(); i++) {
+            parsed[i]->attachTo(&table);
+            registry.insert(parsed[i]->deviceID, parsed[i]);
+        }
+        deviceCount += parsed.size();
+        return true;
+    }
+};
+
+#endif // DEVICE_FILE_H
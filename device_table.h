@@ -0,0 +1,407 @@
+#ifndef DEVICE_TABLE_H
+#define DEVICE_TABLE_H
+
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+using namespace std;
+
+class Device;
+
+// Struct-of-arrays copy of the hot device fields.
+// Every registered Device owns one slot; the arrays are indexed by slot so the
+// load kernels below stream through plain float / bit arrays instead of
+// chasing Device pointers and comparing status strings.
+//   rates[]        -> consumption rate (W)
+//   onBits[]       -> 1 bit per slot, set while the device is ON
+//   criticalBits[] -> 1 bit per slot, set for critical devices
+//   priorities[]   -> priority as a byte
+// Capacity is always a multiple of 64 so one bit word covers 64 rates exactly.
+//
+// Running totals (active / critical / per-priority load) are kept up to date
+// in O(1) by setOn(), which Device::turnOn/turnOff call. The kernels recompute
+// the same numbers from scratch and are used by audit() to catch drift.
+//
+// Active non-critical slots are also kept in an indexed min-heap ordered by
+// (priority ascending, consumption descending) - the load shedding order.
+// The heap is updated on every state change, so shedding pops victims in
+// O(k log n) instead of collecting and sorting all devices.
+
+// ---- Load kernels (AVX2 when compiled with -mavx2, scalar otherwise) ----
+
+inline uint64_t maskWord(const uint64_t* a, const uint64_t* b, int w) {
+    return b ? (a[w] & b[w]) : a[w];
+}
+
+#ifdef __AVX2__
+// Sums rates[i] for every set bit of mask over 8 lanes at a time.
+inline double sumMaskedRates(const float* rates, const uint64_t* a, const uint64_t* b, int words) {
+    const __m256i laneBits = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+    double total = 0;
+    for (int w = 0; w < words; w++) {
+        uint64_t m = maskWord(a, b, w);
+        if (m == 0) continue;                        // whole word OFF - skip 64 devices
+        const float* base = rates + (w << 6);
+        __m256 acc = _mm256_setzero_ps();
+        for (int k = 0; k < 8; k++) {
+            unsigned int byte = (unsigned int)(m >> (k * 8)) & 0xFF;
+            if (byte == 0) continue;
+            __m256i sel = _mm256_and_si256(_mm256_set1_epi32((int)byte), laneBits);
+            __m256i lanes = _mm256_cmpeq_epi32(sel, laneBits);
+            acc = _mm256_add_ps(acc, _mm256_and_ps(_mm256_loadu_ps(base + k * 8),
+                                                   _mm256_castsi256_ps(lanes)));
+        }
+        // Horizontal add per word, accumulated in double to limit drift on huge tables
+        __m128 lo = _mm256_castps256_ps128(acc);
+        __m128 hi = _mm256_extractf128_ps(acc, 1);
+        lo = _mm_add_ps(lo, hi);
+        lo = _mm_hadd_ps(lo, lo);
+        lo = _mm_hadd_ps(lo, lo);
+        total += _mm_cvtss_f32(lo);
+    }
+    return total;
+}
+#else
+inline double sumMaskedRates(const float* rates, const uint64_t* a, const uint64_t* b, int words) {
+    double total = 0;
+    for (int w = 0; w < words; w++) {
+        uint64_t m = maskWord(a, b, w);
+        const float* base = rates + (w << 6);
+        float wordSum = 0;
+        while (m) {
+            wordSum += base[__builtin_ctzll(m)];
+            m &= m - 1;                              // clear lowest set bit
+        }
+        total += wordSum;
+    }
+    return total;
+}
+#endif
+
+inline int countMaskedBits(const uint64_t* a, const uint64_t* b, int words) {
+    int total = 0;
+    for (int w = 0; w < words; w++) {
+        total += __builtin_popcountll(maskWord(a, b, w));
+    }
+    return total;
+}
+
+class DeviceTable {
+private:
+    float* rates;
+    uint64_t* onBits;
+    uint64_t* criticalBits;
+    unsigned char* priorities;
+    Device** owners;          // back-pointer so a moved slot can be re-linked
+    int* shedHeap;            // heap of slots (active, non-critical)
+    int* shedPos;             // shedPos[slot] = index in shedHeap, -1 if absent
+    int shedSize;
+    int capacity;             // multiple of 64
+    int count;
+    
+    // Running aggregates (double so long toggle sequences don't drift)
+    double runningLoad;
+    double runningCriticalLoad;
+    double runningPriorityLoad[256];
+    int runningActive;
+    int runningCriticalActive;
+    int runningCritical;
+
+    int words() const { return capacity >> 6; }
+
+    static bool testBit(const uint64_t* bits, int i) {
+        return (bits[i >> 6] >> (i & 63)) & 1ULL;
+    }
+
+    static void writeBit(uint64_t* bits, int i, bool value) {
+        if (value) bits[i >> 6] |= (1ULL << (i & 63));
+        else       bits[i >> 6] &= ~(1ULL << (i & 63));
+    }
+    
+    // Adds (sign = +1) or removes (sign = -1) an active slot from the running totals
+    void applyActive(int slot, int sign) {
+        double rate = sign * (double)rates[slot];
+        runningLoad += rate;
+        runningPriorityLoad[priorities[slot]] += rate;
+        runningActive += sign;
+        if (testBit(criticalBits, slot)) {
+            runningCriticalLoad += rate;
+            runningCriticalActive += sign;
+        }
+    }
+    
+    // ---- Shedding heap helpers ----
+    
+    // true if slot a should be shed before slot b
+    bool shedBefore(int a, int b) const {
+        if (priorities[a] != priorities[b]) return priorities[a] < priorities[b];
+        return rates[a] > rates[b];     // same priority: bigger consumer frees more at once
+    }
+    
+    void shedSwap(int i, int j) {
+        int t = shedHeap[i];
+        shedHeap[i] = shedHeap[j];
+        shedHeap[j] = t;
+        shedPos[shedHeap[i]] = i;
+        shedPos[shedHeap[j]] = j;
+    }
+    
+    void shedUp(int i) {
+        while (i > 0) {
+            int p = (i - 1) / 2;
+            if (!shedBefore(shedHeap[i], shedHeap[p])) break;
+            shedSwap(i, p);
+            i = p;
+        }
+    }
+    
+    void shedDown(int i) {
+        while (true) {
+            int best = i, l = 2 * i + 1, r = 2 * i + 2;
+            if (l < shedSize && shedBefore(shedHeap[l], shedHeap[best])) best = l;
+            if (r < shedSize && shedBefore(shedHeap[r], shedHeap[best])) best = r;
+            if (best == i) break;
+            shedSwap(i, best);
+            i = best;
+        }
+    }
+    
+    void shedInsert(int slot) {
+        if (shedPos[slot] != -1) return;
+        shedHeap[shedSize] = slot;
+        shedPos[slot] = shedSize;
+        shedUp(shedSize++);
+    }
+    
+    void shedErase(int slot) {
+        int i = shedPos[slot];
+        if (i == -1) return;
+        shedSwap(i, --shedSize);
+        shedPos[slot] = -1;
+        if (i < shedSize) {
+            shedUp(i);
+            shedDown(i);
+        }
+    }
+    
+    // Keeps heap membership in sync with the slot's ON / critical bits
+    void shedSync(int slot) {
+        if (testBit(onBits, slot) && !testBit(criticalBits, slot)) shedInsert(slot);
+        else shedErase(slot);
+    }
+    
+    void resetRunning() {
+        runningLoad = 0;
+        runningCriticalLoad = 0;
+        for (int p = 0; p < 256; p++) runningPriorityLoad[p] = 0;
+        runningActive = 0;
+        runningCriticalActive = 0;
+    }
+
+    void grow(int newCapacity) {
+        newCapacity = (newCapacity + 63) & ~63;
+        int newWords = newCapacity >> 6;
+
+        float* newRates = new float[newCapacity];
+        uint64_t* newOn = new uint64_t[newWords];
+        uint64_t* newCrit = new uint64_t[newWords];
+        unsigned char* newPrio = new unsigned char[newCapacity];
+        Device** newOwners = new Device*[newCapacity];
+        int* newHeap = new int[newCapacity];
+        int* newPos = new int[newCapacity];
+
+        // Unused slots must stay zero so the kernels can run over whole words
+        memset(newRates, 0, sizeof(float) * newCapacity);
+        memset(newOn, 0, sizeof(uint64_t) * newWords);
+        memset(newCrit, 0, sizeof(uint64_t) * newWords);
+        memset(newPrio, 0, newCapacity);
+        memset(newOwners, 0, sizeof(Device*) * newCapacity);
+        for (int i = 0; i < newCapacity; i++) newPos[i] = -1;
+
+        if (count > 0) {
+            memcpy(newRates, rates, sizeof(float) * count);
+            memcpy(newOn, onBits, sizeof(uint64_t) * words());
+            memcpy(newCrit, criticalBits, sizeof(uint64_t) * words());
+            memcpy(newPrio, priorities, count);
+            memcpy(newOwners, owners, sizeof(Device*) * count);
+            memcpy(newHeap, shedHeap, sizeof(int) * shedSize);
+            memcpy(newPos, shedPos, sizeof(int) * count);
+        }
+
+        delete[] rates;
+        delete[] onBits;
+        delete[] criticalBits;
+        delete[] priorities;
+        delete[] owners;
+        delete[] shedHeap;
+        delete[] shedPos;
+
+        rates = newRates;
+        onBits = newOn;
+        criticalBits = newCrit;
+        priorities = newPrio;
+        owners = newOwners;
+        shedHeap = newHeap;
+        shedPos = newPos;
+        capacity = newCapacity;
+    }
+
+public:
+    DeviceTable(int initialCapacity = 64)
+        : rates(nullptr), onBits(nullptr), criticalBits(nullptr), priorities(nullptr),
+          owners(nullptr), shedHeap(nullptr), shedPos(nullptr), shedSize(0),
+          capacity(0), count(0), runningCritical(0) {
+        resetRunning();
+        grow(initialCapacity < 64 ? 64 : initialCapacity);
+    }
+
+    ~DeviceTable() {
+        delete[] rates;
+        delete[] onBits;
+        delete[] criticalBits;
+        delete[] priorities;
+        delete[] owners;
+        delete[] shedHeap;
+        delete[] shedPos;
+    }
+
+    // Returns the slot assigned to the device
+    int add(Device* owner, float rate, bool on, bool critical, int priority) {
+        if (count >= capacity) {
+            grow(capacity * 2);
+        }
+        int slot = count++;
+        rates[slot] = rate;
+        priorities[slot] = (unsigned char)(priority < 0 ? 0 : (priority > 255 ? 255 : priority));
+        owners[slot] = owner;
+        writeBit(onBits, slot, on);
+        writeBit(criticalBits, slot, critical);
+        if (critical) runningCritical++;
+        if (on) applyActive(slot, +1);
+        shedSync(slot);
+        return slot;
+    }
+
+    // Swap-with-last removal. Returns the device that now lives in `slot`
+    // (so the caller can update its slot index), or nullptr if slot was last.
+    Device* removeSlot(int slot) {
+        if (slot < 0 || slot >= count) return nullptr;
+        if (testBit(onBits, slot)) applyActive(slot, -1);
+        if (testBit(criticalBits, slot)) runningCritical--;
+        shedErase(slot);
+        int last = --count;
+        if (slot != last) shedErase(last);      // re-inserted under its new slot below
+        Device* moved = nullptr;
+        if (slot != last) {
+            rates[slot] = rates[last];
+            priorities[slot] = priorities[last];
+            owners[slot] = owners[last];
+            writeBit(onBits, slot, testBit(onBits, last));
+            writeBit(criticalBits, slot, testBit(criticalBits, last));
+            moved = owners[slot];
+        }
+        rates[last] = 0;
+        priorities[last] = 0;
+        owners[last] = nullptr;
+        writeBit(onBits, last, false);
+        writeBit(criticalBits, last, false);
+        if (moved) shedSync(slot);
+        return moved;
+    }
+
+    void setOn(int slot, bool on) {
+        if (testBit(onBits, slot) == on) return;    // no state change, totals unchanged
+        writeBit(onBits, slot, on);
+        applyActive(slot, on ? +1 : -1);
+        shedSync(slot);
+    }
+
+    bool isOn(int slot) const { return testBit(onBits, slot); }
+    bool isCritical(int slot) const { return testBit(criticalBits, slot); }
+    float getRate(int slot) const { return rates[slot]; }
+    int getPriority(int slot) const { return priorities[slot]; }
+    Device* getOwner(int slot) const { return owners[slot]; }
+    int size() const { return count; }
+    
+    // ---- Load shedding order ----
+    // Next slot to shed (lowest priority, then largest consumer), -1 if none
+    int peekShedCandidate() const { return shedSize > 0 ? shedHeap[0] : -1; }
+    int shedCandidateCount() const { return shedSize; }
+    // Unordered access to every active non-critical slot
+    int shedCandidateAt(int i) const { return shedHeap[i]; }
+
+    // ---- O(1) running aggregates ----
+    float totalLoad() const { return (float)runningLoad; }
+    float criticalLoad() const { return (float)runningCriticalLoad; }
+    float priorityLoad(int priority) const {
+        if (priority < 0 || priority > 255) return 0;
+        return (float)runningPriorityLoad[priority];
+    }
+    int activeCount() const { return runningActive; }
+    int criticalActiveCount() const { return runningCriticalActive; }
+    int criticalCount() const { return runningCritical; }
+
+    // ---- Full recomputation with the vectorized kernels ----
+    float computeTotalLoad() const {
+        return (float)sumMaskedRates(rates, onBits, nullptr, words());
+    }
+
+    float computeCriticalLoad() const {
+        return (float)sumMaskedRates(rates, onBits, criticalBits, words());
+    }
+
+    int computeActiveCount() const {
+        return countMaskedBits(onBits, nullptr, words());
+    }
+
+    int computeCriticalActiveCount() const {
+        return countMaskedBits(onBits, criticalBits, words());
+    }
+
+    int computeCriticalCount() const {
+        return countMaskedBits(criticalBits, nullptr, words());
+    }
+
+    // Cross-checks the running totals against a full recomputation.
+    // Returns true if they agreed (within tolerance watts); either way the
+    // running totals are re-based on the recomputed values.
+    bool audit(float tolerance = 0.5f) {
+        double load = sumMaskedRates(rates, onBits, nullptr, words());
+        double critLoad = sumMaskedRates(rates, onBits, criticalBits, words());
+        int active = countMaskedBits(onBits, nullptr, words());
+        int critActive = countMaskedBits(onBits, criticalBits, words());
+        int crit = countMaskedBits(criticalBits, nullptr, words());
+
+        double prioLoad[256];
+        for (int p = 0; p < 256; p++) prioLoad[p] = 0;
+        for (int w = 0; w < words(); w++) {
+            uint64_t m = onBits[w];
+            while (m) {
+                int slot = (w << 6) + __builtin_ctzll(m);
+                prioLoad[priorities[slot]] += rates[slot];
+                m &= m - 1;
+            }
+        }
+
+        bool consistent = active == runningActive && critActive == runningCriticalActive &&
+                          crit == runningCritical &&
+                          fabs(load - runningLoad) <= tolerance &&
+                          fabs(critLoad - runningCriticalLoad) <= tolerance;
+        for (int p = 0; p < 256 && consistent; p++) {
+            if (fabs(prioLoad[p] - runningPriorityLoad[p]) > tolerance) consistent = false;
+        }
+
+        runningLoad = load;
+        runningCriticalLoad = critLoad;
+        for (int p = 0; p < 256; p++) runningPriorityLoad[p] = prioLoad[p];
+        runningActive = active;
+        runningCriticalActive = critActive;
+        runningCritical = crit;
+        return consistent;
+    }
+};
+
+#endif // DEVICE_TABLE_H
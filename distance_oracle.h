@@ -0,0 +1,100 @@
+#ifndef DISTANCE_ORACLE_H
+#define DISTANCE_ORACLE_H
+
+#include "dynamic_array.h"
+using namespace std;
+
+class CommunityGraph;
+
+// Caches shortest-path results for a CommunityGraph so repeated cost
+// queries don't rerun Dijkstra.
+//
+// 1. Tree cache: up to `capacity` full shortest-path trees (dist + parent
+//    per home), keyed by source, evicted least-recently-used. Connections
+//    are only ever added, so a new edge (a, b, w) can only make paths
+//    shorter; a cached tree is dropped only if the edge actually shortens
+//    something in it, i.e. dist[a] + w < dist[b] or dist[b] + w < dist[a].
+//    Every other tree stays valid.
+// 2. Hub labels (optional, buildHubLabels): pruned landmark labeling. Each
+//    home stores (hub, cost) pairs so that any cost query is a merge of two
+//    short sorted lists - no search at all. Meant for static topologies:
+//    building is expensive and any new edge throws the labels away.
+//
+// The oracle notices new connections lazily (it remembers how many edges it
+// has seen), the same way the CSR is rebuilt lazily.
+// Methods are defined in community_graph.cpp.
+
+struct ShortestPathTree {
+    int source;
+    int size;             // homes covered; later homes count as unreachable
+    float* dist;
+    int* parent;
+
+    ShortestPathTree() : source(-1), size(0), dist(nullptr), parent(nullptr) {}
+};
+
+struct HubEntry {
+    int hub;              // hub rank (labels are sorted by it)
+    float dist;
+};
+
+class DistanceOracle {
+private:
+    CommunityGraph* graph;
+    int capacity;
+
+    // Tree cache: slots linked MRU -> LRU through prevSlot / nextSlot
+    ShortestPathTree* trees;
+    int* prevSlot;
+    int* nextSlot;
+    int mru, lru;
+    int usedSlots;
+    DynamicArray<int> slotOf;             // home index -> slot, -1 if not cached
+
+    int seenEdges;
+
+    // Hub labels (null when not built / invalidated)
+    DynamicArray<HubEntry>* labels;
+    int labelCount;
+
+    // Statistics
+    long long hits, misses, invalidations;
+
+    void sync();                          // look at edges added since last call
+    void unlink(int slot);
+    void pushFront(int slot);
+    void dropSlot(int slot);
+    void freeLabels();
+    float labelQuery(int a, int b) const;
+
+public:
+    DistanceOracle(CommunityGraph* g, int maxTrees = 16);
+    ~DistanceOracle();
+
+    // Changes how many trees are kept (drops all cached trees)
+    void setCapacity(int maxTrees);
+
+    // Shortest-path tree from `source`, computed on a miss. The pointer is
+    // valid until the next call into the oracle.
+    const ShortestPathTree* tree(int source);
+
+    // Is a (still valid) tree from `source` cached? Doesn't compute one.
+    bool hasTree(int source);
+
+    // Cheapest cost between two homes (Rs per kWh), UNREACHABLE if no path.
+    // Uses hub labels if valid, otherwise a cached tree of either endpoint.
+    float cost(int from, int to);
+
+    void buildHubLabels();
+    bool hasHubLabels() const { return labels != nullptr; }
+    long long hubLabelEntries() const;
+
+    void clear();                         // drop all cached trees and labels
+
+    int cachedTrees() const { return usedSlots; }
+    long long getHits() const { return hits; }
+    long long getMisses() const { return misses; }
+    long long getInvalidations() const { return invalidations; }
+};
+
+#endif // DISTANCE_ORACLE_H
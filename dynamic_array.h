@@ -0,0 +1,84 @@
+#ifndef DYNAMIC_ARRAY_H
+#define DYNAMIC_ARRAY_H
+
+using namespace std;
+
+// Growable array (doubling), used where the fixed [100] arrays don't scale.
+// Elements live in one contiguous block so loops over it stay cache friendly.
+template<typename T>
+class DynamicArray {
+private:
+    T* data;
+    int count;
+    int capacity;
+
+    void grow(int newCapacity) {
+        T* newData = new T[newCapacity];
+        for (int i = 0; i < count; i++) {
+            newData[i] = data[i];
+        }
+        delete[] data;
+        data = newData;
+        capacity = newCapacity;
+    }
+
+public:
+    DynamicArray(int initialCapacity = 16) : count(0), capacity(initialCapacity < 1 ? 1 : initialCapacity) {
+        data = new T[capacity];
+    }
+
+    DynamicArray(const DynamicArray& other) : count(other.count), capacity(other.capacity) {
+        data = new T[capacity];
+        for (int i = 0; i < count; i++) data[i] = other.data[i];
+    }
+
+    DynamicArray& operator=(const DynamicArray& other) {
+        if (this == &other) return *this;
+        delete[] data;
+        count = other.count;
+        capacity = other.capacity;
+        data = new T[capacity];
+        for (int i = 0; i < count; i++) data[i] = other.data[i];
+        return *this;
+    }
+
+    ~DynamicArray() {
+        delete[] data;
+    }
+
+    void push(const T& value) {
+        if (count >= capacity) {
+            grow(capacity > 0 ? capacity * 2 : 16);
+        }
+        data[count++] = value;
+    }
+
+    T pop() {
+        return data[--count];
+    }
+
+    void reserve(int n) {
+        if (n > capacity) grow(n);
+    }
+
+    // Sets the size to n (growing if needed); new elements are left as-is
+    void resize(int n) {
+        reserve(n);
+        count = n;
+    }
+
+    void clear() { count = 0; }
+
+    T& operator[](int i) { return data[i]; }
+    const T& operator[](int i) const { return data[i]; }
+
+    T& back() { return data[count - 1]; }
+
+    T* raw() { return data; }
+    const T* raw() const { return data; }
+
+    int size() const { return count; }
+    bool isEmpty() const { return count == 0; }
+};
+
+#endif // DYNAMIC_ARRAY_H
@@ -1,4 +1,6 @@
 #include "energy_system.h"
+#include <chrono>
+#include <cmath>
 
 void EnergyOptimizationSystem::addDevice() {
     char id[50], name[50];
@@ -25,8 +27,10 @@ void EnergyOptimizationSystem::addDevice() {
     }
     
     Device* device = new Device(string(id), string(name), rate, critical, priority);
+    device->attachTo(&deviceTable);
     deviceRegistry.insert(string(id), device);
     deviceCount++;
+    changeLog.logAddDevice(*device);
     
     cout << "Device added successfully!" << endl;
     if (critical) {
@@ -36,19 +40,16 @@ void EnergyOptimizationSystem::addDevice() {
 
 void EnergyOptimizationSystem::monitorDevices() {
     cout << "\n===== Device Monitoring =====" << endl;
-    Device* devices[100];
+    Device** devices = new Device*[deviceRegistry.size() + 1];
     int size;
     deviceRegistry.getAllValues(devices, size);
     
     if (size == 0) {
         cout << "No devices registered." << endl;
+        delete[] devices;
         return;
     }
     
-    float totalConsumption = 0;
-    int criticalCount = 0;
-    float criticalLoad = 0;
-    
     cout << "\nID\t\tName\t\t\tRate(W)\t\tStatus\t\tPriority\tType" << endl;
     cout << "--------------------------------------------------------------------------------" << endl;
     
@@ -56,18 +57,16 @@ void EnergyOptimizationSystem::monitorDevices() {
         cout << devices[i]->deviceID << "\t\t"
              << devices[i]->deviceName << "\t\t"
              << devices[i]->consumptionRate << "\t\t"
-             << devices[i]->status << "\t\t"
+             << devices[i]->statusString() << "\t\t"
              << devices[i]->priority << "\t\t"
              << (devices[i]->isCritical ? "[CRITICAL]" : "[NORMAL]") << endl;
-        
-        if (devices[i]->status == "ON") {
-            totalConsumption += devices[i]->consumptionRate;
-            if (devices[i]->isCritical) {
-                criticalCount++;
-                criticalLoad += devices[i]->consumptionRate;
-            }
-        }
     }
+    delete[] devices;
+    
+    // Aggregates come from the SoA table instead of the per-device loop
+    float totalConsumption = deviceTable.totalLoad();
+    float criticalLoad = deviceTable.criticalLoad();
+    int criticalCount = deviceTable.criticalActiveCount();
     
     cout << "\n--- Load Statistics ---" << endl;
     cout << "Total Active Consumption: " << totalConsumption << " W" << endl;
@@ -94,7 +93,7 @@ void EnergyOptimizationSystem::toggleDevice() {
         return;
     }
     
-    if ((*device)->status == "OFF") {
+    if (!(*device)->isOn()) {
         // Check if turning ON will exceed capacity
         float currentLoad = getCurrentTotalLoad();     // getting the total load of all devices
         float newLoad = currentLoad + (*device)->consumptionRate;
@@ -112,6 +111,7 @@ void EnergyOptimizationSystem::toggleDevice() {
                 
                 if (performLoadShedding((*device)->consumptionRate)) {
                     (*device)->turnOn();
+                    changeLog.logDeviceState(**device);
                     updateMyHomeConsumption();  // ← NEW
                     cout << (*device)->deviceName << " turned ON (Critical device protected)" << endl;
                 } else {
@@ -125,6 +125,7 @@ void EnergyOptimizationSystem::toggleDevice() {
         }
         
         (*device)->turnOn();
+        changeLog.logDeviceState(**device);
         updateMyHomeConsumption();  // ← NEW
         cout << (*device)->deviceName << " turned ON." << endl;
         if ((*device)->isCritical) {
@@ -132,6 +133,7 @@ void EnergyOptimizationSystem::toggleDevice() {
         }
     } else {
         (*device)->turnOff();
+        changeLog.logDeviceState(**device);
         
         int duration = time(0) - (*device)->startTime;
         float units = ((*device)->consumptionRate * (duration / 3600.0f)) / 1000.0f;
@@ -146,6 +148,7 @@ void EnergyOptimizationSystem::toggleDevice() {
         );
         
         historyTracker.insertRecord(record);
+        changeLog.logHistory(record);
         
         cout << (*device)->deviceName << " turned OFF." << endl;
         cout << "Energy consumed: " << units << " kWh" << endl;
@@ -154,65 +157,100 @@ void EnergyOptimizationSystem::toggleDevice() {
     }
 }
 
+// O(1): the table keeps a running total updated by Device::turnOn/turnOff
 float EnergyOptimizationSystem::getCurrentTotalLoad() {
-    Device* devices[100];
-    int size;
-    deviceRegistry.getAllValues(devices, size);
-    
-    float total = 0;
-    for (int i = 0; i < size; i++) {
-        if (devices[i]->status == "ON") {
-            total += devices[i]->consumptionRate;
-        }
+    return deviceTable.totalLoad();
+}
+
+// Cross-check the running load totals against a full recomputation
+void EnergyOptimizationSystem::auditLoadAggregates() {
+    if (!deviceTable.audit()) {
+        cout << "\n  Load aggregates drifted - re-synchronised from device table" << endl;
     }
-    return total;
+    lastLoadAudit = time(0);
 }
 
 bool EnergyOptimizationSystem::performLoadShedding(float requiredCapacity) {
     cout << "\n--- Initiating Automatic Load Shedding ---" << endl;
     cout << "Need to free: " << requiredCapacity << " W" << endl;
     
-    Device* devices[100];
-    int size;
-    deviceRegistry.getAllValues(devices, size);
-    
-    // Sort non-critical devices by priority (lowest first)
-    Device* nonCritical[100];
-    int nonCritCount = 0;
+    auto start = chrono::steady_clock::now();
+    SheddingReport report;
+    report.requested = requiredCapacity;
+    report.lowerBound = LoadSheddingSolver::lowerBound(deviceTable, requiredCapacity);
     
-    for (int i = 0; i < size; i++) {
-        if (devices[i]->status == "ON" && !devices[i]->isCritical) {
-            nonCritical[nonCritCount++] = devices[i];
-        }
-    }
+    float freedCapacity = 0;
+    int shedCount = 0;
     
-    // Bubble sort by priority (ascending)
-    for (int i = 0; i < nonCritCount - 1; i++) {
-        for (int j = 0; j < nonCritCount - i - 1; j++) {
-            if (nonCritical[j]->priority > nonCritical[j + 1]->priority) {
-                Device* temp = nonCritical[j];
-                nonCritical[j] = nonCritical[j + 1];
-                nonCritical[j + 1] = temp;
+    if (sheddingMode == SHED_OPTIMAL) {
+        int* chosen = new int[deviceTable.shedCandidateCount() + 1];
+        int chosenCount = 0;
+        
+        if (LoadSheddingSolver::solveOptimal(deviceTable, requiredCapacity, sheddingBudgetMs,
+                                             chosen, chosenCount, &report.overBudget)) {
+            report.usedOptimizer = true;
+            // Resolve owners first - turning devices off reorders the heap
+            Device** victims = new Device*[chosenCount + 1];
+            for (int i = 0; i < chosenCount; i++) {
+                victims[i] = deviceTable.getOwner(chosen[i]);
+            }
+            for (int i = 0; i < chosenCount; i++) {
+                cout << "Turning OFF: " << victims[i]->deviceName 
+                     << " (Priority " << victims[i]->priority 
+                     << ", " << victims[i]->consumptionRate << " W)" << endl;
+                victims[i]->turnOff();
+                changeLog.logDeviceState(*victims[i]);
+                restoreQueue.push(victims[i]);
+                freedCapacity += victims[i]->consumptionRate;
+                report.loss += LoadSheddingSolver::lossOf(victims[i]->priority, victims[i]->consumptionRate);
+                shedCount++;
+            }
+            delete[] victims;
+        } else {
+            report.usedFallback = true;
+            if (report.overBudget) {
+                cout << "Optimizer ran past its " << sheddingBudgetMs
+                     << " ms budget - using greedy order (raise it with option 17)" << endl;
+            } else {
+                cout << "Optimizer found no covering set - using greedy order" << endl;
             }
         }
+        delete[] chosen;
     }
     
-    float freedCapacity = 0;
-    int shedCount = 0;
-    
-    for (int i = 0; i < nonCritCount && freedCapacity < requiredCapacity; i++) {
-        cout << "Turning OFF: " << nonCritical[i]->deviceName 
-             << " (Priority " << nonCritical[i]->priority 
-             << ", " << nonCritical[i]->consumptionRate << " W)" << endl;
+    // The device table keeps active non-critical devices in shedding order,
+    // so each victim is just the current heap top (turnOff removes it).
+    while (!report.usedOptimizer && freedCapacity < requiredCapacity) {
+        int slot = deviceTable.peekShedCandidate();
+        if (slot == -1) break;
+        Device* victim = deviceTable.getOwner(slot);
+        
+        cout << "Turning OFF: " << victim->deviceName 
+             << " (Priority " << victim->priority 
+             << ", " << victim->consumptionRate << " W)" << endl;
         
-        nonCritical[i]->turnOff();
-        freedCapacity += nonCritical[i]->consumptionRate;
+        victim->turnOff();
+        changeLog.logDeviceState(*victim);
+        restoreQueue.push(victim);
+        freedCapacity += victim->consumptionRate;
+        report.loss += LoadSheddingSolver::lossOf(victim->priority, victim->consumptionRate);
         shedCount++;
     }
     
+    report.freed = freedCapacity;
+    report.shedCount = shedCount;
+    report.gap = report.lowerBound > 0 ? (report.loss - report.lowerBound) / report.lowerBound : 0;
+    report.latencyMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    lastSheddingReport = report;
+    
     cout << "\nLoad Shedding Results:" << endl;
     cout << "Devices turned off: " << shedCount << endl;
     cout << "Capacity freed: " << freedCapacity << " W" << endl;
+    cout << "Priority-weighted loss: " << report.loss
+         << " (lower bound " << report.lowerBound << ", gap " << (report.gap * 100) << "%)" << endl;
+    cout << "Solver: " << (report.usedOptimizer ? "optimal DP" : "greedy")
+         << (report.usedFallback ? (report.overBudget ? " (fallback: over budget)" : " (fallback)") : "")
+         << ", " << report.latencyMs << " ms" << endl;
     
     if (freedCapacity >= requiredCapacity) {
         cout << "*** Load shedding successful ***" << endl;
@@ -223,15 +261,49 @@ bool EnergyOptimizationSystem::performLoadShedding(float requiredCapacity) {
     }
 }
 
+// Menu option 17: pick the shedder and the optimizer's time budget
+void EnergyOptimizationSystem::configureShedding() {
+    cout << "\n--- Load Shedding Mode ---" << endl;
+    cout << "Current: " << (sheddingMode == SHED_OPTIMAL ? "optimal" : "greedy")
+         << " (budget " << sheddingBudgetMs << " ms)" << endl;
+    cout << "1. Greedy (lowest priority first)" << endl;
+    cout << "2. Optimal (minimum priority-weighted loss, greedy if over budget)" << endl;
+    cout << "Choice: ";
+    int mode;
+    cin >> mode;
+    if (mode == 1) {
+        setSheddingMode(SHED_GREEDY, sheddingBudgetMs);
+    } else if (mode == 2) {
+        double budget;
+        cout << "Time budget in ms (0 for default " << LoadSheddingSolver::DEFAULT_BUDGET_MS << "): ";
+        cin >> budget;
+        if (budget <= 0) budget = LoadSheddingSolver::DEFAULT_BUDGET_MS;
+        setSheddingMode(SHED_OPTIMAL, budget);
+    } else {
+        cout << "Invalid choice!" << endl;
+        return;
+    }
+    cout << "Load shedding mode set to " << (sheddingMode == SHED_OPTIMAL ? "optimal" : "greedy") << endl;
+}
+
+// Bring shed devices back once there is headroom (hysteresis + rate limit in RestoreQueue)
+void EnergyOptimizationSystem::processRestoreQueue() {
+    Device* device = restoreQueue.nextRestorable(getCurrentTotalLoad(), maxLoadCapacity, time(0));
+    if (!device) return;
+    
+    device->turnOn();
+    changeLog.logDeviceState(*device);
+    updateMyHomeConsumption();
+    cout << "\n AUTO-RESTORED: " << device->deviceName 
+         << " (Priority " << device->priority << ", " << device->consumptionRate << " W)" << endl;
+}
+
 void EnergyOptimizationSystem::viewCriticalDevices() {
     cout << "\n===== Critical Devices Report =====" << endl;
-    Device* devices[100];
+    Device** devices = new Device*[deviceRegistry.size() + 1];
     int size;
     deviceRegistry.getAllValues(devices, size);
     
-    int criticalCount = 0;
-    float criticalLoad = 0;
-    
     cout << "\nID\t\tName\t\t\tRate(W)\t\tStatus\t\tPriority" << endl;
     cout << "----------------------------------------------------------------" << endl;
     
@@ -240,14 +312,14 @@ void EnergyOptimizationSystem::viewCriticalDevices() {
             cout << devices[i]->deviceID << "\t\t"
                  << devices[i]->deviceName << "\t\t"
                  << devices[i]->consumptionRate << "\t\t"
-                 << devices[i]->status << "\t\t"
+                 << devices[i]->statusString() << "\t\t"
                  << devices[i]->priority << endl;
-            criticalCount++;
-            if (devices[i]->status == "ON") {
-                criticalLoad += devices[i]->consumptionRate;
-            }
         }
     }
+    delete[] devices;
+    
+    int criticalCount = deviceTable.criticalCount();
+    float criticalLoad = deviceTable.criticalLoad();
     
     if (criticalCount == 0) {
         cout << "No critical devices registered." << endl;
@@ -261,12 +333,13 @@ void EnergyOptimizationSystem::viewCriticalDevices() {
 
 void EnergyOptimizationSystem::viewHistory() {
     cout << "\n===== Usage History =====" << endl;
-    HistoryRecord records[100];
+    HistoryRecord* records = new HistoryRecord[historyTracker.getCount() + 1];
     int size;
     historyTracker.getAllRecords(records, size);
     
     if (size == 0) {
         cout << "No history records." << endl;
+        delete[] records;
         return;
     }
     
@@ -284,6 +357,7 @@ void EnergyOptimizationSystem::viewHistory() {
     
     cout << "\nTotal Energy Consumed: " << totalUnits << " kWh" << endl;
     cout << "Estimated Cost (Rs 15/kWh): Rs " << (totalUnits * 15) << endl;
+    delete[] records;
 }
 
 void EnergyOptimizationSystem::scheduleDevice() {
@@ -332,6 +406,7 @@ void EnergyOptimizationSystem::scheduleDevice() {
     task.estimatedCost = ((*device)->consumptionRate * duration / 60.0f / 1000.0f) * tariff;
     
     scheduler.enqueue(task);
+    changeLog.logSchedule(task);
     
     cout << "\nDevice scheduled successfully!" << endl;
     cout << "Scheduled for: " << timeHour << ":"  
@@ -371,12 +446,23 @@ void EnergyOptimizationSystem::setupCommunity() {
     // ← NEW: Update H001 with real current consumption
     updateMyHomeConsumption();
     
-    communityNetwork.connectHomes(string("H001"), string("H002"), 0.5f);
-    communityNetwork.connectHomes(string("H002"), string("H003"), 0.3f);
-    communityNetwork.connectHomes(string("H001"), string("H003"), 0.8f);
-    communityNetwork.connectHomes(string("H003"), string("H004"), 0.6f);
-    communityNetwork.connectHomes(string("H004"), string("H005"), 0.4f);
-    communityNetwork.connectHomes(string("H001"), string("H004"), 1.2f);
+    // distance (km), line rating (W)
+    communityNetwork.connectHomes(string("H001"), string("H002"), 0.5f, 1500.0f);
+    communityNetwork.connectHomes(string("H002"), string("H003"), 0.3f, 2000.0f);
+    communityNetwork.connectHomes(string("H001"), string("H003"), 0.8f, 1000.0f);
+    communityNetwork.connectHomes(string("H003"), string("H004"), 0.6f, 1500.0f);
+    communityNetwork.connectHomes(string("H004"), string("H005"), 0.4f, 1000.0f);
+    communityNetwork.connectHomes(string("H001"), string("H004"), 1.2f, 800.0f);
+    
+    // Map positions (km); every line is at least the straight distance
+    communityNetwork.setHomeLocation(string("H001"), 0.0f, 0.0f);
+    communityNetwork.setHomeLocation(string("H002"), 0.5f, 0.0f);
+    communityNetwork.setHomeLocation(string("H003"), 0.8f, 0.0f);
+    communityNetwork.setHomeLocation(string("H004"), 0.8f, 0.6f);
+    communityNetwork.setHomeLocation(string("H005"), 0.8f, 1.0f);
+    
+    
+    buildCommunityGrid();
     
     communitySetup = true;
     
@@ -384,6 +470,20 @@ void EnergyOptimizationSystem::setupCommunity() {
     communityNetwork.displayCommunityStatus();
 }
 
+// Distribution grid: H001-H003 on one transformer, H004-H005 on another
+void EnergyOptimizationSystem::buildCommunityGrid() {
+    if (communityGrid.nodeCount() == 1) {
+        int north = communityGrid.addNode(GridTopology::ROOT, 5000.0f, "TX-North");
+        int south = communityGrid.addNode(GridTopology::ROOT, 4000.0f, "TX-South");
+        const char* ids[5] = { "H001", "H002", "H003", "H004", "H005" };
+        for (int i = 0; i < 5; i++) {
+            int home = communityNetwork.indexOf(ids[i]);
+            if (home != -1) communityGrid.attachHome(home, i < 3 ? north : south);
+        }
+    }
+    communityNetwork.attachGrid(&communityGrid);
+}
+
 void EnergyOptimizationSystem::requestEnergy() {
     if (!communitySetup) {
         cout << "\n  Please setup community network first (Option 7)!" << endl;
@@ -402,6 +502,117 @@ void EnergyOptimizationSystem::requestEnergy() {
     communityNetwork.findEnergySharing(string(homeID), energy);
 }
 
+void EnergyOptimizationSystem::dispatchCommunity() {
+    if (!communitySetup) {
+        cout << "\n  Please setup community network first (Option 7)!" << endl;
+        return;
+    }
+    
+    updateMyHomeConsumption();
+    communityNetwork.dispatchAllDeficits();
+}
+
+void EnergyOptimizationSystem::runCommunityMarket() {
+    if (!communitySetup) {
+        cout << "\n  Please setup community network first (Option 7)!" << endl;
+        return;
+    }
+    
+    int ruleChoice;
+    float offerPrice;
+    cout << "\n--- Community Market ---" << endl;
+    cout << "Clearing rule (1 = uniform price, 2 = pay-as-bid): ";
+    cin >> ruleChoice;
+    cout << "Sellers' asking price (Rs/kWh): ";
+    cin >> offerPrice;
+    ClearingRule rule = (ruleChoice == 2) ? CLEAR_PAY_AS_BID : CLEAR_UNIFORM;
+    
+    updateMyHomeConsumption();
+    communityMarket.collectFromHomes(communityNetwork, offerPrice);
+    ClearingResult result = communityMarket.clearInterval(communityNetwork, rule);
+    EnergyMarket::applyTrades(communityNetwork, result);
+    EnergyMarket::printResult(communityNetwork, result, rule);
+}
+
+void EnergyOptimizationSystem::planBatteries() {
+    if (!communitySetup) {
+        cout << "\n  Please setup community network first (Option 7)!" << endl;
+        return;
+    }
+    
+    updateMyHomeConsumption();
+    
+    // Forecast from today's readings: solar follows the daylight curve with
+    // the current production as its peak, consumption rises in the evening.
+    // Prices: cheap at night, peak 17:00-22:00.
+    const int HOURS = 24;
+    float prices[HOURS];
+    for (int t = 0; t < HOURS; t++) {
+        prices[t] = (t < 6) ? 12.0f : (t >= 17 && t < 22) ? 30.0f : GRID_PRICE_PER_KWH;
+    }
+    int n = communityNetwork.getHomeCount();
+    float* production = new float[n * HOURS];
+    float* consumption = new float[n * HOURS];
+    for (int i = 0; i < n; i++) {
+        Home* home = communityNetwork.getHomeByIndex(i);
+        for (int t = 0; t < HOURS; t++) {
+            float sun = (t >= 6 && t <= 18) ? (float)sin((t - 6) / 12.0 * 3.14159265) : 0.0f;
+            production[i * HOURS + t] = home->currentProduction * sun;
+            consumption[i * HOURS + t] = home->currentConsumption * ((t >= 17 && t < 22) ? 1.4f : 0.8f);
+        }
+    }
+    
+    DispatchHorizon horizon;
+    horizon.steps = HOURS;
+    horizon.stepHours = 1.0f;
+    horizon.importPrice = prices;
+    CommunityBatteryPlan plan = BatteryDispatcher::planCommunity(communityNetwork, production, consumption, horizon);
+    
+    cout << "\n========== BATTERY PLAN (24h) ==========" << endl;
+    cout << "Home\tImport idle(kWh)\tImport planned(kWh)\tSaved(Rs)" << endl;
+    for (int i = 0; i < n; i++) {
+        const HomeBatteryPlan& h = plan.homes[i];
+        cout << communityNetwork.idOf(i) << "\t" << h.importWhWithout / 1000 << "\t\t\t"
+             << h.importWh / 1000 << "\t\t\t" << (h.costWithout - h.cost) << endl;
+    }
+    
+    int mine = communityNetwork.indexOf("H001");
+    if (mine != -1) {
+        const HomeBatteryPlan& h = plan.homes[mine];
+        cout << "\nYour home (H001), hour by hour:" << endl;
+        cout << "Hour\tBattery(W)\tGrid(W)\tStored(Wh)" << endl;
+        for (int t = 0; t < HOURS; t++) {
+            cout << t << "\t" << h.batteryW[t] << "\t\t" << h.gridW[t] << "\t" << h.levelWh[t] << endl;
+        }
+    }
+    
+    cout << "\nCommunity grid import: " << plan.importWhWithout / 1000 << " -> " 
+         << plan.importWh / 1000 << " kWh" << endl;
+    cout << "Community bill: Rs " << plan.costWithout << " -> Rs " << plan.cost << endl;
+    cout << "Planned in " << plan.latencyMs << " ms" << endl;
+    
+    delete[] production;
+    delete[] consumption;
+}
+
+void EnergyOptimizationSystem::simulateCommunity() {
+    // Synthetic community, separate from the one set up in option 7
+    SimulationConfig cfg;
+    cout << "\nNumber of homes to simulate: ";
+    cin >> cfg.homes;
+    cout << "Number of days (15-minute steps): ";
+    cin >> cfg.days;
+    if (cfg.homes <= 0 || cfg.days <= 0) {
+        cout << "Invalid input!" << endl;
+        return;
+    }
+    
+    cout << "Simulating..." << endl;
+    CommunitySimulation sim(cfg);
+    SimulationMetrics metrics = sim.run();
+    CommunitySimulation::printMetrics(metrics, cfg);
+}
+
 void EnergyOptimizationSystem::generateReport() {
     FileManager::generateReport(deviceRegistry, historyTracker, scheduler, maxLoadCapacity, deviceCount);
 }
@@ -422,6 +633,11 @@ void EnergyOptimizationSystem::displayMenu() {
     cout << "10. View Critical Devices" << endl;
     cout << "11. Save Data Now" << endl;              // ← NEW
     cout << "12. Generate Complete Report File" << endl;  // ← NEW
+    cout << "13. Dispatch Energy to All Homes in Deficit" << endl;
+    cout << "14. Run Community Market (all homes at once)" << endl;
+    cout << "15. Plan Home Batteries (next 24 hours)" << endl;
+    cout << "16. Run Community Simulation" << endl;
+    cout << "17. Load Shedding Mode (greedy / optimal)" << endl;
     cout << "0.  Exit" << endl;
     cout << "========================================" << endl;
     cout << "Choice: ";
@@ -445,14 +661,16 @@ void EnergyOptimizationSystem::checkAndExecuteScheduledTasks() {
         
         if (shouldExecute) {
             scheduler.dequeue();  
+            changeLog.logUnschedule(task);
             
             
             Device** device = deviceRegistry.get(task.deviceID);
-            if (device && (*device)->status == "OFF") {
+            if (device && !(*device)->isOn()) {
                 
                 float currentLoad = getCurrentTotalLoad();
                 if (currentLoad + (*device)->consumptionRate <= maxLoadCapacity) {
                     (*device)->turnOn();
+                    changeLog.logDeviceState(**device);
                     cout << "\n🔔 AUTO-EXECUTED: " << task.deviceName 
                          << " (Scheduled for " << task.scheduledTime << ":"   // ← UPDATED
                          << (task.scheduledMinute < 10 ? "0" : "") << task.scheduledMinute << ")" << endl;
@@ -468,34 +686,54 @@ void EnergyOptimizationSystem::checkAndExecuteScheduledTasks() {
 }
 
 // ← NEW: File handling implementations
+// Everything the .dat files hold, encoded into memory. This (plus one log
+// fsync) is the only part of a checkpoint the control loop waits for.
+PersistenceSnapshot* EnergyOptimizationSystem::captureSnapshot() {
+    auto start = chrono::steady_clock::now();
+    PersistenceSnapshot* snapshot = new PersistenceSnapshot();
+    if (!DeviceFile::encode(deviceRegistry, snapshot->devices) ||
+        !CommunityFile::encode(communityNetwork, communitySetup, snapshot->community)) {
+        delete snapshot;
+        return nullptr;
+    }
+    FileManager::encodeHistory(historyTracker, snapshot->history);
+    FileManager::encodeSchedule(scheduler, snapshot->schedule);
+    snapshot->epoch = ++snapshotEpoch;
+    snapshot->walLsn = changeLog.beginCheckpoint();   // later changes go to the new log segment
+    FileManager::stampWalLsn(snapshot->history, snapshot->walLsn);
+    FileManager::stampWalLsn(snapshot->schedule, snapshot->walLsn);
+    snapshot->captureMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    return snapshot;
+}
+
+// Checkpoint: the background writer rewrites the .dat files from the
+// snapshot, then drops the log records they cover
+bool EnergyOptimizationSystem::writeCheckpoint() {
+    lastCheckpoint = time(0);
+    PersistenceSnapshot* snapshot = captureSnapshot();
+    if (!snapshot) return false;
+    lastSnapshotMs = snapshot->captureMs;
+    persistence.submit(snapshot);
+    return true;
+}
+
+// On exit: waits for the files to be written
 void EnergyOptimizationSystem::saveAllData() {
     cout << "\n  Saving system data..." << endl;
-    bool success = true;
-    
-    if (!FileManager::saveDevices(deviceRegistry)) {
-        cout << "  Failed to save devices" << endl;
-        success = false;
-    }
-    
-    if (!FileManager::saveHistory(historyTracker)) {
-        cout << "  Failed to save history" << endl;
-        success = false;
-    }
-    
-    if (!FileManager::saveSchedule(scheduler)) {
-        cout << "  Failed to save schedule" << endl;
-        success = false;
-    }
-    
-    if (!FileManager::saveCommunity(communityNetwork, communitySetup)) {
-        cout << "  Failed to save community" << endl;
-        success = false;
-    }
-    
-    if (success) {
+    if (writeCheckpoint()) persistence.waitIdle();
+    if (persistence.lastWriteOk() && persistence.writes() > 0) {
         cout << "  All data saved successfully!" << endl;
     } else {
-        cout << "   Some data may not have been saved" << endl;
+        cout << "   Some data may not have been saved (changes are kept in wal.log)" << endl;
+    }
+}
+
+// Menu option 11: only the snapshot holds up the menu
+void EnergyOptimizationSystem::saveInBackground() {
+    if (writeCheckpoint()) {
+        cout << "\n  Snapshot taken in " << lastSnapshotMs << " ms - saving in the background" << endl;
+    } else {
+        cout << "\n   Could not take a snapshot (changes are kept in wal.log)" << endl;
     }
 }
 
@@ -503,19 +741,20 @@ void EnergyOptimizationSystem::loadAllData() {
     cout << "\n  Loading system data..." << endl;
     bool success = true;
     
-    if (!FileManager::loadDevices(deviceRegistry, deviceCount)) {
+    if (!FileManager::loadDevices(deviceRegistry, deviceTable, deviceCount)) {
         cout << "  No device data found (first run)" << endl;
     } else {
         cout << "  Devices loaded: " << deviceCount << endl;
     }
     
-    if (!FileManager::loadHistory(historyTracker)) {
+    uint64_t historyLsn = 0, scheduleLsn = 0;     // what the files already hold of wal.log
+    if (!FileManager::loadHistory(historyTracker, &historyLsn)) {
         cout << "   No history data found" << endl;
     } else {
         cout << "  History loaded" << endl;
     }
     
-    if (!FileManager::loadSchedule(scheduler)) {
+    if (!FileManager::loadSchedule(scheduler, &scheduleLsn)) {
         cout << "   No schedule data found" << endl;
     } else {
         cout << "  Schedule loaded" << endl;
@@ -524,7 +763,18 @@ void EnergyOptimizationSystem::loadAllData() {
     if (!FileManager::loadCommunity(communityNetwork, communitySetup)) {
         cout << "   No community data found" << endl;
     } else {
-        cout << "  Community loaded" << endl;
+        cout << "  Community loaded: " << communityNetwork.getHomeCount() << " homes" << endl;
+        if (communitySetup) buildCommunityGrid();
+    }
+    
+    // Changes made after the last checkpoint (e.g. before a crash)
+    changeLog.setCoveredLsns(historyLsn, scheduleLsn);
+    int replayed = changeLog.recover("wal.log", deviceRegistry, deviceTable, deviceCount,
+                                     historyTracker, scheduler);
+    if (replayed < 0) {
+        cout << "   Could not open wal.log - changes are saved on exit only" << endl;
+    } else if (replayed > 0) {
+        cout << "  Replayed " << replayed << " logged changes" << endl;
     }
     
     cout << "  System ready!" << endl;
@@ -534,19 +784,16 @@ void EnergyOptimizationSystem::loadAllData() {
 void EnergyOptimizationSystem::updateMyHomeConsumption() {
     if (!communitySetup) return;  // Only if community is set up
     
-    Home** myHome = communityNetwork.getHome("H001");
-    if (myHome && *myHome) {
-        float currentLoad = getCurrentTotalLoad();   // total load of all devices 
-        (*myHome)->currentConsumption = currentLoad;   // total load of all devices 
-        (*myHome)->updateEnergy();  // Recalculate excess energy
-        
+    // Goes through the graph so the community's surplus totals stay current
+    Home* myHome = communityNetwork.updateHomeConsumption("H001", getCurrentTotalLoad());
+    if (myHome) {
         // Optional: Show feedback
-        if ((*myHome)->excessEnergy < 0) {
+        if (myHome->excessEnergy < 0) {
             cout << "   Your home is consuming more than producing (" 
-                 << -(*myHome)->excessEnergy << " W deficit)" << endl;
+                 << -myHome->excessEnergy << " W deficit)" << endl;
         } else {
             cout << "  Your home has excess energy (" 
-                 << (*myHome)->excessEnergy << " W available)" << endl;
+                 << myHome->excessEnergy << " W available)" << endl;
         }
     }
 }
@@ -556,6 +803,18 @@ void EnergyOptimizationSystem::run() {
     
     while (true) {
         checkAndExecuteScheduledTasks();
+        processRestoreQueue();
+        
+        if (time(0) - lastLoadAudit >= LOAD_AUDIT_INTERVAL) {
+            auditLoadAggregates();
+        }
+        if (time(0) - lastCheckpoint >= CHECKPOINT_INTERVAL ||
+            changeLog.sizeBytes() >= CHECKPOINT_LOG_BYTES) {
+            writeCheckpoint();
+        }
+        if (persistence.takeFailure()) {
+            cout << "\n  Background save failed - changes are kept in wal.log" << endl;
+        }
         
         displayMenu();
         cin >> choice;
@@ -571,8 +830,13 @@ void EnergyOptimizationSystem::run() {
             case 8: generateReport(); break;
             case 9: requestEnergy(); break;
             case 10: viewCriticalDevices(); break;
-            case 11: saveAllData(); break;  // ← NEW
+            case 11: saveInBackground(); break;  // ← NEW
             case 12: FileManager::generateReport(deviceRegistry, historyTracker, scheduler, maxLoadCapacity, deviceCount); break;  // ← NEW
+            case 13: dispatchCommunity(); break;
+            case 14: runCommunityMarket(); break;
+            case 15: planBatteries(); break;
+            case 16: simulateCommunity(); break;
+            case 17: configureShedding(); break;
             case 0:
                 cout << "\nThank you for using Energy Optimizer!" << endl;
                 return;
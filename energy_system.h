@@ -5,32 +5,63 @@
 #include <cstring>
 #include <ctime>
 #include "device.h"
+#include "device_table.h"
+#include "load_shedding.h"
+#include "restore_queue.h"
 #include "hashmap.h"
 #include "history.h"
 #include "priority_queue.h"
 #include "community_graph.h"
+#include "energy_market.h"
+#include "battery_dispatch.h"
+#include "community_simulation.h"
 #include "file_manager.h"  
+#include "write_ahead_log.h"
+#include "snapshot_writer.h"
 using namespace std;
 
 class EnergyOptimizationSystem {
 private:
     HashMap<string, Device*> deviceRegistry;
+    DeviceTable deviceTable;            // SoA mirror of the registry for load aggregates
     UsageHistoryBST historyTracker;
     PriorityQueue scheduler;
     CommunityGraph communityNetwork;
+    GridTopology communityGrid;         // transformers above the community homes
+    EnergyMarket communityMarket;
     float maxLoadCapacity;
     int deviceCount;
     bool communitySetup;
+    time_t lastLoadAudit;
+    SheddingMode sheddingMode;
+    double sheddingBudgetMs;            // hard time budget for the optimizing solver
+    SheddingReport lastSheddingReport;
+    RestoreQueue restoreQueue;          // shed devices waiting to come back on
+    WriteAheadLog changeLog;            // mutations since the last checkpoint (wal.log)
+    SnapshotWriter persistence;         // writes checkpoints on a background thread
+    time_t lastCheckpoint;
+    unsigned long long snapshotEpoch;
+    double lastSnapshotMs;              // how long the control loop waited for the last snapshot
+    static const int LOAD_AUDIT_INTERVAL = 300;   // seconds between aggregate audits
+    static const int CHECKPOINT_INTERVAL = 600;   // seconds between checkpoints
+    static const long long CHECKPOINT_LOG_BYTES = 4 << 20;   // or once the log is this big
 
     void checkAndExecuteScheduledTasks(); 
+    void auditLoadAggregates();
     
     
+    PersistenceSnapshot* captureSnapshot();
+    bool writeCheckpoint();
     void saveAllData();
+    void saveInBackground();
     void loadAllData(); 
     void updateMyHomeConsumption(); 
     
 public:
-    EnergyOptimizationSystem() : maxLoadCapacity(5000), deviceCount(0), communitySetup(false) {
+    EnergyOptimizationSystem() : maxLoadCapacity(5000), deviceCount(0), communitySetup(false),
+                                 lastLoadAudit(time(0)), sheddingMode(SHED_GREEDY),
+                                 sheddingBudgetMs(LoadSheddingSolver::DEFAULT_BUDGET_MS), persistence(&changeLog),
+                                 lastCheckpoint(time(0)), snapshotEpoch(0), lastSnapshotMs(0) {
         loadAllData();  // ← NEW: Auto-load on startup
     }
     
@@ -43,12 +74,25 @@ public:
     void toggleDevice();
     float getCurrentTotalLoad();
     bool performLoadShedding(float requiredCapacity);
+    void setSheddingMode(SheddingMode mode, double budgetMs = LoadSheddingSolver::DEFAULT_BUDGET_MS) {
+        sheddingMode = mode;
+        sheddingBudgetMs = budgetMs;
+    }
+    const SheddingReport& getLastSheddingReport() const { return lastSheddingReport; }
+    const GridTopology& getCommunityGrid() const { return communityGrid; }
+    void configureShedding();
+    void processRestoreQueue();
     void viewCriticalDevices();
     void viewHistory();
     void scheduleDevice();
     void viewSchedule();
     void setupCommunity();
+    void buildCommunityGrid();
     void requestEnergy();
+    void dispatchCommunity();
+    void runCommunityMarket();
+    void planBatteries();
+    void simulateCommunity();
     void generateReport();
     void displayMenu();
     void run();
@@ -2,12 +2,18 @@
 #define FILE_MANAGER_H
 
 #include <fstream>
+#include <sstream>
 #include <iostream>
 #include <string>
+#include <cstring>
+#include <cstdint>
 #include "device.h"
 #include "history.h"
 #include "priority_queue.h"
 #include "community_graph.h"
+#include "community_file.h"
+#include "device_file.h"
+#include "dynamic_array.h"
 #include "hashmap.h"
 using namespace std;
 
@@ -15,117 +21,41 @@ class FileManager {
 public:
     // Save functions
     static bool saveDevices(HashMap<string, Device*>& deviceRegistry) {
-        ofstream file("devices.dat", ios::binary);
-        if (!file.is_open()) {
+        if (!DeviceFile::save(deviceRegistry, "devices.dat")) {
             cout << "Error: Could not create devices.dat" << endl;
             return false;
         }
-        
-        Device* devices[100];
-        int size;
-        deviceRegistry.getAllValues(devices, size);
-        
-        // Write count first
-        file.write(reinterpret_cast<char*>(&size), sizeof(int));
-        
-        // Write each device
-        for (int i = 0; i < size; i++) {
-            // Write string lengths and data
-            int idLen = devices[i]->deviceID.length();
-            int nameLen = devices[i]->deviceName.length();
-            int statusLen = devices[i]->status.length();
-            
-            file.write(reinterpret_cast<char*>(&idLen), sizeof(int));
-            file.write(devices[i]->deviceID.c_str(), idLen);
-            
-            file.write(reinterpret_cast<char*>(&nameLen), sizeof(int));
-            file.write(devices[i]->deviceName.c_str(), nameLen);
-            
-            file.write(reinterpret_cast<char*>(&devices[i]->consumptionRate), sizeof(float));
-            
-            file.write(reinterpret_cast<char*>(&statusLen), sizeof(int));
-            file.write(devices[i]->status.c_str(), statusLen);
-            
-            file.write(reinterpret_cast<char*>(&devices[i]->timestamp), sizeof(int));
-            file.write(reinterpret_cast<char*>(&devices[i]->unitsUsed), sizeof(float));
-            file.write(reinterpret_cast<char*>(&devices[i]->isCritical), sizeof(bool));
-            file.write(reinterpret_cast<char*>(&devices[i]->priority), sizeof(int));
-            file.write(reinterpret_cast<char*>(&devices[i]->startTime), sizeof(int));
-        }
-        
-        file.close();
         return true;
     }
     
-    static bool loadDevices(HashMap<string, Device*>& deviceRegistry, int& deviceCount) {
-        ifstream file("devices.dat", ios::binary);
-        if (!file.is_open()) {
-            return false; // File doesn't exist, fresh start
-        }
-        
-        int size;
-        file.read(reinterpret_cast<char*>(&size), sizeof(int));
-        
-        for (int i = 0; i < size; i++) {
-            int idLen, nameLen, statusLen;
-            char buffer[256];
-            
-            // Read deviceID
-            file.read(reinterpret_cast<char*>(&idLen), sizeof(int));
-            file.read(buffer, idLen);
-            buffer[idLen] = '\0';
-            string deviceID(buffer);
-            
-            // Read deviceName
-            file.read(reinterpret_cast<char*>(&nameLen), sizeof(int));
-            file.read(buffer, nameLen);
-            buffer[nameLen] = '\0';
-            string deviceName(buffer);
-            
-            float consumptionRate;
-            file.read(reinterpret_cast<char*>(&consumptionRate), sizeof(float));
-            
-            // Read status
-            file.read(reinterpret_cast<char*>(&statusLen), sizeof(int));
-            file.read(buffer, statusLen);
-            buffer[statusLen] = '\0';
-            string status(buffer);
-            
-            int timestamp;
-            float unitsUsed;
-            bool isCritical;
-            int priority;
-            int startTime;
-            
-            file.read(reinterpret_cast<char*>(&timestamp), sizeof(int));
-            file.read(reinterpret_cast<char*>(&unitsUsed), sizeof(float));
-            file.read(reinterpret_cast<char*>(&isCritical), sizeof(bool));
-            file.read(reinterpret_cast<char*>(&priority), sizeof(int));
-            file.read(reinterpret_cast<char*>(&startTime), sizeof(int));
-            
-            // Create device and restore state
-            Device* device = new Device(deviceID, deviceName, consumptionRate, isCritical, priority);
-            device->status = status;
-            device->timestamp = timestamp;
-            device->unitsUsed = unitsUsed;
-            device->startTime = startTime;
-            
-            deviceRegistry.insert(deviceID, device);
-            deviceCount++;
-        }
-        
-        file.close();
-        return true;
+    // Reads the fixed-record format, or the old field-by-field one
+    static bool loadDevices(HashMap<string, Device*>& deviceRegistry, DeviceTable& deviceTable, int& deviceCount) {
+        return DeviceFile::load(deviceRegistry, deviceTable, deviceCount, "devices.dat");
     }
     
-    static bool saveHistory(UsageHistoryBST& historyTracker) {
-        ofstream file("history.dat", ios::binary);
-        if (!file.is_open()) {
-            cout << "Error: Could not create history.dat" << endl;
-            return false;
-        }
+    // Checkpoints end history.dat / schedule.dat with the WAL LSN the file
+    // covers ("ECWALLSN" + uint64), so recovery never replays a record the
+    // file already holds - even if the crash came before the log's own
+    // checkpoint marker. Loaders that stop after the records never see it.
+    static void stampWalLsn(string& out, uint64_t lsn) {
+        out.append("ECWALLSN", 8);
+        out.append(reinterpret_cast<const char*>(&lsn), sizeof(lsn));
+    }
+    
+    // Right after the last record; 0 if the file has no stamp
+    static uint64_t readWalLsn(ifstream& file) {
+        char magic[8];
+        uint64_t lsn;
+        if (!file.read(magic, 8) || memcmp(magic, "ECWALLSN", 8) != 0) return 0;
+        if (!file.read(reinterpret_cast<char*>(&lsn), sizeof(lsn))) return 0;
+        return lsn;
+    }
+    
+    // history.dat image in memory (checkpoints write it on a background thread)
+    static void encodeHistory(UsageHistoryBST& historyTracker, string& out) {
+        ostringstream file(ios::binary);
         
-        HistoryRecord records[100];
+        HistoryRecord* records = new HistoryRecord[historyTracker.getCount() + 1];
         int size;
         historyTracker.getAllRecords(records, size);
         
@@ -147,11 +77,23 @@ public:
             file.write(reinterpret_cast<char*>(&records[i].unitsConsumed), sizeof(float));
         }
         
-        file.close();
+        delete[] records;
+        out = file.str();
+    }
+    
+    // Temp file + rename, like the other .dat files (checkpoints rely on it)
+    static bool saveHistory(UsageHistoryBST& historyTracker) {
+        string bytes;
+        encodeHistory(historyTracker, bytes);
+        if (!writeFileAtomically("history.dat", bytes)) {
+            cout << "Error: Could not create history.dat" << endl;
+            return false;
+        }
         return true;
     }
     
-    static bool loadHistory(UsageHistoryBST& historyTracker) {
+    // walLsn (optional) gets the stamp, 0 if none
+    static bool loadHistory(UsageHistoryBST& historyTracker, uint64_t* walLsn = nullptr) {
         ifstream file("history.dat", ios::binary);
         if (!file.is_open()) {
             return false;
@@ -186,27 +128,22 @@ public:
             HistoryRecord record(deviceID, deviceName, consumptionRate, timestamp, duration, unitsConsumed);
             historyTracker.insertRecord(record);
         }
+        if (walLsn) *walLsn = readWalLsn(file);
         
         file.close();
         return true;
     }
     
-    static bool saveSchedule(PriorityQueue& scheduler) {
-        ofstream file("schedule.dat", ios::binary);
-        if (!file.is_open()) {
-            cout << "Error: Could not create schedule.dat" << endl;
-            return false;
-        }
-        
-        // Create temporary array to store tasks
-        ScheduledTask tasks[100];
-        int size = 0;
+    // schedule.dat image in memory; the queue is drained and refilled
+    static void encodeSchedule(PriorityQueue& scheduler, string& out) {
+        ostringstream file(ios::binary);
         
         // Extract all tasks (this will empty the queue)
-        PriorityQueue tempQueue;
+        DynamicArray<ScheduledTask> tasks(scheduler.getSize() + 1);
         while (!scheduler.isEmpty()) {
-            tasks[size++] = scheduler.dequeue();
+            tasks.push(scheduler.dequeue());
         }
+        int size = tasks.size();
         
         // Write size
         file.write(reinterpret_cast<char*>(&size), sizeof(int));
@@ -233,11 +170,20 @@ public:
             scheduler.enqueue(tasks[i]);
         }
         
-        file.close();
+        out = file.str();
+    }
+    
+    static bool saveSchedule(PriorityQueue& scheduler) {
+        string bytes;
+        encodeSchedule(scheduler, bytes);
+        if (!writeFileAtomically("schedule.dat", bytes)) {
+            cout << "Error: Could not create schedule.dat" << endl;
+            return false;
+        }
         return true;
     }
     
-    static bool loadSchedule(PriorityQueue& scheduler) {
+    static bool loadSchedule(PriorityQueue& scheduler, uint64_t* walLsn = nullptr) {
         ifstream file("schedule.dat", ios::binary);
         if (!file.is_open()) {
             return false;
@@ -275,39 +221,29 @@ public:
             task.estimatedCost = estimatedCost;
             scheduler.enqueue(task);
         }
+        if (walLsn) *walLsn = readWalLsn(file);
         
         file.close();
         return true;
     }
     
+    // Homes, lines and the setup flag in the binary format of community_file.h
     static bool saveCommunity(CommunityGraph& communityNetwork, bool& communitySetup) {
-        ofstream file("community.dat", ios::binary);
-        if (!file.is_open()) {
-            cout << "Error: Could not create community.dat" << endl;
+        if (!CommunityFile::save(communityNetwork, communitySetup, "community.dat")) {
+            cout << "Error: Could not write community.dat" << endl;
             return false;
         }
-        
-        // Write setup flag
-        file.write(reinterpret_cast<char*>(&communitySetup), sizeof(bool));
-        
-        // Note: Full community graph serialization is complex
-        // For now, we'll just save the setup flag
-        // In a complete implementation, you'd save all homes and edges
-        
-        file.close();
         return true;
     }
     
     static bool loadCommunity(CommunityGraph& communityNetwork, bool& communitySetup) {
-        ifstream file("community.dat", ios::binary);
-        if (!file.is_open()) {
-            return false;
+        if (CommunityFile::load(communityNetwork, communitySetup, "community.dat")) {
+            return true;
         }
-        
-        file.read(reinterpret_cast<char*>(&communitySetup), sizeof(bool));
-        
-        file.close();
-        return true;
+        // Missing, or an old file holding only the setup flag: no homes to
+        // restore, so the community has to be set up again
+        communitySetup = false;
+        return false;
     }
     
     // Generate comprehensive report
@@ -345,7 +281,7 @@ public:
         
         // Section 2: Device Summary
         report << ">>> SECTION 2: DEVICE SUMMARY <<<\n";
-        Device* devices[100];
+        Device** devices = new Device*[deviceRegistry.size() + 1];
         int deviceSize;
         deviceRegistry.getAllValues(devices, deviceSize);
         
@@ -360,16 +296,17 @@ public:
             report << devices[i]->deviceID << "\t\t"
                    << devices[i]->deviceName << "\t\t"
                    << devices[i]->consumptionRate << "\t\t"
-                   << devices[i]->status << "\t\t"
+                   << devices[i]->statusString() << "\t\t"
                    << devices[i]->priority << "\t\t"
                    << (devices[i]->isCritical ? "[CRITICAL]" : "[NORMAL]") << "\n";
             
-            if (devices[i]->status == "ON") {
+            if (devices[i]->isOn()) {
                 totalLoad += devices[i]->consumptionRate;
                 activeCount++;
             }
             if (devices[i]->isCritical) criticalCount++;
         }
+        delete[] devices;
         
         report << "\nActive Devices: " << activeCount << "\n";
         report << "Critical Devices: " << criticalCount << "\n";
@@ -378,7 +315,7 @@ public:
         
         // Section 3: Usage History
         report << ">>> SECTION 3: USAGE HISTORY <<<\n";
-        HistoryRecord records[100];
+        HistoryRecord* records = new HistoryRecord[historyTracker.getCount() + 1];
         int historySize;
         historyTracker.getAllRecords(records, historySize);
         
@@ -402,18 +339,17 @@ public:
         } else {
             report << "No usage history available.\n\n";
         }
+        delete[] records;
         
         // Section 4: Scheduled Tasks
         report << ">>> SECTION 4: SCHEDULED TASKS <<<\n";
         
         // Extract tasks without modifying queue
-        ScheduledTask tasks[100];
-        int scheduleSize = 0;
-        PriorityQueue tempQueue;
-        
+        DynamicArray<ScheduledTask> tasks(scheduler.getSize() + 1);
         while (!scheduler.isEmpty()) {
-            tasks[scheduleSize++] = scheduler.dequeue();
+            tasks.push(scheduler.dequeue());
         }
+        int scheduleSize = tasks.size();
         
         // Restore queue
         for (int i = 0; i < scheduleSize; i++) {
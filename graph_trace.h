@@ -0,0 +1,83 @@
+#ifndef GRAPH_TRACE_H
+#define GRAPH_TRACE_H
+
+using namespace std;
+
+// Optional tracing for the community graph algorithms.
+// The algorithms never print; when a TraceSink is attached they report
+// what they do as small events, and the sink decides what to do with them
+// (keep the last N in memory, print them, count them...). With no sink
+// attached the only cost is one null-pointer check per event site.
+
+enum TraceEventType {
+    TRACE_BFS_VISIT,          // home reached by BFS: other = parent, value = level
+    TRACE_SETTLE,             // Dijkstra settled home: value = final cost
+    TRACE_RELAX,              // Dijkstra improved home via other: value = new cost
+    TRACE_PROVIDER,           // sharing found provider home: value = excess (W)
+    TRACE_TRANSFER            // sharing planned transfer home -> other: value = energy (W)
+};
+
+struct TraceEvent {
+    TraceEventType type;
+    int home;                 // dense home index
+    int other;                // related home index, -1 if none
+    float value;
+
+    TraceEvent() : type(TRACE_SETTLE), home(-1), other(-1), value(0) {}
+    TraceEvent(TraceEventType t, int h, int o, float v) : type(t), home(h), other(o), value(v) {}
+};
+
+class TraceSink {
+public:
+    virtual ~TraceSink() {}
+    virtual void record(const TraceEvent& event) = 0;
+};
+
+// Keeps the most recent `capacity` events; older ones are overwritten.
+class RingBufferTrace : public TraceSink {
+private:
+    TraceEvent* events;
+    int capacity;
+    long long total;          // events ever recorded
+
+public:
+    RingBufferTrace(int cap = 1024) : capacity(cap > 0 ? cap : 1), total(0) {
+        events = new TraceEvent[capacity];
+    }
+
+    ~RingBufferTrace() {
+        delete[] events;
+    }
+
+    void record(const TraceEvent& event) {
+        events[total % capacity] = event;
+        total++;
+    }
+
+    // Number of events currently held (at most capacity)
+    int size() const { return total < capacity ? (int)total : capacity; }
+    long long totalRecorded() const { return total; }
+
+    // i = 0 is the oldest event still held
+    const TraceEvent& at(int i) const {
+        long long first = total < capacity ? 0 : total - capacity;
+        return events[(first + i) % capacity];
+    }
+
+    void clear() { total = 0; }
+};
+
+class CommunityGraph;
+
+// Prints each event as it happens, in the old console format.
+// Defined in community_graph.cpp because it needs home IDs.
+class ConsoleTrace : public TraceSink {
+private:
+    CommunityGraph* graph;
+
+public:
+    ConsoleTrace(CommunityGraph* g) : graph(g) {}
+    void record(const TraceEvent& event);
+};
+
+#endif // GRAPH_TRACE_H
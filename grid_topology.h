@@ -0,0 +1,151 @@
+#ifndef GRID_TOPOLOGY_H
+#define GRID_TOPOLOGY_H
+
+#include <string>
+#include "dynamic_array.h"
+using namespace std;
+
+// Distribution grid above the homes: a tree of grid nodes (substation at the
+// root, then transformers, feeders, ...) with every home hanging off one of
+// them. Each node has a rating (W) for power crossing its link to the parent.
+//
+// Every node keeps running sums over its subtree:
+//   surplus  = sum of positive home excess below it (W)
+//   load     = sum of home deficits below it (W)
+//   reserved = energy shared between homes that crosses its link (W)
+// A home's excess change is pushed up its ancestor chain, and a transfer
+// from home a to home b only crosses the links on the tree path a -> LCA -> b
+// (the LCA's own link is not used), so both cost O(depth), never a full
+// recomputation. CommunityGraph keeps the home sums in step once attached
+// (attachGrid) and sharing plans stay within headroom().
+class GridTopology {
+public:
+    static const int ROOT = 0;
+    static constexpr float UNLIMITED = 1e12f;
+
+private:
+    DynamicArray<int> parent;         // per node, -1 at the root
+    DynamicArray<int> depth;          // root = 0
+    DynamicArray<float> rating;
+    DynamicArray<float> reserved;
+    DynamicArray<double> surplus;
+    DynamicArray<double> load;
+    DynamicArray<string> names;
+
+    DynamicArray<int> homeNode;       // per home index, -1 if not attached
+    DynamicArray<float> homeExcess;   // last excess pushed for the home
+
+    // Walks a and b up to their lowest common ancestor, calling
+    // visit(node) for every node whose link the path crosses
+    template <class Visit>
+    int walkPath(int a, int b, Visit visit) const {
+        while (depth[a] > depth[b]) { visit(a); a = parent[a]; }
+        while (depth[b] > depth[a]) { visit(b); b = parent[b]; }
+        while (a != b) {
+            visit(a);
+            visit(b);
+            a = parent[a];
+            b = parent[b];
+        }
+        return a;
+    }
+
+    void addToAncestors(int node, double surplusDelta, double loadDelta) {
+        for (int v = node; v != -1; v = parent[v]) {
+            surplus[v] += surplusDelta;
+            load[v] += loadDelta;
+        }
+    }
+
+public:
+    GridTopology(float substationRating = UNLIMITED) {
+        parent.push(-1);
+        depth.push(0);
+        rating.push(substationRating);
+        reserved.push(0);
+        surplus.push(0);
+        load.push(0);
+        names.push("Substation");
+    }
+
+    // New transformer / feeder below `parentNode`; returns its node id
+    int addNode(int parentNode, float nodeRating, const string& name) {
+        int id = parent.size();
+        parent.push(parentNode);
+        depth.push(depth[parentNode] + 1);
+        rating.push(nodeRating);
+        reserved.push(0);
+        surplus.push(0);
+        load.push(0);
+        names.push(name);
+        return id;
+    }
+
+    // Hangs home (dense graph index) off `node`; re-attaching moves it
+    void attachHome(int home, int node, float excess = 0) {
+        while (homeNode.size() <= home) {
+            homeNode.push(-1);
+            homeExcess.push(0);
+        }
+        if (homeNode[home] != -1) {
+            float old = homeExcess[home];
+            addToAncestors(homeNode[home], old > 0 ? -old : 0, old < 0 ? old : 0);
+        }
+        homeNode[home] = node;
+        homeExcess[home] = 0;
+        setHomeExcess(home, excess);
+    }
+
+    // O(depth): moves the home's contribution in every ancestor's sums
+    void setHomeExcess(int home, float excess) {
+        if (home >= homeNode.size() || homeNode[home] == -1) return;
+        float old = homeExcess[home];
+        double ds = (excess > 0 ? excess : 0) - (old > 0 ? old : 0);
+        double dl = (excess < 0 ? -excess : 0) - (old < 0 ? -old : 0);
+        homeExcess[home] = excess;
+        if (ds != 0 || dl != 0) addToAncestors(homeNode[home], ds, dl);
+    }
+
+    // Power a transfer from home a to home b could still get through every
+    // link on its path (UNLIMITED if either home is not on the grid). O(depth)
+    float pathHeadroom(int fromHome, int toHome) const {
+        int a = nodeOf(fromHome), b = nodeOf(toHome);
+        if (a == -1 || b == -1) return UNLIMITED;
+        float room = UNLIMITED;
+        walkPath(a, b, [&](int v) {
+            float h = rating[v] - reserved[v];
+            if (h < room) room = h;
+        });
+        return room > 0 ? room : 0;
+    }
+
+    // Books (or with a negative amount, releases) a transfer on its path
+    void reserve(int fromHome, int toHome, float energy) {
+        int a = nodeOf(fromHome), b = nodeOf(toHome);
+        if (a == -1 || b == -1) return;
+        walkPath(a, b, [&](int v) { reserved[v] += energy; });
+    }
+    void release(int fromHome, int toHome, float energy) { reserve(fromHome, toHome, -energy); }
+
+    // New interval: nothing shared yet
+    void clearReservations() {
+        for (int v = 0; v < reserved.size(); v++) reserved[v] = 0;
+    }
+
+    int lowestCommonAncestor(int nodeA, int nodeB) const {
+        return walkPath(nodeA, nodeB, [](int) {});
+    }
+
+    int nodeOf(int home) const { return home < homeNode.size() ? homeNode[home] : -1; }
+    int nodeCount() const { return parent.size(); }
+    int parentOf(int node) const { return parent[node]; }
+    int depthOf(int node) const { return depth[node]; }
+    const string& nameOf(int node) const { return names[node]; }
+    float ratingOf(int node) const { return rating[node]; }
+    float reservedOf(int node) const { return reserved[node]; }
+    float headroom(int node) const { return rating[node] - reserved[node]; }
+    double subtreeSurplus(int node) const { return surplus[node]; }
+    double subtreeLoad(int node) const { return load[node]; }
+};
+
+#endif // GRID_TOPOLOGY_H
@@ -80,7 +80,15 @@ public:
         table_size = new_size;
     }
     
-    void insert(K key, V value) {
+    // Grows the table once for `expected` entries, so bulk inserts don't
+    // rehash everything at every doubling
+    void reserve(int expected) {
+        int wanted = table_size;
+        while ((double)expected / wanted > load_factor_threshold) wanted *= 2;
+        if (wanted > table_size) resize(wanted);
+    }
+    
+    void insert(const K& key, V value) {
         unsigned int hash = hashFunction(key);
         HashNode<K, V>* entry = table[hash];
         
@@ -101,7 +109,28 @@ public:
         }
     }
     
-    V* get(K key) {
+    // Looks the key up and inserts (key, value) if it is missing, with one
+    // hash and one chain walk. Returns the stored value; inserted tells which.
+    V* getOrInsert(const K& key, V value, bool& inserted) {
+        unsigned int hash = hashFunction(key);
+        for (HashNode<K, V>* entry = table[hash]; entry != nullptr; entry = entry->next) {
+            if (entry->key == key) {
+                inserted = false;
+                return &(entry->value);
+            }
+        }
+        HashNode<K, V>* entry = new HashNode<K, V>(key, value);
+        entry->next = table[hash];
+        table[hash] = entry;
+        count++;
+        inserted = true;
+        if ((double)count / table_size > load_factor_threshold) {
+            resize(table_size * 2);
+        }
+        return &(entry->value);
+    }
+    
+    V* get(const K& key) {
         unsigned int hash = hashFunction(key);
         HashNode<K, V>* entry = table[hash];
         
@@ -114,7 +143,7 @@ public:
         return nullptr;
     }
     
-    bool remove(K key) {
+    bool remove(const K& key) {
         unsigned int hash = hashFunction(key);
         HashNode<K, V>* entry = table[hash];
         HashNode<K, V>* prev = nullptr;
@@ -136,7 +165,7 @@ public:
         return false;
     }
     
-    bool contains(K key) {
+    bool contains(const K& key) {
         return get(key) != nullptr;
     }
     
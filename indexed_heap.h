@@ -0,0 +1,105 @@
+#ifndef INDEXED_HEAP_H
+#define INDEXED_HEAP_H
+
+using namespace std;
+
+// Min-heap (4-ary) over item indices 0..n-1 with a position table, so an
+// item's key can be decreased in O(log n) without searching for it.
+// Used by the shortest-path routines on CommunityGraph (dense home indices).
+class IndexedMinHeap {
+private:
+    struct Entry {
+        float key;
+        int item;
+    };
+    
+    Entry* heap;      // keys kept inline so sifting doesn't chase keys[item]
+    int* pos;         // pos[item] = index in heap, -1 if not queued
+    int size;
+    int capacity;
+
+    // 4-ary layout: shallower tree, children share a cache line
+    void place(int i, const Entry& e) {
+        heap[i] = e;
+        pos[e.item] = i;
+    }
+
+    void heapifyUp(int i) {
+        Entry e = heap[i];
+        while (i > 0) {
+            int p = (i - 1) / 4;
+            if (e.key >= heap[p].key) break;
+            place(i, heap[p]);
+            i = p;
+        }
+        place(i, e);
+    }
+
+    void heapifyDown(int i) {
+        Entry e = heap[i];
+        while (true) {
+            int first = 4 * i + 1;
+            if (first >= size) break;
+            int last = first + 4 < size ? first + 4 : size;
+            int smallest = first;
+            for (int c = first + 1; c < last; c++) {
+                if (heap[c].key < heap[smallest].key) smallest = c;
+            }
+            if (heap[smallest].key >= e.key) break;
+            place(i, heap[smallest]);
+            i = smallest;
+        }
+        place(i, e);
+    }
+
+public:
+    IndexedMinHeap(int n) : size(0), capacity(n) {
+        heap = new Entry[n > 0 ? n : 1];
+        pos = new int[n > 0 ? n : 1];
+        for (int i = 0; i < n; i++) pos[i] = -1;
+    }
+
+    ~IndexedMinHeap() {
+        delete[] heap;
+        delete[] pos;
+    }
+
+    bool isEmpty() const { return size == 0; }
+    int getSize() const { return size; }
+    bool contains(int item) const { return pos[item] != -1; }
+    float keyOf(int item) const { return heap[pos[item]].key; }
+    int peekMin() const { return heap[0].item; }
+    float peekMinKey() const { return heap[0].key; }
+
+    // Inserts the item, or lowers its key if already queued with a larger key
+    void pushOrDecrease(int item, float key) {
+        int i = pos[item];
+        if (i == -1) {
+            heap[size].key = key;
+            heap[size].item = item;
+            pos[item] = size;
+            heapifyUp(size++);
+        } else if (key < heap[i].key) {
+            heap[i].key = key;
+            heapifyUp(i);
+        }
+    }
+
+    int popMin() {
+        int top = heap[0].item;
+        pos[top] = -1;
+        if (--size > 0) {
+            heap[0] = heap[size];
+            heapifyDown(0);
+        }
+        return top;
+    }
+
+    // Empties the heap in O(size) so it can be reused for another search
+    void clear() {
+        for (int i = 0; i < size; i++) pos[heap[i].item] = -1;
+        size = 0;
+    }
+};
+
+#endif // INDEXED_HEAP_H
@@ -0,0 +1,162 @@
+#ifndef LOAD_SHEDDING_H
+#define LOAD_SHEDDING_H
+
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include "device_table.h"
+using namespace std;
+
+// Optimizing load-shedding solver.
+//
+// Problem: from the active non-critical devices pick a set that frees at
+// least `required` watts while minimizing the priority-weighted loss
+//     loss(device) = priority * watts / 1000
+// This is a covering 0/1 knapsack. We solve it with a DP over quantized
+// watts: device watts are rounded DOWN and the target UP to the quantum, so
+// any DP-feasible set is guaranteed to really free >= required watts.
+// A hard time budget is checked while filling the table; if it runs out
+// (or the DP finds nothing) the caller falls back to the greedy heap order.
+
+enum SheddingMode { SHED_GREEDY, SHED_OPTIMAL };
+
+struct SheddingReport {
+    float requested;
+    float freed;
+    float loss;           // priority-weighted loss of the shed set
+    float lowerBound;     // fractional (LP) lower bound on the optimal loss
+    float gap;            // (loss - lowerBound) / lowerBound, 0 when exact
+    double latencyMs;
+    int shedCount;
+    bool usedOptimizer;   // true if the DP produced the shed set
+    bool usedFallback;    // true if the DP timed out / failed and greedy was used
+    bool overBudget;      // the fallback was because the DP ran out of time
+
+    SheddingReport() : requested(0), freed(0), loss(0), lowerBound(0), gap(0),
+                       latencyMs(0), shedCount(0), usedOptimizer(false), usedFallback(false),
+                       overBudget(false) {}
+};
+
+class LoadSheddingSolver {
+public:
+    static const int MAX_BINS = 4096;              // target resolution of the watt axis
+    static const long long MAX_WORK = 8000000;     // cap on candidates x bins (fill time and bit table)
+    // Default budget: with MAX_WORK the DP over 10k candidates takes ~8 ms,
+    // so this leaves several times that before falling back to greedy
+    static constexpr double DEFAULT_BUDGET_MS = 50.0;
+
+    static float lossOf(int priority, float watts) {
+        return priority * watts / 1000.0f;
+    }
+
+    // Fractional cover bound: loss per watt is just priority/1000, so take
+    // candidates in priority order and the last one fractionally. O(n) via
+    // per-priority buckets, no sort.
+    static float lowerBound(const DeviceTable& table, float required) {
+        double bucket[256];
+        for (int p = 0; p < 256; p++) bucket[p] = 0;
+        int n = table.shedCandidateCount();
+        for (int i = 0; i < n; i++) {
+            int slot = table.shedCandidateAt(i);
+            bucket[table.getPriority(slot)] += table.getRate(slot);
+        }
+
+        double need = required, bound = 0;
+        for (int p = 0; p < 256 && need > 0; p++) {
+            double take = bucket[p] < need ? bucket[p] : need;
+            bound += p * take / 1000.0;
+            need -= take;
+        }
+        return (float)bound;
+    }
+
+    // Fills `chosen` with table slots to shed. Returns false if the budget
+    // ran out (*timedOut set) or no feasible set exists (caller should use
+    // greedy instead).
+    static bool solveOptimal(const DeviceTable& table, float required, double budgetMs,
+                             int* chosen, int& chosenCount, bool* timedOutOut = nullptr) {
+        chosenCount = 0;
+        if (timedOutOut) *timedOutOut = false;
+        if (required <= 0) return true;
+
+        auto start = chrono::steady_clock::now();
+        int n = table.shedCandidateCount();
+        if (n == 0) return false;
+
+        // Pick the quantum so the fill stays within MAX_WORK cell updates:
+        // many candidates get a coarser watt axis instead of a slower DP
+        int bins = MAX_BINS;
+        if ((long long)n * (bins + 1) > MAX_WORK) {
+            bins = (int)(MAX_WORK / n) - 1;
+            if (bins < 16) return false;           // too many candidates for a useful DP
+        }
+        double quantum = required / bins;
+        if (quantum < 1.0) quantum = 1.0;          // never finer than 1 W
+        int C = (int)ceil(required / quantum);
+
+        int* units = new int[n];
+        float* loss = new float[n];
+        for (int i = 0; i < n; i++) {
+            int slot = table.shedCandidateAt(i);
+            units[i] = (int)floor(table.getRate(slot) / quantum);
+            loss[i] = lossOf(table.getPriority(slot), table.getRate(slot));
+        }
+
+        const float INF = 1e30f;
+        float* dp = new float[C + 1];              // dp[c] = min loss covering >= c units
+        for (int c = 0; c <= C; c++) dp[c] = INF;
+        dp[0] = 0;
+
+        int rowWords = (C + 1 + 63) / 64;
+        uint64_t* keep = new uint64_t[(size_t)n * rowWords];
+        memset(keep, 0, sizeof(uint64_t) * (size_t)n * rowWords);
+        int* capSource = new int[n];               // source cell when the target was capped at C
+
+        bool timedOut = false;
+        for (int i = 0; i < n && !timedOut; i++) {
+            capSource[i] = -1;
+            int w = units[i];
+            if (w > 0) {
+                uint64_t* row = keep + (size_t)i * rowWords;
+                // Descending so every item is used at most once
+                for (int c = C; c >= 0; c--) {
+                    if (dp[c] >= INF) continue;
+                    int target = c + w < C ? c + w : C;
+                    float candidate = dp[c] + loss[i];
+                    if (candidate < dp[target]) {
+                        dp[target] = candidate;
+                        row[target >> 6] |= (1ULL << (target & 63));
+                        if (target == C) capSource[i] = c;
+                    }
+                }
+            }
+            if ((i & 63) == 63) {
+                double elapsed = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+                if (elapsed > budgetMs) timedOut = true;
+            }
+        }
+
+        if (timedOutOut) *timedOutOut = timedOut;
+        bool ok = !timedOut && dp[C] < INF;
+        if (ok) {
+            // Walk the decisions back from the full-cover cell
+            int cell = C;
+            for (int i = n - 1; i >= 0 && cell > 0; i--) {
+                uint64_t* row = keep + (size_t)i * rowWords;
+                if (row[cell >> 6] & (1ULL << (cell & 63))) {
+                    chosen[chosenCount++] = table.shedCandidateAt(i);
+                    cell = (cell == C) ? capSource[i] : cell - units[i];
+                }
+            }
+        }
+
+        delete[] units;
+        delete[] loss;
+        delete[] dp;
+        delete[] keep;
+        delete[] capSource;
+        return ok;
+    }
+};
+
+#endif // LOAD_SHEDDING_H
@@ -0,0 +1,163 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <fstream>
+#include <string>
+#include <cstdio>
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#else
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <io.h>
+#endif
+using namespace std;
+
+// Read-only view of a whole file: mmap'ed on POSIX, so opening costs no
+// copy and pages come in as they are touched. On Windows (no mmap here) the
+// file is read into one buffer with a single ifstream read instead.
+class MappedFile {
+private:
+    const char* bytes;
+    size_t length;
+    bool mapped;                  // true: munmap, false: delete[]
+
+public:
+    MappedFile() : bytes(nullptr), length(0), mapped(false) {}
+
+    ~MappedFile() {
+        close();
+    }
+
+    bool open(const string& path) {
+        close();
+#ifndef _WIN32
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat info;
+        if (fstat(fd, &info) != 0 || info.st_size <= 0) {
+            ::close(fd);
+            return false;
+        }
+        void* p = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);                              // the mapping keeps the file alive
+        if (p == MAP_FAILED) return false;
+        bytes = (const char*)p;
+        length = (size_t)info.st_size;
+        mapped = true;
+        return true;
+#else
+        ifstream file(path.c_str(), ios::binary | ios::ate);
+        if (!file.is_open()) return false;
+        streamoff size = file.tellg();
+        if (size <= 0) return false;
+        char* buffer = new char[(size_t)size];
+        file.seekg(0);
+        if (!file.read(buffer, size)) {
+            delete[] buffer;
+            return false;
+        }
+        bytes = buffer;
+        length = (size_t)size;
+        mapped = false;
+        return true;
+#endif
+    }
+
+    void close() {
+        if (!bytes) return;
+#ifndef _WIN32
+        if (mapped) munmap((void*)bytes, length);
+        else delete[] bytes;
+#else
+        delete[] bytes;
+#endif
+        bytes = nullptr;
+        length = 0;
+    }
+
+    const char* data() const { return bytes; }
+    size_t size() const { return length; }
+
+    // Pointer to count objects of T at byte offset, or nullptr if that
+    // would run past the end of the file
+    template <class T>
+    const T* at(unsigned long long offset, unsigned long long count = 1) const {
+        if (offset > length || count > (length - offset) / sizeof(T)) return nullptr;
+        return (const T*)(bytes + offset);
+    }
+};
+
+#ifndef _WIN32
+// fsync on the directory holding `path`, so a rename in it is on disk too
+inline bool syncParentDirectory(const string& path) {
+    size_t slash = path.rfind('/');
+    string dir = slash == string::npos ? "." : (slash == 0 ? "/" : path.substr(0, slash));
+    int fd = ::open(dir.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    bool ok = fsync(fd) == 0;
+    ::close(fd);
+    return ok;
+}
+#endif
+
+// Writes a whole file through a temp file + rename, so a crash leaves the
+// old file or the new one, never half of one. durable: fsync the data
+// before the rename and the directory after it (background checkpoints
+// use this). Windows replaces the target with MoveFileEx, since rename()
+// there fails when it exists.
+inline bool writeFileAtomically(const string& path, const char* data, size_t bytes, bool durable = false) {
+    string temp = path + ".tmp";
+#ifndef _WIN32
+    int fd = ::open(temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+#else
+    int fd = _open(temp.c_str(), _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE);
+#endif
+    if (fd < 0) return false;
+    bool ok = true;
+    while (ok && bytes > 0) {
+#ifndef _WIN32
+        long n = ::write(fd, data, bytes);
+#else
+        long n = _write(fd, data, (unsigned)(bytes < 0x40000000 ? bytes : 0x40000000));
+#endif
+        if (n <= 0) ok = false;
+        else {
+            data += n;
+            bytes -= n;
+        }
+    }
+#ifndef _WIN32
+    if (ok && durable && fsync(fd) != 0) ok = false;
+    if (::close(fd) != 0) ok = false;
+#else
+    if (ok && durable && _commit(fd) != 0) ok = false;
+    if (_close(fd) != 0) ok = false;
+#endif
+    if (!ok) {
+        remove(temp.c_str());
+        return false;
+    }
+#ifndef _WIN32
+    if (rename(temp.c_str(), path.c_str()) != 0) return false;
+    return !durable || syncParentDirectory(path);
+#else
+    return MoveFileExA(temp.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#endif
+}
+
+inline bool writeFileAtomically(const string& path, const string& bytes, bool durable = false) {
+    return writeFileAtomically(path, bytes.data(), bytes.size(), durable);
+}
+
+#endif // MAPPED_FILE_H
@@ -0,0 +1,209 @@
+#ifndef MIN_COST_FLOW_H
+#define MIN_COST_FLOW_H
+
+#include "dynamic_array.h"
+#include "indexed_heap.h"
+using namespace std;
+
+// Min-cost flow by successive shortest paths with node potentials.
+// Arcs are stored in pairs (arc e and its residual twin e ^ 1) with a
+// per-node singly linked list (head / next) so adding an arc is O(1).
+// Every augmenting path is found with Dijkstra on reduced costs
+//     cost(u,v) + potential[u] - potential[v]  (>= 0)
+// using IndexedMinHeap, so each augmentation is O((V + E) log V).
+// All input costs must be >= 0 (true for distances), so the potentials can
+// start at zero without a Bellman-Ford pass.
+class MinCostFlow {
+public:
+    static constexpr float EPS = 1e-3f;            // flows below this are noise (W)
+    static constexpr float UNLIMITED = 1e12f;      // "no capacity limit"
+    static constexpr float UNREACHABLE_COST = 1e30f;
+
+private:
+    struct Arc {
+        int to;
+        int next;         // next arc leaving the same node, -1 = end
+        float cap;        // residual capacity
+        float cost;       // per unit of flow
+    };
+
+    DynamicArray<Arc> arcs;
+    int* head;
+    int nodeCount;
+
+    // Per-solve scratch
+    float* potential;
+    float* dist;
+    int* parentArc;
+
+    // Decomposition scratch (allocated on first nextFlowPath)
+    float* remaining;
+    int* onPath;
+
+public:
+    MinCostFlow(int n) : nodeCount(n), remaining(nullptr), onPath(nullptr) {
+        head = new int[n];
+        potential = new float[n];
+        dist = new float[n];
+        parentArc = new int[n];
+        for (int i = 0; i < n; i++) head[i] = -1;
+    }
+
+    ~MinCostFlow() {
+        delete[] head;
+        delete[] potential;
+        delete[] dist;
+        delete[] parentArc;
+        delete[] remaining;
+        delete[] onPath;
+    }
+
+    // Adds u -> v and returns its arc id; flowOn(id) reads the flow later
+    int addArc(int u, int v, float capacity, float cost) {
+        int id = arcs.size();
+        Arc forward = { v, head[u], capacity, cost };
+        arcs.push(forward);
+        head[u] = id;
+        Arc backward = { u, head[v], 0, -cost };
+        arcs.push(backward);
+        head[v] = id + 1;
+        return id;
+    }
+
+    // Flow currently on an arc added with addArc (= capacity used of its twin)
+    float flowOn(int arcId) const { return arcs[arcId ^ 1].cap; }
+
+    // Pushes as much flow as possible from s to t, cheapest paths first.
+    // Stops early once the cheapest remaining path costs more than
+    // maxUnitCost per unit (e.g. when buying from the grid would be cheaper).
+    // Returns the total flow; totalCost receives its cost.
+    float solve(int s, int t, float maxUnitCost, float& totalCost, int* augmentations = nullptr) {
+        float totalFlow = 0;
+        totalCost = 0;
+        int rounds = 0;
+        for (int i = 0; i < nodeCount; i++) potential[i] = 0;
+
+        IndexedMinHeap pq(nodeCount);
+        while (true) {
+            // Dijkstra on reduced costs
+            for (int i = 0; i < nodeCount; i++) {
+                dist[i] = UNREACHABLE_COST;
+                parentArc[i] = -1;
+            }
+            dist[s] = 0;
+            pq.clear();
+            pq.pushOrDecrease(s, 0);
+            while (!pq.isEmpty()) {
+                int u = pq.popMin();
+                for (int e = head[u]; e != -1; e = arcs[e].next) {
+                    const Arc& a = arcs[e];
+                    if (a.cap <= EPS) continue;
+                    float reduced = a.cost + potential[u] - potential[a.to];
+                    if (reduced < 0) reduced = 0;       // rounding noise only
+                    float nd = dist[u] + reduced;
+                    if (nd < dist[a.to]) {
+                        dist[a.to] = nd;
+                        parentArc[a.to] = e;
+                        pq.pushOrDecrease(a.to, nd);
+                    }
+                }
+            }
+            if (dist[t] >= UNREACHABLE_COST) break;
+
+            // Unreached nodes keep their distance capped so potentials stay finite
+            for (int i = 0; i < nodeCount; i++) {
+                potential[i] += (dist[i] < UNREACHABLE_COST) ? dist[i] : dist[t];
+            }
+
+            float unitCost = potential[t] - potential[s];
+            if (unitCost > maxUnitCost) break;
+
+            float push = UNLIMITED;
+            for (int v = t; v != s; v = arcs[parentArc[v] ^ 1].to) {
+                float c = arcs[parentArc[v]].cap;
+                if (c < push) push = c;
+            }
+            for (int v = t; v != s; v = arcs[parentArc[v] ^ 1].to) {
+                arcs[parentArc[v]].cap -= push;
+                arcs[parentArc[v] ^ 1].cap += push;
+            }
+            totalFlow += push;
+            totalCost += push * unitCost;
+            rounds++;
+        }
+
+        if (augmentations) *augmentations = rounds;
+        return totalFlow;
+    }
+
+    // Flow decomposition: each call peels one s -> t path off the solved
+    // flow, writes its nodes (s first) into `path` - and, if asked, the arc
+    // ids between them into `arcPath` - and returns the amount on it; 0 once
+    // everything has been peeled. Flow cycles (only possible over zero-cost
+    // arcs) are cancelled along the way.
+    float nextFlowPath(int s, int t, DynamicArray<int>& path, DynamicArray<int>* arcPath = nullptr) {
+        if (!remaining) {
+            int pairs = arcs.size() / 2;
+            remaining = new float[pairs];
+            onPath = new int[nodeCount];
+            for (int p = 0; p < pairs; p++) remaining[p] = flowOn(2 * p);
+            for (int i = 0; i < nodeCount; i++) onPath[i] = -1;
+        }
+
+        DynamicArray<int> via;                     // arc used to reach path[i]
+        while (true) {
+            for (int i = 0; i < path.size(); i++) onPath[path[i]] = -1;
+            path.clear();
+            via.clear();
+            path.push(s);
+            via.push(-1);
+            onPath[s] = 0;
+
+            bool restart = false;
+            while (path.back() != t && !restart) {
+                int u = path.back();
+                int e = head[u];
+                while (e != -1 && ((e & 1) || remaining[e >> 1] <= EPS)) e = arcs[e].next;
+
+                if (e == -1) {
+                    if (u == s) {                   // nothing left
+                        onPath[s] = -1;
+                        path.clear();
+                        return 0;
+                    }
+                    remaining[via.back() >> 1] = 0; // dead end = rounding noise
+                    restart = true;
+                } else if (onPath[arcs[e].to] != -1) {
+                    // Cycle path[k..] -> back to path[k]: cancel it
+                    int k = onPath[arcs[e].to];
+                    float amount = remaining[e >> 1];
+                    for (int i = k + 1; i < via.size(); i++) {
+                        if (remaining[via[i] >> 1] < amount) amount = remaining[via[i] >> 1];
+                    }
+                    remaining[e >> 1] -= amount;
+                    for (int i = k + 1; i < via.size(); i++) remaining[via[i] >> 1] -= amount;
+                    restart = true;
+                } else {
+                    onPath[arcs[e].to] = path.size();
+                    path.push(arcs[e].to);
+                    via.push(e);
+                }
+            }
+            if (restart) continue;
+
+            float amount = UNLIMITED;
+            for (int i = 1; i < via.size(); i++) {
+                if (remaining[via[i] >> 1] < amount) amount = remaining[via[i] >> 1];
+            }
+            for (int i = 1; i < via.size(); i++) remaining[via[i] >> 1] -= amount;
+            for (int i = 0; i < path.size(); i++) onPath[path[i]] = -1;
+            if (arcPath) {
+                arcPath->clear();
+                for (int i = 1; i < via.size(); i++) arcPath->push(via[i]);
+            }
+            return amount;
+        }
+    }
+};
+
+#endif // MIN_COST_FLOW_H
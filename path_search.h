@@ -0,0 +1,95 @@
+#ifndef PATH_SEARCH_H
+#define PATH_SEARCH_H
+
+#include "dynamic_array.h"
+#include "indexed_heap.h"
+using namespace std;
+
+// Point-to-point cheapest path queries (findCheapestPath, cheapestPath).
+// A full Dijkstra tree settles every home in the neighborhood even when
+// the target is two hops away. These searches stop as soon as the answer
+// is known:
+//   PATH_DIJKSTRA       stop when the target is settled
+//   PATH_BIDIRECTIONAL  grow from both ends (lines are undirected) and stop
+//                       once the two frontiers can't improve the best meeting
+//   PATH_ASTAR          Dijkstra ordered by cost + straight-line bound to the
+//                       target (only on geographic graphs, see heuristicCost)
+//   PATH_TREE           the DistanceOracle's cached full tree of the source
+//   PATH_AUTO           cached tree if there is one, else A* if available,
+//                       else bidirectional
+// Methods are defined in community_graph.cpp.
+
+enum PathSearchMode {
+    PATH_AUTO,
+    PATH_TREE,
+    PATH_DIJKSTRA,
+    PATH_BIDIRECTIONAL,
+    PATH_ASTAR
+};
+
+struct PathQuery {
+    float cost;                   // Rs per kWh, UNREACHABLE if no path
+    DynamicArray<int> nodes;      // source ... target (empty if no path)
+    int settled;                  // homes taken off the heap(s)
+    PathSearchMode mode;          // what actually ran
+
+    PathQuery() : cost(1e30f), settled(0), mode(PATH_AUTO) {}
+};
+
+// dist / parent for one search direction, reused between queries. A home's
+// entry only counts if its stamp equals the current epoch, so starting a new
+// query is O(1) instead of clearing n entries.
+class SearchSpace {
+private:
+    float* dist;
+    int* parent;
+    unsigned int* stamp;
+    unsigned int epoch;
+    int capacity;
+
+public:
+    IndexedMinHeap* heap;
+
+    SearchSpace() : dist(nullptr), parent(nullptr), stamp(nullptr), epoch(0), capacity(0), heap(nullptr) {}
+
+    ~SearchSpace() {
+        delete[] dist;
+        delete[] parent;
+        delete[] stamp;
+        delete heap;
+    }
+
+    // New query over n homes
+    void begin(int n) {
+        if (n > capacity) {
+            delete[] dist;
+            delete[] parent;
+            delete[] stamp;
+            delete heap;
+            capacity = n > 2 * capacity ? n : 2 * capacity;
+            dist = new float[capacity];
+            parent = new int[capacity];
+            stamp = new unsigned int[capacity];
+            for (int i = 0; i < capacity; i++) stamp[i] = 0;
+            heap = new IndexedMinHeap(capacity);
+            epoch = 0;
+        }
+        heap->clear();
+        if (++epoch == 0) {                       // wrapped: stale stamps could match
+            for (int i = 0; i < capacity; i++) stamp[i] = 0;
+            epoch = 1;
+        }
+    }
+
+    bool reached(int v) const { return stamp[v] == epoch; }
+    float distOf(int v) const { return stamp[v] == epoch ? dist[v] : 1e30f; }
+    int parentOf(int v) const { return parent[v]; }
+
+    void set(int v, float d, int p) {
+        stamp[v] = epoch;
+        dist[v] = d;
+        parent[v] = p;
+    }
+};
+
+#endif // PATH_SEARCH_H
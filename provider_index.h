@@ -0,0 +1,158 @@
+#ifndef PROVIDER_INDEX_H
+#define PROVIDER_INDEX_H
+
+#include "dynamic_array.h"
+using namespace std;
+
+// Homes with surplus energy, per connected component, largest surplus first.
+// One indexed binary max-heap per component root (pos[] gives each home's
+// slot, so a changed excess is re-sifted in O(log n)). When two components
+// merge, the smaller heap is poured into the larger one (small-to-large),
+// so every home moves O(log n) times over the life of the graph.
+// Kept in step with ComponentIndex by CommunityGraph.
+class ProviderIndex {
+private:
+    DynamicArray<DynamicArray<int>*> heaps;   // by component root, nullptr = empty
+    DynamicArray<float> key;                  // current excess of each home
+    DynamicArray<int> pos;                    // slot in its component heap, -1 if absent
+
+    void place(DynamicArray<int>& h, int i, int home) {
+        h[i] = home;
+        pos[home] = i;
+    }
+
+    void siftUp(DynamicArray<int>& h, int i) {
+        int home = h[i];
+        while (i > 0) {
+            int p = (i - 1) / 2;
+            if (key[h[p]] >= key[home]) break;
+            place(h, i, h[p]);
+            i = p;
+        }
+        place(h, i, home);
+    }
+
+    void siftDown(DynamicArray<int>& h, int i) {
+        int home = h[i];
+        int n = h.size();
+        while (true) {
+            int c = 2 * i + 1;
+            if (c >= n) break;
+            if (c + 1 < n && key[h[c + 1]] > key[h[c]]) c++;
+            if (key[h[c]] <= key[home]) break;
+            place(h, i, h[c]);
+            i = c;
+        }
+        place(h, i, home);
+    }
+
+    DynamicArray<int>& heapOf(int root) {
+        if (!heaps[root]) heaps[root] = new DynamicArray<int>(4);
+        return *heaps[root];
+    }
+
+    void insert(int root, int home) {
+        DynamicArray<int>& h = heapOf(root);
+        h.push(home);
+        siftUp(h, h.size() - 1);
+    }
+
+    void remove(int root, int home) {
+        DynamicArray<int>& h = *heaps[root];
+        int i = pos[home];
+        pos[home] = -1;
+        int last = h.pop();
+        if (i < h.size()) {
+            place(h, i, last);
+            siftUp(h, i);
+            siftDown(h, pos[last]);
+        }
+    }
+
+public:
+    ~ProviderIndex() {
+        for (int i = 0; i < heaps.size(); i++) delete heaps[i];
+    }
+
+    // New home, alone in its own component
+    void add(float excess) {
+        int home = key.size();
+        key.push(excess);
+        pos.push(-1);
+        heaps.push(nullptr);
+        if (excess > 0) insert(home, home);
+    }
+
+    // Home's excess changed; root = its current component root
+    void update(int home, int root, float excess) {
+        float old = key[home];
+        key[home] = excess;
+        if (pos[home] == -1) {
+            if (excess > 0) insert(root, home);
+        } else if (excess <= 0) {
+            remove(root, home);
+        } else if (excess > old) {
+            siftUp(*heaps[root], pos[home]);
+        } else if (excess < old) {
+            siftDown(*heaps[root], pos[home]);
+        }
+    }
+
+    // Components `from` and `into` were merged and `into` is the new root
+    void merge(int into, int from) {
+        if (!heaps[from]) return;
+        if (!heaps[into] || heaps[into]->size() < heaps[from]->size()) {
+            DynamicArray<int>* t = heaps[into];
+            heaps[into] = heaps[from];
+            heaps[from] = t;
+        }
+        DynamicArray<int>* small = heaps[from];
+        heaps[from] = nullptr;
+        if (!small) return;
+        for (int i = 0; i < small->size(); i++) insert(into, (*small)[i]);
+        delete small;
+    }
+
+    int providerCount(int root) const { return heaps[root] ? heaps[root]->size() : 0; }
+
+    // Writes up to k homes of the component with the largest surplus into
+    // out (largest first) and returns how many. Walks the heap best-first
+    // with a small candidate heap: O(k log k), the component heap untouched.
+    int topK(int root, int k, int* out) const {
+        if (!heaps[root] || k <= 0) return 0;
+        const DynamicArray<int>& h = *heaps[root];
+        if (k > h.size()) k = h.size();
+
+        // Candidate heap of slots in h, max by key
+        int* cand = new int[2 * k + 1];
+        int candSize = 0;
+        int count = 0;
+        cand[candSize++] = 0;
+        while (count < k && candSize > 0) {
+            int best = cand[0];
+            cand[0] = cand[--candSize];
+            for (int i = 0; ; ) {                         // sift down
+                int c = 2 * i + 1;
+                if (c >= candSize) break;
+                if (c + 1 < candSize && key[h[cand[c + 1]]] > key[h[cand[c]]]) c++;
+                if (key[h[cand[c]]] <= key[h[cand[i]]]) break;
+                int t = cand[i]; cand[i] = cand[c]; cand[c] = t;
+                i = c;
+            }
+            out[count++] = h[best];
+            for (int child = 2 * best + 1; child <= 2 * best + 2 && child < h.size(); child++) {
+                int i = candSize++;
+                cand[i] = child;
+                while (i > 0 && key[h[cand[(i - 1) / 2]]] < key[h[cand[i]]]) {   // sift up
+                    int p = (i - 1) / 2;
+                    int t = cand[i]; cand[i] = cand[p]; cand[p] = t;
+                    i = p;
+                }
+            }
+        }
+        delete[] cand;
+        return count;
+    }
+};
+
+#endif // PROVIDER_INDEX_H
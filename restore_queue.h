@@ -0,0 +1,125 @@
+#ifndef RESTORE_QUEUE_H
+#define RESTORE_QUEUE_H
+
+#include <ctime>
+#include "device.h"
+using namespace std;
+
+// Devices switched off by load shedding wait here to be switched back on.
+// Max-heap on priority (most important first; same priority -> smaller
+// consumer first so it fits sooner). Two guards keep the load from
+// oscillating between shed and restore:
+//   - hysteresis: a device is only restored if the load afterwards stays
+//     at least `marginFraction * capacity` below the capacity
+//   - rate limit: at most one restore every `minIntervalSeconds`
+// Entries go stale when the user turns the device on (or the device is shed
+// again); Device::shedPending tells live entries from stale ones.
+class RestoreQueue {
+private:
+    Device** heap;
+    int capacity;
+    int size;
+    float marginFraction;
+    int minIntervalSeconds;
+    time_t lastRestoreTime;
+
+    bool higher(Device* a, Device* b) {
+        if (a->priority != b->priority) return a->priority > b->priority;
+        return a->consumptionRate < b->consumptionRate;
+    }
+
+    void swap(int i, int j) {
+        Device* t = heap[i];
+        heap[i] = heap[j];
+        heap[j] = t;
+    }
+
+    void heapifyUp(int i) {
+        while (i > 0) {
+            int p = (i - 1) / 2;
+            if (!higher(heap[i], heap[p])) break;
+            swap(i, p);
+            i = p;
+        }
+    }
+
+    void heapifyDown(int i) {
+        while (true) {
+            int best = i, l = 2 * i + 1, r = 2 * i + 2;
+            if (l < size && higher(heap[l], heap[best])) best = l;
+            if (r < size && higher(heap[r], heap[best])) best = r;
+            if (best == i) break;
+            swap(i, best);
+            i = best;
+        }
+    }
+
+    void pop() {
+        heap[0] = heap[--size];
+        heapifyDown(0);
+    }
+
+    // Drop entries whose device is no longer waiting for a restore
+    void discardStale() {
+        while (size > 0 && (!heap[0]->shedPending || heap[0]->isOn())) {
+            pop();
+        }
+    }
+
+public:
+    RestoreQueue(float margin = 0.1f, int intervalSeconds = 30)
+        : capacity(16), size(0), marginFraction(margin),
+          minIntervalSeconds(intervalSeconds), lastRestoreTime(0) {
+        heap = new Device*[capacity];
+    }
+
+    ~RestoreQueue() {
+        delete[] heap;
+    }
+
+    void configure(float margin, int intervalSeconds) {
+        marginFraction = margin;
+        minIntervalSeconds = intervalSeconds;
+    }
+
+    // Called for every device turned off by load shedding
+    void push(Device* device) {
+        if (size >= capacity) {
+            Device** bigger = new Device*[capacity * 2];
+            for (int i = 0; i < size; i++) bigger[i] = heap[i];
+            delete[] heap;
+            heap = bigger;
+            capacity *= 2;
+        }
+        device->shedPending = true;
+        heap[size] = device;
+        heapifyUp(size);
+        size++;
+    }
+
+    // Returns the next device that may be turned back on now, or nullptr.
+    // The returned device is removed from the queue; the caller turns it on.
+    Device* nextRestorable(float currentLoad, float maxCapacity, time_t now) {
+        discardStale();
+        if (size == 0) return nullptr;
+        if (lastRestoreTime != 0 && now - lastRestoreTime < minIntervalSeconds) return nullptr;
+
+        Device* top = heap[0];
+        float ceiling = maxCapacity * (1.0f - marginFraction);
+        if (currentLoad + top->consumptionRate > ceiling) return nullptr;   // keep strict priority order
+
+        pop();
+        top->shedPending = false;
+        lastRestoreTime = now;
+        return top;
+    }
+
+    bool isEmpty() {
+        discardStale();
+        return size == 0;
+    }
+
+    int getSize() { return size; }
+};
+
+#endif // RESTORE_QUEUE_H
@@ -0,0 +1,140 @@
+#ifndef SNAPSHOT_WRITER_H
+#define SNAPSHOT_WRITER_H
+
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include "mapped_file.h"
+#include "write_ahead_log.h"
+using namespace std;
+
+// One consistent view of everything the .dat files hold, taken on the
+// control thread: each file is encoded into memory (flat records and
+// memcpy'd strings, no I/O), which is all the control loop waits for.
+// `epoch` numbers the snapshots; `walLsn` is the last logged change the
+// snapshot contains (from WriteAheadLog::beginCheckpoint).
+struct PersistenceSnapshot {
+    unsigned long long epoch;
+    uint64_t walLsn;
+    string devices;
+    string history;
+    string schedule;
+    string community;
+    double captureMs;
+
+    PersistenceSnapshot() : epoch(0), walLsn(0), captureMs(0) {}
+};
+
+// Writes snapshots on its own thread: the four files (temp file, fsync,
+// rename), then completes the log checkpoint. At most one snapshot waits
+// behind the one being written; a newer one replaces it, since it covers
+// everything the older one did.
+class SnapshotWriter {
+private:
+    WriteAheadLog* log;           // optional: checkpointed after each write
+    string directory;             // prefix for the .dat paths ("" = cwd)
+
+    mutex lock;
+    condition_variable wake;
+    condition_variable idle;
+    thread worker;
+    PersistenceSnapshot* pending;
+    bool busy;
+    bool stopping;
+    bool lastOk;
+    bool failureUnseen;
+    unsigned long long writtenEpoch;
+    long long writeCount;
+    long long supersededCount;
+    double lastWriteMs;
+
+    bool writeSnapshot(const PersistenceSnapshot& s) {
+        bool ok = writeFileAtomically(directory + "devices.dat", s.devices, true);
+        ok = writeFileAtomically(directory + "history.dat", s.history, true) && ok;
+        ok = writeFileAtomically(directory + "schedule.dat", s.schedule, true) && ok;
+        ok = writeFileAtomically(directory + "community.dat", s.community, true) && ok;
+        // Only a complete set of files may replace the log records
+        if (ok && log && log->isOpen()) ok = log->completeCheckpoint(s.walLsn);
+        return ok;
+    }
+
+    void workLoop() {
+        unique_lock<mutex> guard(lock);
+        while (true) {
+            wake.wait(guard, [&] { return stopping || pending != nullptr; });
+            if (!pending) break;                              // stopping, nothing left
+            PersistenceSnapshot* s = pending;
+            pending = nullptr;
+            busy = true;
+            guard.unlock();
+
+            auto start = chrono::steady_clock::now();
+            bool ok = writeSnapshot(*s);
+            double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+            guard.lock();
+            busy = false;
+            lastOk = ok;
+            if (!ok) failureUnseen = true;
+            writtenEpoch = s->epoch;
+            writeCount++;
+            lastWriteMs = ms;
+            delete s;
+            idle.notify_all();
+        }
+    }
+
+public:
+    SnapshotWriter(WriteAheadLog* changeLog = nullptr, const string& dir = "")
+        : log(changeLog), directory(dir), pending(nullptr), busy(false), stopping(false), lastOk(true),
+          failureUnseen(false), writtenEpoch(0), writeCount(0), supersededCount(0), lastWriteMs(0) {}
+
+    // Writes whatever is still queued, then stops
+    ~SnapshotWriter() {
+        if (worker.joinable()) {
+            {
+                lock_guard<mutex> guard(lock);
+                stopping = true;
+            }
+            wake.notify_all();
+            worker.join();
+        }
+        delete pending;
+    }
+
+    // Takes ownership; returns at once
+    void submit(PersistenceSnapshot* s) {
+        lock_guard<mutex> guard(lock);
+        if (!worker.joinable()) worker = thread(&SnapshotWriter::workLoop, this);
+        if (pending) {
+            delete pending;
+            supersededCount++;
+        }
+        pending = s;
+        wake.notify_one();
+    }
+
+    // Blocks until nothing is queued or being written
+    void waitIdle() {
+        unique_lock<mutex> guard(lock);
+        idle.wait(guard, [&] { return !pending && !busy; });
+    }
+
+    bool lastWriteOk() { lock_guard<mutex> guard(lock); return lastOk; }
+    unsigned long long lastWrittenEpoch() { lock_guard<mutex> guard(lock); return writtenEpoch; }
+    long long writes() { lock_guard<mutex> guard(lock); return writeCount; }
+    long long superseded() { lock_guard<mutex> guard(lock); return supersededCount; }
+    double lastWriteDurationMs() { lock_guard<mutex> guard(lock); return lastWriteMs; }
+
+    // True once per failed write, so the control loop can report it
+    bool takeFailure() {
+        lock_guard<mutex> guard(lock);
+        bool failed = failureUnseen;
+        failureUnseen = false;
+        return failed;
+    }
+};
+
+#endif // SNAPSHOT_WRITER_H
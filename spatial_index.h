@@ -0,0 +1,171 @@
+#ifndef SPATIAL_INDEX_H
+#define SPATIAL_INDEX_H
+
+#include <algorithm>
+#include <cmath>
+#include "dynamic_array.h"
+using namespace std;
+
+// Static 2-d tree over points (x, y in km), one per home index.
+// Built once in O(n log n) by median splits (nth_element), alternating x / y
+// by depth; the tree is implicit in the point order - node [lo, hi) has its
+// split point at mid = (lo + hi) / 2, left child [lo, mid), right [mid + 1, hi).
+// Queries prune subtrees whose splitting plane is farther than the current
+// bound, so k-nearest and small-radius queries touch O(log n + k) points on
+// evenly spread homes. Rebuild after points change (CommunityGraph does it
+// lazily).
+class SpatialIndex {
+private:
+    DynamicArray<int> ids;        // home index, in tree order
+    DynamicArray<float> xs;       // coordinates, in tree order
+    DynamicArray<float> ys;
+
+    void buildRange(int lo, int hi, int depth, int* order) {
+        if (hi - lo <= 1) return;
+        int mid = (lo + hi) / 2;
+        const DynamicArray<float>& axis = (depth & 1) ? ys : xs;
+        nth_element(order + lo, order + mid, order + hi, [&](int a, int b) {
+            return axis[a] < axis[b];
+        });
+        buildRange(lo, mid, depth + 1, order);
+        buildRange(mid + 1, hi, depth + 1, order);
+    }
+
+    // Bounded max-heap of (squared distance, slot) for k-nearest
+    struct Candidates {
+        int k;
+        int size;
+        float* d2;
+        int* slot;
+
+        Candidates(int kk) : k(kk), size(0), d2(new float[kk]), slot(new int[kk]) {}
+        ~Candidates() { delete[] d2; delete[] slot; }
+
+        float bound() const { return size < k ? 1e30f : d2[0]; }
+
+        void offer(float d, int s) {
+            if (size < k) {
+                int i = size++;
+                while (i > 0 && d2[(i - 1) / 2] < d) {
+                    d2[i] = d2[(i - 1) / 2];
+                    slot[i] = slot[(i - 1) / 2];
+                    i = (i - 1) / 2;
+                }
+                d2[i] = d;
+                slot[i] = s;
+            } else if (d < d2[0]) {
+                int i = 0;
+                while (true) {
+                    int c = 2 * i + 1;
+                    if (c >= size) break;
+                    if (c + 1 < size && d2[c + 1] > d2[c]) c++;
+                    if (d2[c] <= d) break;
+                    d2[i] = d2[c];
+                    slot[i] = slot[c];
+                    i = c;
+                }
+                d2[i] = d;
+                slot[i] = s;
+            }
+        }
+    };
+
+    template <class Accept>
+    void nearestRange(int lo, int hi, int depth, float x, float y, Candidates& best, Accept& accept) const {
+        if (lo >= hi) return;
+        int mid = (lo + hi) / 2;
+        float dx = xs[mid] - x, dy = ys[mid] - y;
+        if (accept(ids[mid])) best.offer(dx * dx + dy * dy, mid);
+        float diff = (depth & 1) ? y - ys[mid] : x - xs[mid];
+        // Near side first, far side only if the plane is inside the bound
+        if (diff < 0) {
+            nearestRange(lo, mid, depth + 1, x, y, best, accept);
+            if (diff * diff < best.bound()) nearestRange(mid + 1, hi, depth + 1, x, y, best, accept);
+        } else {
+            nearestRange(mid + 1, hi, depth + 1, x, y, best, accept);
+            if (diff * diff < best.bound()) nearestRange(lo, mid, depth + 1, x, y, best, accept);
+        }
+    }
+
+    void radiusRange(int lo, int hi, int depth, float x, float y, float r2, DynamicArray<int>& out) const {
+        if (lo >= hi) return;
+        int mid = (lo + hi) / 2;
+        float dx = xs[mid] - x, dy = ys[mid] - y;
+        if (dx * dx + dy * dy <= r2) out.push(ids[mid]);
+        float diff = (depth & 1) ? y - ys[mid] : x - xs[mid];
+        if (diff < 0 || diff * diff <= r2) radiusRange(lo, mid, depth + 1, x, y, r2, out);
+        if (diff >= 0 || diff * diff <= r2) radiusRange(mid + 1, hi, depth + 1, x, y, r2, out);
+    }
+
+public:
+    // count points: id[i] at (x[i], y[i])
+    void build(const int* id, const float* x, const float* y, int count) {
+        int* order = new int[count];
+        ids.resize(count);
+        xs.resize(count);
+        ys.resize(count);
+        for (int i = 0; i < count; i++) {
+            ids[i] = id[i];
+            xs[i] = x[i];
+            ys[i] = y[i];
+            order[i] = i;
+        }
+        // Sort a permutation, then lay the points out in tree order
+        buildRange(0, count, 0, order);
+        DynamicArray<int> id2(count > 0 ? count : 1);
+        DynamicArray<float> x2(count > 0 ? count : 1), y2(count > 0 ? count : 1);
+        for (int i = 0; i < count; i++) {
+            id2.push(ids[order[i]]);
+            x2.push(xs[order[i]]);
+            y2.push(ys[order[i]]);
+        }
+        ids = id2;
+        xs = x2;
+        ys = y2;
+        delete[] order;
+    }
+
+    void clear() {
+        ids.clear();
+        xs.clear();
+        ys.clear();
+    }
+
+    int size() const { return ids.size(); }
+
+    // Up to k points nearest to (x, y) that accept(id) lets through, closest
+    // first; writes ids to out (and distances in km to dist if given).
+    // Returns how many were found.
+    template <class Accept>
+    int nearest(float x, float y, int k, int* out, float* dist, Accept accept) const {
+        if (k <= 0 || ids.size() == 0) return 0;
+        Candidates best(k);
+        nearestRange(0, ids.size(), 0, x, y, best, accept);
+        int n = best.size;
+        int* rank = new int[n];
+        for (int i = 0; i < n; i++) rank[i] = i;
+        sort(rank, rank + n, [&](int a, int b) {
+            if (best.d2[a] != best.d2[b]) return best.d2[a] < best.d2[b];
+            return ids[best.slot[a]] < ids[best.slot[b]];
+        });
+        for (int i = 0; i < n; i++) {
+            out[i] = ids[best.slot[rank[i]]];
+            if (dist) dist[i] = sqrt(best.d2[rank[i]]);
+        }
+        delete[] rank;
+        return n;
+    }
+
+    int nearest(float x, float y, int k, int* out, float* dist = nullptr) const {
+        auto all = [](int) { return true; };
+        return nearest(x, y, k, out, dist, all);
+    }
+
+    // Every point within radius km of (x, y), in no particular order
+    void withinRadius(float x, float y, float radius, DynamicArray<int>& out) const {
+        if (radius < 0) return;
+        radiusRange(0, ids.size(), 0, x, y, radius * radius, out);
+    }
+};
+
+#endif // SPATIAL_INDEX_H
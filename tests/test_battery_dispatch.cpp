@@ -0,0 +1,165 @@
+#include <iostream>
+#include <cassert>
+#include <cmath>
+#include <string>
+#include "../battery_dispatch.h"
+
+using namespace std;
+
+static float prices[24];
+
+DispatchHorizon makeHorizon(int steps) {
+    DispatchHorizon h;
+    h.steps = steps;
+    h.stepHours = 1.0f;
+    h.importPrice = prices;
+    h.exportPrice = 0;
+    h.keepFinalCharge = true;
+    return h;
+}
+
+// Every feasible level sequence on a tiny case; the DP must find the least
+// import, and the cheapest bill among plans with that import
+struct Outcome {
+    float importWh;
+    float bill;
+};
+
+Outcome bruteForce(const BatterySpec& spec, int levels, int start, const float* prod, const float* cons,
+                   const DispatchHorizon& h, int t, int j) {
+    Outcome none = { 1e30f, 1e30f };
+    if (t == h.steps) {
+        Outcome end = { 0, 0 };
+        return (h.keepFinalCharge && j < start) ? none : end;
+    }
+    float unit = spec.capacityWh / levels;
+    Outcome best = none;
+    for (int k = 0; k <= levels; k++) {
+        float stored = (k - j) * unit;
+        float extra;
+        if (k > j) {
+            extra = stored / spec.efficiency;
+            if (extra > spec.maxChargeW + 1e-3f) continue;
+        } else {
+            extra = stored * spec.efficiency;
+            if (-extra > spec.maxDischargeW + 1e-3f) continue;
+        }
+        float grid = cons[t] - prod[t] + extra;
+        if (k > j && grid > 1e-3f && !h.allowGridCharging) continue;   // charges from surplus only
+        Outcome rest = bruteForce(spec, levels, start, prod, cons, h, t + 1, k);
+        if (rest.importWh >= 1e30f) continue;
+        Outcome o = { rest.importWh + (grid > 0 ? grid : 0), rest.bill + (grid > 0 ? grid / 1000.0f * h.importPrice[t] : 0) };
+        if (o.importWh < best.importWh - 1e-3f || (o.importWh <= best.importWh + 1e-3f && o.bill < best.bill)) {
+            best = o;
+        }
+    }
+    return best;
+}
+
+void test_matches_brute_force() {
+    BatterySpec spec(4000, 2000, 1500, 0.9f);
+    float prod[5] = { 0, 3000, 2500, 0, 0 };
+    float cons[5] = { 800, 600, 900, 2200, 1500 };
+    prices[0] = 12; prices[1] = 12; prices[2] = 20; prices[3] = 30; prices[4] = 25;
+    DispatchHorizon h = makeHorizon(5);
+
+    for (int start = 0; start <= 4; start++) {
+        HomeBatteryPlan plan;
+        BatteryDispatcher::planHome(spec, start * 1000.0f, prod, cons, h, 4, plan);
+        Outcome expected = bruteForce(spec, 4, start, prod, cons, h, 0, start);
+        assert(fabs(plan.importWh - expected.importWh) < 1e-2f);
+        assert(fabs(plan.cost - expected.bill) < 1e-3f);
+        assert(plan.importWh <= plan.importWhWithout + 1e-3f);
+        assert(plan.levelWh[4] >= start * 1000.0f - 1e-3f);      // keepFinalCharge
+    }
+}
+
+// No solar: there is no surplus to store, and charging from the grid would
+// only add losses, so the plan must not import more than the idle battery
+void test_no_surplus_no_extra_import() {
+    BatterySpec spec(5000, 2500, 2500, 0.9f);
+    float prod[24], cons[24];
+    for (int t = 0; t < 24; t++) {
+        prod[t] = 0;
+        cons[t] = 1000;
+        prices[t] = (t < 6) ? 12 : (t >= 17 && t < 22) ? 30 : 20;
+    }
+    DispatchHorizon h = makeHorizon(24);
+    HomeBatteryPlan plan;
+    BatteryDispatcher::planHome(spec, 0, prod, cons, h, BatteryDispatcher::DEFAULT_LEVELS, plan);
+    assert(fabs(plan.importWhWithout - 24000) < 1e-2f);
+    assert(plan.importWh <= plan.importWhWithout + 1e-2f);
+    for (int t = 0; t < 24; t++) assert(plan.batteryW[t] <= 0);
+}
+
+// Cheap night, expensive evening, grid charging switched on and the bill as
+// the goal: charge early, discharge at the peak, never beyond the power
+// limits or the capacity
+void test_arbitrage_and_limits() {
+    BatterySpec spec(10000, 3000, 2500, 0.95f);
+    float prod[24], cons[24];
+    for (int t = 0; t < 24; t++) {
+        prod[t] = 0;
+        cons[t] = 1000;
+        prices[t] = (t < 6) ? 8 : (t >= 17 && t < 22) ? 35 : 20;
+    }
+    DispatchHorizon h = makeHorizon(24);
+    h.keepFinalCharge = false;
+    h.allowGridCharging = true;
+    h.minimizeBill = true;
+    HomeBatteryPlan plan;
+    BatteryDispatcher::planHome(spec, 0, prod, cons, h, BatteryDispatcher::DEFAULT_LEVELS, plan);
+
+    float chargedEarly = 0, dischargedPeak = 0;
+    for (int t = 0; t < 24; t++) {
+        float b = plan.batteryW[t];
+        if (b > 0) assert(b / spec.efficiency <= spec.maxChargeW + 1);
+        if (b < 0) assert(-b * spec.efficiency <= spec.maxDischargeW + 1);
+        assert(plan.levelWh[t] >= -1e-3f && plan.levelWh[t] <= spec.capacityWh + 1e-3f);
+        if (t < 6 && b > 0) chargedEarly += b;
+        if (t >= 17 && t < 22 && b < 0) dischargedPeak -= b;
+    }
+    assert(chargedEarly > 0 && dischargedPeak > 0);
+    assert(plan.cost < plan.costWithout);
+}
+
+// Thousands of homes over 24 h in well under the budget
+void test_community_scale() {
+    const int N = 5000;
+    CommunityGraph g;
+    float* prod = new float[N * 24];
+    float* cons = new float[N * 24];
+    unsigned int x = 7;
+    for (int i = 0; i < N; i++) {
+        g.addHome(new Home("B" + to_string(i), "x", 0, 0, 4000 + (i % 5) * 1000));
+        for (int t = 0; t < 24; t++) {
+            x = x * 1103515245u + 12345u;
+            float sun = (t >= 6 && t <= 18) ? (float)sin((t - 6) / 12.0 * 3.14159) : 0;
+            prod[i * 24 + t] = 3000 * sun;
+            cons[i * 24 + t] = 600 + (x >> 16) % 1200 + ((t >= 17 && t < 22) ? 800 : 0);
+        }
+    }
+    for (int t = 0; t < 24; t++) prices[t] = (t < 6) ? 12 : (t >= 17 && t < 22) ? 30 : 20;
+    DispatchHorizon h = makeHorizon(24);
+
+    ThreadPool pool;
+    CommunityBatteryPlan plan = BatteryDispatcher::planCommunity(g, prod, cons, h,
+                                                                 BatteryDispatcher::DEFAULT_LEVELS, &pool);
+    cout << "  " << N << " homes x 24 h: " << plan.latencyMs << " ms, grid import "
+         << plan.importWhWithout / 1000 << " -> " << plan.importWh / 1000 << " kWh" << endl;
+    assert(plan.importWh < plan.importWhWithout);
+    assert(plan.cost <= plan.costWithout);
+    assert(plan.latencyMs < 10000);
+
+    delete[] prod;
+    delete[] cons;
+}
+
+int main() {
+    test_matches_brute_force();
+    test_no_surplus_no_extra_import();
+    test_arbitrage_and_limits();
+    test_community_scale();
+    cout << "[test_battery_dispatch] All tests passed!" << endl;
+    return 0;
+}
@@ -0,0 +1,157 @@
+#include <iostream>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include "../file_manager.h"
+
+using namespace std;
+
+// Everything a home and a line carry comes back, in the same dense order
+void test_round_trip() {
+    CommunityGraph g;
+    g.addHome(new Home("H001", "123 St 7", 2000, 1500, 5000));
+    g.addHome(new Home("H002", "", 1000, 1800, 3000));
+    g.addHome(new Home("H-with-a-much-longer-id", "Flat 4, 56 Long Road", 0, 300, 0));
+    g.getHomeByIndex(1)->setBattery(BatterySpec(8000, 3000, 2500, 0.9f));
+    g.setHomeLocation("H001", 1.5f, -2.25f);
+    g.connectHomes("H001", "H002", 0.5f, 1500.0f, 0.02f);
+    g.connectHomes("H002", "H-with-a-much-longer-id", 0.3f);
+    g.connectHomes("H001", "H-with-a-much-longer-id", 1.1f, 700.0f);
+    assert(CommunityFile::save(g, true, "test_community.dat"));
+
+    CommunityGraph loaded;
+    bool setup = false;
+    assert(CommunityFile::load(loaded, setup, "test_community.dat"));
+    assert(setup);
+    assert(loaded.getHomeCount() == 3 && loaded.getEdgeCount() == 3);
+    for (int i = 0; i < 3; i++) {
+        Home* a = g.getHomeByIndex(i);
+        Home* b = loaded.getHomeByIndex(i);
+        assert(a->homeID == b->homeID && a->address == b->address);
+        assert(a->currentProduction == b->currentProduction && a->currentConsumption == b->currentConsumption);
+        assert(a->excessEnergy == b->excessEnergy && a->batteryLevel == b->batteryLevel);
+        assert(a->battery.capacityWh == b->battery.capacityWh && a->battery.efficiency == b->battery.efficiency);
+        assert(a->battery.maxChargeW == b->battery.maxChargeW && a->battery.maxDischargeW == b->battery.maxDischargeW);
+        assert(a->hasLocation == b->hasLocation && a->x == b->x && a->y == b->y);
+    }
+    assert(loaded.indexOf("H-with-a-much-longer-id") == 2);
+    assert(loaded.areConnected("H001", "H-with-a-much-longer-id"));
+
+    // Same lines (grouped by their first home) with ratings and losses
+    float capacity = 0, loss = 0;
+    for (int e = 0; e < 3; e++) {
+        const GraphEdge& edge = loaded.getEdge(e);
+        if (edge.from == 0 && edge.to == 1) { capacity = edge.capacity; loss = edge.lossFraction; }
+    }
+    assert(capacity == 1500.0f && loss == 0.02f);
+    float d1[3], d2[3];
+    int p1[3], p2[3];
+    g.computeShortestPaths(0, d1, p1);
+    loaded.computeShortestPaths(0, d2, p2);
+    for (int i = 0; i < 3; i++) assert(d1[i] == d2[i]);
+
+    // Loading needs an empty graph
+    assert(!CommunityFile::load(loaded, setup, "test_community.dat"));
+    remove("test_community.dat");
+}
+
+// Truncated, foreign, duplicate-ID or old flag-only files are refused without touching the graph
+void test_bad_files() {
+    CommunityGraph g;
+    for (int i = 0; i < 50; i++) g.addHome(new Home("B" + to_string(i), "x", 0, 0, 0));
+    for (int i = 1; i < 50; i++) g.connectHomesByIndex(i - 1, i, 1.0f);
+    assert(CommunityFile::save(g, true, "test_community.dat"));
+
+    ifstream in("test_community.dat", ios::binary | ios::ate);
+    int size = (int)in.tellg();
+    in.seekg(0);
+    char* bytes = new char[size];
+    in.read(bytes, size);
+    in.close();
+
+    CommunityGraph empty;
+    bool setup = false;
+    for (int cut = 1; cut < size; cut += 97) {
+        ofstream out("test_community.dat", ios::binary | ios::trunc);
+        out.write(bytes, cut);
+        out.close();
+        assert(!CommunityFile::load(empty, setup, "test_community.dat"));
+        assert(empty.getHomeCount() == 0);
+    }
+    // Two homes with the same ID: B1 renamed to B0 in the string table
+    const CommunityFileHeader* header = (const CommunityFileHeader*)bytes;
+    const CommunityHomeRecord* records = (const CommunityHomeRecord*)(bytes + header->homesOffset);
+    char* idOfB1 = bytes + header->stringsOffset + records[1].idOffset;
+    assert(idOfB1[0] == 'B' && idOfB1[1] == '1' && records[1].idLength == 2);
+    idOfB1[1] = '0';
+    ofstream dup("test_community.dat", ios::binary | ios::trunc);
+    dup.write(bytes, size);
+    dup.close();
+    assert(!CommunityFile::load(empty, setup, "test_community.dat"));
+    assert(empty.getHomeCount() == 0);
+    idOfB1[1] = '1';
+
+    bytes[8] = 99;                                       // unknown version
+    ofstream out("test_community.dat", ios::binary | ios::trunc);
+    out.write(bytes, size);
+    out.close();
+    assert(!CommunityFile::load(empty, setup, "test_community.dat"));
+    delete[] bytes;
+
+    // What saveCommunity used to write: just the flag
+    ofstream old("community.dat", ios::binary | ios::trunc);
+    bool flag = true;
+    old.write(reinterpret_cast<char*>(&flag), sizeof(bool));
+    old.close();
+    setup = true;
+    assert(!FileManager::loadCommunity(empty, setup));
+    assert(!setup && empty.getHomeCount() == 0);
+    remove("community.dat");
+    remove("test_community.dat");
+    assert(!CommunityFile::load(empty, setup, "test_community.dat"));   // missing
+}
+
+// A million homes come back in well under a second
+void test_large_community() {
+    const int N = 1000000;
+    CommunityGraph g;
+    g.reserve(N, 2 * N);
+    unsigned int x = 5;
+    for (int i = 0; i < N; i++) g.addHome(new Home("L" + to_string(i), "", 1000, 900, 0));
+    for (int i = 1; i < N; i++) {
+        g.connectHomesByIndex(i - 1, i, 0.1f);
+        x = x * 1103515245u + 12345u;
+        g.connectHomesByIndex(i, (x >> 8) % i, 0.5f);
+    }
+    auto start = chrono::steady_clock::now();
+    assert(CommunityFile::save(g, true, "test_community.dat"));
+    double saveMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+    CommunityGraph loaded;
+    bool setup = false;
+    start = chrono::steady_clock::now();
+    assert(CommunityFile::load(loaded, setup, "test_community.dat"));
+    double loadMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    cout << "  " << N << " homes / " << g.getEdgeCount() << " lines: save " << saveMs
+         << " ms, load " << loadMs << " ms" << endl;
+    assert(loaded.getHomeCount() == N && loaded.getEdgeCount() == g.getEdgeCount());
+    assert(loaded.idOf(N - 1) == "L" + to_string(N - 1));
+    assert(loaded.getComponents().componentCount() == 1);
+    assert(loadMs < 5000);                               // generous for slow CI machines
+    remove("test_community.dat");
+
+    for (int i = 0; i < N; i++) {
+        delete g.getHomeByIndex(i);
+        delete loaded.getHomeByIndex(i);
+    }
+}
+
+int main() {
+    test_round_trip();
+    test_bad_files();
+    test_large_community();
+    cout << "[test_community_file] All tests passed!" << endl;
+    return 0;
+}
@@ -1,10 +1,676 @@
 #include <iostream>
 #include <cassert>
 #include <string>
+#include <cstdlib>
+#include <cmath>
 #include "../community_graph.h"
 
 using namespace std;
 
+// Heap Dijkstra must agree with a plain Bellman-Ford on a random graph
+void test_dijkstra_matches_bellman_ford() {
+    const int N = 300;
+    CommunityGraph g;
+    for (int i = 0; i < N; i++) g.addHome(new Home("R" + to_string(i), "x", 0, 0, 0));
+    srand(7);
+    int edges = 0;
+    int ea[1500], eb[1500];
+    float ew[1500];
+    for (int k = 0; k < 1500; k++) {
+        int a = rand() % N, b = rand() % N;
+        float w = (rand() % 40 + 1) / 4.0f;
+        g.connectHomes("R" + to_string(a), "R" + to_string(b), w);
+        ea[edges] = a; eb[edges] = b; ew[edges] = w * COST_PER_KM; edges++;
+    }
+
+    float dist[N];
+    int parent[N];
+    g.computeShortestPaths(0, dist, parent);
+
+    float ref[N];
+    for (int i = 0; i < N; i++) ref[i] = UNREACHABLE;
+    ref[0] = 0;
+    for (int round = 0; round < N; round++) {
+        for (int k = 0; k < edges; k++) {
+            if (ref[ea[k]] + ew[k] < ref[eb[k]]) ref[eb[k]] = ref[ea[k]] + ew[k];
+            if (ref[eb[k]] + ew[k] < ref[ea[k]]) ref[ea[k]] = ref[eb[k]] + ew[k];
+        }
+    }
+    for (int i = 0; i < N; i++) {
+        assert(dist[i] == ref[i]);          // quarter-km weights are exact in float
+        if (i != 0 && dist[i] < UNREACHABLE) assert(parent[i] != -1);
+    }
+}
+
+// All BFS modes must produce identical levels; homes whose IDs collide
+// modulo 100 must still all be found
+void test_bfs_modes_and_no_collisions() {
+    const int N = 2000;
+    CommunityGraph g;
+    for (int i = 0; i < N; i++) g.addHome(new Home("B" + to_string(i), "x", 0, 0, 0));
+    srand(11);
+    for (int i = 1; i < N; i++) {
+        g.connectHomesByIndex(i, rand() % i, 1.0f);          // random tree: all reachable
+    }
+    for (int k = 0; k < 6000; k++) g.connectHomesByIndex(rand() % N, rand() % N, 1.0f);
+
+    int* order = new int[N];
+    int* levelTD = new int[N];
+    int* levelBU = new int[N];
+    int* levelAuto = new int[N];
+    assert(g.breadthFirstSearch(0, order, levelTD, nullptr, BFS_TOP_DOWN) == N);
+    assert(g.breadthFirstSearch(0, order, levelBU, nullptr, BFS_BOTTOM_UP) == N);
+    assert(g.breadthFirstSearch(0, order, levelAuto, nullptr, BFS_AUTO) == N);
+    for (int i = 0; i < N; i++) {
+        assert(levelTD[i] == levelBU[i]);
+        assert(levelTD[i] == levelAuto[i]);
+    }
+
+    string* neighbors = new string[N];
+    int count = 0;
+    g.findAllNeighborsBFS("B0", neighbors, count);
+    assert(count == N - 1);            // 2000 IDs into 100 buckets used to collide
+
+    delete[] order;
+    delete[] levelTD;
+    delete[] levelBU;
+    delete[] levelAuto;
+    delete[] neighbors;
+}
+
+// Algorithms are silent by default; an attached sink sees every settle
+void test_trace_sink() {
+    CommunityGraph g;
+    for (int i = 0; i < 5; i++) g.addHome(new Home("T" + to_string(i), "x", 0, 0, 0));
+    for (int i = 0; i < 4; i++) g.connectHomesByIndex(i, i + 1, 1.0f);
+    
+    float dist[5];
+    int parent[5];
+    g.computeShortestPaths(0, dist, parent);          // no sink: nothing recorded anywhere
+    
+    RingBufferTrace ring(3);
+    g.setTraceSink(&ring);
+    g.computeShortestPaths(0, dist, parent);
+    int settles = 0;
+    for (int i = 0; i < ring.size(); i++) {
+        if (ring.at(i).type == TRACE_SETTLE) settles++;
+    }
+    assert(ring.totalRecorded() == 9);                 // 5 settles + 4 relaxations
+    assert(ring.size() == 3);                          // only the newest 3 kept
+    assert(ring.at(2).type == TRACE_SETTLE && ring.at(2).home == 4 && ring.at(2).value == dist[4]);
+    assert(settles >= 1);
+    
+    // Planning alone doesn't touch the homes; committing does
+    g.updateHomeProduction("T3", 500);
+    g.setTraceSink(nullptr);
+    SharingPlan plan = g.planEnergySharing("T0", 200);
+    assert(plan.transfers.size() == 1 && plan.transfers[0].providerIndex == 3);
+    assert(plan.energyReceived == 200.0f && plan.communityCost > 0);
+    assert(g.getHomeByIndex(3)->excessEnergy == 500.0f);
+    g.commitSharingPlan(plan);
+    assert(g.getHomeByIndex(3)->excessEnergy == 300.0f);
+}
+
+// Min-cost flow dispatch respects line ratings and finds the global optimum
+void test_min_cost_dispatch() {
+    CommunityGraph g;
+    g.addHome(new Home("P", "x", 1000, 0, 0));     // 0: big provider
+    g.addHome(new Home("R1", "x", 0, 600, 0));     // 1
+    g.addHome(new Home("R2", "x", 0, 600, 0));     // 2
+    g.addHome(new Home("Q", "x", 500, 0, 0));      // 3: far provider
+    g.addHome(new Home("F", "x", 900, 0, 0));      // 4: dearer than the grid
+    g.connectHomes("P", "R1", 0.1f, 1000);         // Rs 0.5 / kWh
+    g.connectHomes("P", "R2", 0.2f, 300);          // Rs 1.0 / kWh, saturates
+    g.connectHomes("Q", "R2", 1.0f);               // Rs 5.0 / kWh
+    g.connectHomes("R1", "R2", 0.1f, 200);         // Rs 0.5 / kWh
+    g.connectHomes("F", "R1", 5.0f);               // Rs 25 / kWh > grid
+    
+    EnergyDemand demands[2] = { {1, 600}, {2, 600} };
+    DispatchPlan plan = g.planDispatch(demands, 2);
+    
+    // P can only cover 1000 W, so Q sends 200 W; the rest is cheapest from P
+    assert(fabs(plan.delivered - 1200) < 0.01f);
+    assert(fabs(plan.communityCost - 1.7f) < 0.001f);
+    assert(fabs(plan.unmet[0]) < 0.01f && fabs(plan.unmet[1]) < 0.01f);
+    for (int e = 0; e < g.getEdgeCount(); e++) {
+        assert(fabs(plan.edgeFlow[e]) <= g.getEdge(e).capacity + 0.01f);
+    }
+    assert(fabs(plan.edgeFlow[1] - 300) < 0.01f);   // P-R2 at its rating
+    assert(fabs(plan.edgeFlow[4]) < 0.01f);          // F never used
+    
+    // Transfers add up to the flow and to the cost
+    float energy = 0, cost = 0, fromQ = 0;
+    for (int i = 0; i < plan.transfers.size(); i++) {
+        energy += plan.transfers[i].energy;
+        cost += plan.transfers[i].cost;
+        if (plan.transfers[i].provider == 3) fromQ += plan.transfers[i].energy;
+        assert(plan.pathNodes[plan.transfers[i].pathStart] == plan.transfers[i].provider);
+    }
+    assert(fabs(energy - 1200) < 0.01f && fabs(cost - 1.7f) < 0.001f);
+    assert(fabs(fromQ - 200) < 0.01f);
+    
+    g.commitDispatchPlan(plan);
+    assert(fabs(g.getHomeByIndex(0)->excessEnergy) < 0.01f);
+    assert(g.getHomeByIndex(0)->batteryLevel == 0);      // surplus was sent, not stored energy
+    assert(fabs(g.getHomeByIndex(3)->excessEnergy - 300) < 0.01f);
+}
+
+// A lossy line costs the same whichever API prices the route
+void test_line_losses_priced_everywhere() {
+    CommunityGraph g;
+    g.addHome(new Home("A", "x", 0, 1000, 0));     // 0: requester
+    g.addHome(new Home("M", "x", 0, 0, 0));        // 1
+    g.addHome(new Home("P", "x", 1000, 0, 0));     // 2: provider
+    g.connectHomes("A", "P", 1.0f, UNLIMITED_CAPACITY, 0.1f);   // Rs 5 + 10% of 20 = 7 / kWh
+    g.connectHomes("A", "M", 0.6f);                // Rs 3 / kWh
+    g.connectHomes("M", "P", 0.6f);                // Rs 3 / kWh
+    
+    PathQuery query = g.cheapestPath(0, 2);
+    assert(fabs(query.cost - 6.0f) < 1e-4f && query.nodes.size() == 3);
+    assert(fabs(g.distances().cost(0, 2) - 6.0f) < 1e-4f);
+    float dist[3];
+    int parent[3];
+    g.computeShortestPaths(0, dist, parent);
+    assert(fabs(dist[2] - 6.0f) < 1e-4f && parent[2] == 1);
+    
+    SharingPlan sharing = g.planEnergySharing("A", 1000);
+    assert(sharing.providers.size() == 1 && fabs(sharing.providers[0].pathCost - 6.0f) < 1e-4f);
+    EnergyDemand demand = { 0, 1000 };
+    DispatchPlan dispatch = g.planDispatch(&demand, 1);
+    assert(fabs(dispatch.communityCost - 6.0f) < 1e-3f);
+    assert(fabs(dispatch.edgeFlow[0]) < 0.01f);     // the lossy line stays idle
+}
+
+// Cached trees and hub labels must always agree with a fresh Dijkstra,
+// including after connections are added
+void test_distance_oracle() {
+    const int N = 200;
+    CommunityGraph g;
+    for (int i = 0; i < N; i++) g.addHome(new Home("O" + to_string(i), "x", 0, 0, 0));
+    srand(11);
+    for (int k = 0; k < 400; k++) {
+        g.connectHomesByIndex(rand() % N, rand() % N, (rand() % 40 + 1) / 10.0f);
+    }
+    
+    DistanceOracle& oracle = g.distances();
+    oracle.setCapacity(8);
+    float* dist = new float[N];
+    int* parent = new int[N];
+    
+    for (int round = 0; round < 5; round++) {
+        for (int q = 0; q < 40; q++) {
+            int a = rand() % 12, b = rand() % N;       // few sources -> cache hits
+            g.computeShortestPaths(a, dist, parent);
+            assert(fabs(oracle.cost(a, b) - dist[b]) < 1e-3f || oracle.cost(a, b) == dist[b]);
+        }
+        assert(oracle.cachedTrees() <= 8);
+        // New edges invalidate only the trees they shorten
+        g.connectHomesByIndex(rand() % N, rand() % N, 0.1f);
+    }
+    assert(oracle.getHits() > 0 && oracle.getMisses() > 0);
+    
+    // A far-away edge between two homes no cached tree can reach changes nothing
+    g.addHome(new Home("NEW1", "x", 0, 0, 0));
+    g.addHome(new Home("NEW2", "x", 0, 0, 0));
+    oracle.tree(0);
+    long long before = oracle.getInvalidations();
+    g.connectHomes("NEW1", "NEW2", 1.0f);
+    assert(oracle.cost(0, g.indexOf("NEW2")) >= UNREACHABLE);
+    assert(oracle.getInvalidations() == before);
+    
+    // Hub labels: exact for every pair, dropped on the next new edge
+    oracle.buildHubLabels();
+    assert(oracle.hasHubLabels());
+    int n = g.getHomeCount();
+    float* d2 = new float[n];
+    int* p2 = new int[n];
+    for (int a = 0; a < n; a += 7) {
+        g.computeShortestPaths(a, d2, p2);
+        for (int b = 0; b < n; b++) {
+            float c = oracle.cost(a, b);
+            assert(c == d2[b] || fabs(c - d2[b]) < 1e-3f);
+        }
+    }
+    g.connectHomes("NEW1", "O5", 0.5f);
+    g.computeShortestPaths(g.indexOf("NEW2"), d2, p2);
+    assert(fabs(oracle.cost(g.indexOf("NEW2"), 0) - d2[0]) < 1e-3f);
+    assert(!oracle.hasHubLabels());
+    
+    // LRU: capacity 2, touching 0 keeps it while 1 is evicted
+    oracle.setCapacity(2);
+    oracle.tree(0);
+    oracle.tree(1);
+    oracle.tree(0);
+    oracle.tree(2);
+    long long misses = oracle.getMisses();
+    oracle.tree(0);
+    assert(oracle.getMisses() == misses);
+    oracle.tree(1);
+    assert(oracle.getMisses() == misses + 1);
+    
+    delete[] dist;
+    delete[] parent;
+    delete[] d2;
+    delete[] p2;
+}
+
+// Delta-stepping on a pool must give exactly Dijkstra's costs
+void test_parallel_delta_stepping() {
+    const int N = 20000;
+    CommunityGraph g;
+    for (int i = 0; i < N; i++) g.addHome(new Home("D" + to_string(i), "x", 0, 0, 0));
+    srand(5);
+    for (int k = 0; k < 4 * N; k++) {
+        // a few zero-length lines to exercise ties
+        float km = (k % 97 == 0) ? 0.0f : (rand() % 200 + 1) / 100.0f;
+        g.connectHomesByIndex(rand() % N, rand() % N, km);
+    }
+    
+    float* seqDist = new float[N];
+    int* seqParent = new int[N];
+    float* parDist = new float[N];
+    int* parParent = new int[N];
+    g.computeShortestPaths(0, seqDist, seqParent);
+    
+    ThreadPool pool(4);
+    const int* offsets = g.getCSROffsets();
+    const int* targets = g.getCSRTargets();
+    const float* weights = g.getCSRWeights();
+    float deltas[3] = { 0, 0.5f, 50.0f };
+    for (int t = 0; t < 3; t++) {
+        g.computeShortestPathsParallel(0, parDist, parParent, pool, deltas[t]);
+        for (int v = 0; v < N; v++) {
+            assert(parDist[v] == seqDist[v]);
+            if (v == 0 || parDist[v] >= UNREACHABLE) {
+                assert(parParent[v] == -1);
+                continue;
+            }
+            // parent is a real neighbor on a shortest path, and the chain ends at the source
+            int u = parParent[v];
+            bool tight = false;
+            for (int e = offsets[v]; e < offsets[v + 1]; e++) {
+                if (targets[e] == u && parDist[u] + weights[e] == parDist[v]) tight = true;
+            }
+            assert(tight);
+        }
+        for (int v = 0; v < N; v++) {
+            int hops = 0;
+            for (int x = v; x != -1 && hops <= N; x = parParent[x]) hops++;
+            assert(hops <= N);
+        }
+    }
+    
+    delete[] seqDist;
+    delete[] seqParent;
+    delete[] parDist;
+    delete[] parParent;
+}
+
+// Union-find answers must match BFS, and the per-component totals must
+// follow every excess change
+void test_component_index() {
+    const int N = 3000;
+    CommunityGraph g;
+    for (int i = 0; i < N; i++) {
+        g.addHome(new Home("C" + to_string(i), "x", (float)(i % 7) * 100, 300, 0));
+    }
+    srand(3);
+    for (int k = 0; k < N / 2; k++) g.connectHomesByIndex(rand() % N, rand() % N, 1.0f);
+    
+    ComponentIndex& comps = g.getComponents();
+    int* order = new int[N];
+    int* level = new int[N];
+    bool* seen = new bool[N];
+    int componentsFound = 0;
+    for (int i = 0; i < N; i++) seen[i] = false;
+    for (int i = 0; i < N; i++) {
+        if (seen[i]) continue;
+        componentsFound++;
+        int reached = g.breadthFirstSearch(i, order, level);
+        double surplus = 0, deficit = 0;
+        for (int k = 0; k < reached; k++) {
+            seen[order[k]] = true;
+            assert(comps.connected(i, order[k]));
+            float e = g.getHomeByIndex(order[k])->excessEnergy;
+            if (e > 0) surplus += e; else deficit -= e;
+        }
+        assert(comps.componentSize(i) == reached);
+        assert(fabs(comps.componentSurplus(i) - surplus) < 0.5);
+        assert(fabs(comps.componentDeficit(i) - deficit) < 0.5);
+        
+        // The member ring visits exactly the BFS set
+        int ring = 1;
+        for (int v = comps.nextMember(i); v != i; v = comps.nextMember(v)) {
+            assert(level[v] >= 0);
+            ring++;
+        }
+        assert(ring == reached);
+    }
+    assert(componentsFound == comps.componentCount());
+    
+    // Changing consumption through the graph moves the component totals
+    int h = 0;
+    double surplusBefore = comps.componentSurplus(h);
+    double deficitBefore = comps.componentDeficit(h);
+    assert(g.getHomeByIndex(h)->excessEnergy == -300);           // produces 0, uses 300
+    g.updateHomeConsumption("C0", 0);
+    assert(fabs(comps.componentDeficit(h) - (deficitBefore - 300)) < 0.5);
+    g.updateHomeConsumption("C0", -500);                         // feeding 500 W back
+    assert(fabs(comps.componentSurplus(h) - (surplusBefore + 500)) < 0.5);
+    
+    // Connecting two components merges their totals
+    int a = -1, b = -1;
+    for (int i = 1; i < N && b == -1; i++) {
+        if (!comps.connected(0, i)) {
+            if (a == -1) a = i;
+            else if (!comps.connected(a, i)) b = i;
+        }
+    }
+    double sa = comps.componentSurplus(a), sb = comps.componentSurplus(b);
+    int za = comps.componentSize(a), zb = comps.componentSize(b);
+    g.connectHomesByIndex(a, b, 1.0f);
+    assert(g.areConnected(g.idOf(a), g.idOf(b)));
+    assert(comps.componentSize(a) == za + zb);
+    assert(fabs(comps.componentSurplus(b) - (sa + sb)) < 0.5);
+    
+    delete[] order;
+    delete[] level;
+    delete[] seen;
+}
+
+// Top-k surplus homes per component must match a brute-force scan through
+// excess changes and component merges
+void test_provider_index() {
+    const int N = 2000;
+    CommunityGraph g;
+    srand(21);
+    for (int i = 0; i < N; i++) {
+        g.addHome(new Home("P" + to_string(i), "x", (float)(rand() % 1000), 500, 0));
+    }
+    int* top = new int[N];
+    for (int round = 0; round < 200; round++) {
+        g.connectHomesByIndex(rand() % N, rand() % N, 1.0f);
+        int h = rand() % N;
+        g.updateHomeConsumption(g.idOf(h), (float)(rand() % 1000));
+        
+        int probe = rand() % N;
+        int k = 1 + rand() % 8;
+        int got = g.topProviders(probe, k, top);
+        
+        // Brute force: surplus homes of the same component, largest first
+        int expected = 0;
+        float kth[8];
+        for (int v = 0; v < N; v++) {
+            if (!g.getComponents().connected(probe, v)) continue;
+            float e = g.getHomeByIndex(v)->excessEnergy;
+            if (e <= 0) continue;
+            expected++;
+            // keep the k largest in kth[] (descending)
+            int pos = (expected <= k) ? expected - 1 : k;
+            if (pos == k && e <= kth[k - 1]) continue;
+            if (pos == k) pos = k - 1;
+            while (pos > 0 && kth[pos - 1] < e) {
+                kth[pos] = kth[pos - 1];
+                pos--;
+            }
+            kth[pos] = e;
+        }
+        assert(got == (expected < k ? expected : k));
+        for (int i = 0; i < got; i++) {
+            assert(g.getHomeByIndex(top[i])->excessEnergy == kth[i]);
+            assert(g.getComponents().connected(probe, top[i]));
+        }
+    }
+    delete[] top;
+}
+
+// k-d tree answers against brute force; the straight-line bound stays
+// below every true path cost; a radius limits the sharing candidates
+void test_spatial_index() {
+    const int N = 1500;
+    CommunityGraph g;
+    srand(33);
+    for (int i = 0; i < N; i++) {
+        Home* h = new Home("G" + to_string(i), "x", (float)(rand() % 1000), 500, 0);
+        h->setLocation((rand() % 10000) / 1000.0f, (rand() % 10000) / 1000.0f);
+        g.addHome(h);
+    }
+    // Lines at least as long as the straight distance (some detour)
+    for (int i = 1; i < N; i++) {
+        for (int t = 0; t < 3; t++) {
+            int j = rand() % i;
+            Home* a = g.getHomeByIndex(i);
+            Home* b = g.getHomeByIndex(j);
+            float d = sqrt((a->x - b->x) * (a->x - b->x) + (a->y - b->y) * (a->y - b->y));
+            g.connectHomesByIndex(i, j, d * (1.0f + (rand() % 50) / 100.0f));
+        }
+    }
+    assert(g.hasGeographicHeuristic());
+    
+    int* out = new int[N];
+    float* km = new float[N];
+    for (int q = 0; q < 50; q++) {
+        int p = rand() % N;
+        Home* ph = g.getHomeByIndex(p);
+        int k = 1 + rand() % 10;
+        int got = g.nearestHomes(p, k, out, km);
+        assert(got == k);
+        // Nothing closer was missed
+        for (int v = 0; v < N; v++) {
+            if (v == p) continue;
+            Home* vh = g.getHomeByIndex(v);
+            float d = sqrt((ph->x - vh->x) * (ph->x - vh->x) + (ph->y - vh->y) * (ph->y - vh->y));
+            bool listed = false;
+            for (int i = 0; i < got; i++) if (out[i] == v) listed = true;
+            if (!listed) assert(d >= km[got - 1] - 1e-5f);
+        }
+        for (int i = 1; i < got; i++) assert(km[i - 1] <= km[i]);
+        
+        float r = (rand() % 1500) / 1000.0f;
+        DynamicArray<int> near;
+        g.homesWithinRadius(p, r, near);
+        int expected = 0;
+        for (int v = 0; v < N; v++) {
+            Home* vh = g.getHomeByIndex(v);
+            float dx = ph->x - vh->x, dy = ph->y - vh->y;
+            if (v != p && dx * dx + dy * dy <= r * r) expected++;
+        }
+        assert(near.size() == expected);
+        
+        got = g.nearestProviders(p, r, 0, out);
+        for (int i = 0; i < got; i++) {
+            assert(g.getHomeByIndex(out[i])->excessEnergy > 0 && out[i] != p);
+        }
+    }
+    
+    // Admissible: never above the true cheapest cost
+    float* dist = new float[N];
+    int* parent = new int[N];
+    for (int q = 0; q < 5; q++) {
+        int s = rand() % N;
+        g.computeShortestPaths(s, dist, parent);
+        for (int v = 0; v < N; v++) {
+            if (dist[v] < UNREACHABLE) assert(g.heuristicCost(s, v) <= dist[v]);
+        }
+    }
+    
+    // Sharing within 1 km only uses providers within 1 km
+    int requester = 0;
+    SharingPlan plan = g.planEnergySharing(g.idOf(requester), 5000, 0, 1.0f);
+    Home* rh = g.getHomeByIndex(requester);
+    for (int i = 0; i < plan.providers.size(); i++) {
+        Home* ph = g.getHomeByIndex(plan.providers[i].homeIndex);
+        assert(sqrt((ph->x - rh->x) * (ph->x - rh->x) + (ph->y - rh->y) * (ph->y - rh->y)) <= 1.0f + 1e-5f);
+    }
+    
+    // A line shorter than the crow flies switches the heuristic off
+    g.connectHomesByIndex(0, N - 1, 0.0001f);
+    assert(g.heuristicCost(0, N - 1) == 0);
+    assert(!g.hasGeographicHeuristic());
+    
+    delete[] out;
+    delete[] km;
+    delete[] dist;
+    delete[] parent;
+}
+
+// Every point-to-point mode agrees with the full Dijkstra tree, and on a
+// big grid a short query settles a tiny part of it
+void test_point_to_point_search() {
+    const int SIDE = 120;                                  // 14400 homes on a street grid
+    CommunityGraph g;
+    srand(45);
+    for (int i = 0; i < SIDE * SIDE; i++) {
+        Home* h = new Home("Q" + to_string(i), "x", 0, 0, 0);
+        h->setLocation((i % SIDE) * 0.1f, (i / SIDE) * 0.1f);
+        g.addHome(h);
+    }
+    for (int r = 0; r < SIDE; r++) {
+        for (int c = 0; c < SIDE; c++) {
+            int i = r * SIDE + c;
+            // 0.1 km blocks, some streets longer than straight
+            if (c + 1 < SIDE) g.connectHomesByIndex(i, i + 1, 0.1f + (rand() % 5) * 0.02f);
+            if (r + 1 < SIDE) g.connectHomesByIndex(i, i + SIDE, 0.1f + (rand() % 5) * 0.02f);
+        }
+    }
+    assert(g.hasGeographicHeuristic());
+    
+    int n = SIDE * SIDE;
+    float* dist = new float[n];
+    int* parent = new int[n];
+    PathSearchMode modes[4] = { PATH_DIJKSTRA, PATH_BIDIRECTIONAL, PATH_ASTAR, PATH_TREE };
+    for (int q = 0; q < 20; q++) {
+        int s = rand() % n, t = rand() % n;
+        if (q == 0) t = s;
+        g.computeShortestPaths(s, dist, parent);
+        for (int m = 0; m < 4; m++) {
+            PathQuery query = g.cheapestPath(s, t, modes[m]);
+            assert(query.mode == modes[m]);
+            assert(fabs(query.cost - dist[t]) <= 1e-4f * (1 + dist[t]));
+            // The route is real and costs what was reported
+            assert(query.nodes[0] == s && query.nodes.back() == t);
+            float sum = 0;
+            for (int i = 0; i + 1 < query.nodes.size(); i++) {
+                int a = query.nodes[i], b = query.nodes[i + 1];
+                float w = -1;
+                for (int e = g.getCSROffsets()[a]; e < g.getCSROffsets()[a + 1]; e++) {
+                    if (g.getCSRTargets()[e] == b) w = g.getCSRWeights()[e];
+                }
+                assert(w >= 0);
+                sum += w;
+            }
+            assert(fabs(sum - query.cost) <= 1e-3f * (1 + sum));
+        }
+    }
+    
+    // Neighbors a few blocks apart in the middle of the grid
+    int s = (SIDE / 2) * SIDE + SIDE / 2, t = s + 3 * SIDE + 2;
+    PathQuery dijkstra = g.cheapestPath(s, t, PATH_DIJKSTRA);
+    PathQuery bidirectional = g.cheapestPath(s, t, PATH_BIDIRECTIONAL);
+    PathQuery astar = g.cheapestPath(s, t, PATH_ASTAR);
+    assert(dijkstra.settled < n / 50);
+    assert(bidirectional.settled < dijkstra.settled);
+    assert(astar.settled < dijkstra.settled);
+    assert(g.cheapestPath(s, t).mode == PATH_ASTAR);     // no tree cached from s
+    
+    // Unreachable target: nothing found, whatever the mode
+    g.addHome(new Home("Qlone", "x", 0, 0, 0));
+    assert(g.cheapestPath(0, n).mode == PATH_BIDIRECTIONAL);   // lone home has no location
+    for (int m = 0; m < 4; m++) {
+        PathQuery query = g.cheapestPath(0, n, modes[m]);
+        assert(query.cost >= UNREACHABLE && query.nodes.size() == 0);
+    }
+    
+    delete[] dist;
+    delete[] parent;
+}
+
+// Subtree sums against brute force after many incremental updates, path
+// headroom, and sharing held to the transformer ratings
+void test_grid_topology() {
+    const int NODES = 20000, HOMES = 30000;
+    GridTopology grid;
+    srand(46);
+    for (int v = 1; v < NODES; v++) {
+        int p = v < 50 ? 0 : rand() % v;
+        grid.addNode(p, 1000.0f + rand() % 9000, "N" + to_string(v));
+    }
+    CommunityGraph g;
+    for (int i = 0; i < HOMES; i++) {
+        g.addHome(new Home("R" + to_string(i), "x", (float)(rand() % 2000), 1000, 0));
+        grid.attachHome(i, 1 + rand() % (NODES - 1));
+    }
+    g.attachGrid(&grid);
+    for (int round = 0; round < 20000; round++) {
+        int h = rand() % HOMES;
+        g.updateHomeConsumption(g.idOf(h), (float)(rand() % 2000));
+    }
+    
+    // Brute force: every home counted at each of its ancestors
+    double* surplus = new double[NODES]();
+    double* load = new double[NODES]();
+    for (int i = 0; i < HOMES; i++) {
+        float e = g.getHomeByIndex(i)->excessEnergy;
+        for (int v = grid.nodeOf(i); v != -1; v = grid.parentOf(v)) {
+            if (e > 0) surplus[v] += e;
+            else load[v] -= e;
+        }
+    }
+    for (int v = 0; v < NODES; v++) {
+        assert(fabs(grid.subtreeSurplus(v) - surplus[v]) < 1e-3 * (1 + surplus[v]));
+        assert(fabs(grid.subtreeLoad(v) - load[v]) < 1e-3 * (1 + load[v]));
+    }
+    
+    // Headroom is the tightest link strictly below the common ancestor
+    for (int q = 0; q < 200; q++) {
+        int a = rand() % HOMES, b = rand() % HOMES;
+        int na = grid.nodeOf(a), nb = grid.nodeOf(b);
+        int lca = grid.lowestCommonAncestor(na, nb);
+        float expected = GridTopology::UNLIMITED;
+        for (int v = na; v != lca; v = grid.parentOf(v)) expected = min(expected, grid.headroom(v));
+        for (int v = nb; v != lca; v = grid.parentOf(v)) expected = min(expected, grid.headroom(v));
+        assert(grid.pathHeadroom(a, b) == expected);
+        grid.reserve(a, b, 10);
+        if (na != lca) assert(grid.reservedOf(na) == 10);
+        if (lca != GridTopology::ROOT) assert(grid.reservedOf(lca) == 0);
+        grid.release(a, b, 10);
+    }
+    delete[] surplus;
+    delete[] load;
+    
+    // Two transformers; the provider sits behind a 300 W one
+    CommunityGraph small;
+    small.addHome(new Home("A", "x", 0, 500, 0));
+    small.addHome(new Home("B", "x", 1500, 500, 0));
+    small.addHome(new Home("C", "x", 700, 500, 0));
+    small.connectHomes("A", "B", 0.1f);
+    small.connectHomes("A", "C", 2.0f);
+    GridTopology tx;
+    int t1 = tx.addNode(GridTopology::ROOT, 5000, "T1");
+    int t2 = tx.addNode(GridTopology::ROOT, 300, "T2");
+    tx.attachHome(0, t1);
+    tx.attachHome(1, t2);
+    tx.attachHome(2, t1);
+    small.attachGrid(&tx);
+    assert(tx.subtreeSurplus(t1) == 200 && tx.subtreeLoad(t1) == 500 && tx.subtreeSurplus(GridTopology::ROOT) == 1200);
+    
+    SharingPlan plan = small.planEnergySharing("A", 500);
+    assert(plan.transfers.size() == 2);
+    assert(plan.transfers[0].providerIndex == 1 && plan.transfers[0].energy == 300);   // capped by T2
+    assert(plan.transfers[1].providerIndex == 2 && plan.transfers[1].energy == 200);   // same transformer
+    assert(plan.heldBackByTransformers == 200);
+    assert(tx.reservedOf(t2) == 0);                     // planning books nothing
+    small.commitSharingPlan(plan);
+    assert(tx.reservedOf(t2) == 300 && tx.reservedOf(t1) == 300);
+    assert(tx.subtreeSurplus(t2) == 700);               // B's excess went down by 300
+    
+    SharingPlan again = small.planEnergySharing("A", 100);
+    for (int i = 0; i < again.transfers.size(); i++) assert(again.transfers[i].providerIndex != 1);
+    tx.clearReservations();
+    SharingPlan fresh = small.planEnergySharing("A", 100);
+    assert(fresh.transfers.size() == 1 && fresh.transfers[0].providerIndex == 1);
+}
+
 int main() {
     cout << "[test_community_graph] Running tests..." << endl;
 
@@ -39,6 +705,44 @@ int main() {
     float cost2 = graph.findCheapestPath("H004", "H001", path2, pathLen2);
     assert(cost2 == -1); // no path should return -1
 
+    // CSR adjacency: dense indices in insertion order, both edge directions
+    assert(graph.getHomeCount() == 4);
+    assert(graph.indexOf("H001") == 0 && graph.indexOf("H004") == 3);
+    assert(graph.indexOf("H999") == -1);
+    const int* offsets = graph.getCSROffsets();
+    const int* targets = graph.getCSRTargets();
+    assert(offsets[1] - offsets[0] == 1);            // H001: H002
+    assert(offsets[2] - offsets[1] == 2);            // H002: H001, H003
+    assert(offsets[4] - offsets[3] == 0);            // H004 isolated
+    assert(targets[offsets[0]] == graph.indexOf("H002"));
+
+    // New connections rebuild the CSR before the next traversal
+    graph.connectHomes("H004", "H003", 0.5f);
+    string path3[10];
+    int pathLen3 = 0;
+    float cost3 = graph.findCheapestPath("H004", "H001", path3, pathLen3);
+    assert(cost3 > 0);
+    assert(pathLen3 == 4 && path3[0] == "H004" && path3[3] == "H001");
+
+    // Sharing: one shortest-path tree from H004 ranks H003 (Rs 2.5) before H002 (Rs 12.5)
+    graph.findEnergySharing("H004", 600);
+    assert(h3->excessEnergy == 0.0f);       // 300 W taken from the cheapest provider
+    assert(h2->excessEnergy == 200.0f);     // remaining 300 W from the next one
+    assert(h1->excessEnergy == 500.0f);     // not needed
+
+    test_dijkstra_matches_bellman_ford();
+    test_bfs_modes_and_no_collisions();
+    test_trace_sink();
+    test_min_cost_dispatch();
+    test_line_losses_priced_everywhere();
+    test_distance_oracle();
+    test_parallel_delta_stepping();
+    test_component_index();
+    test_provider_index();
+    test_spatial_index();
+    test_point_to_point_search();
+    test_grid_topology();
+
     cout << "[test_community_graph] All tests passed!" << endl;
     return 0;
 }
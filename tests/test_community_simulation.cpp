@@ -0,0 +1,104 @@
+#include <iostream>
+#include <cassert>
+#include <cmath>
+#include <atomic>
+#include <string>
+#include "../community_simulation.h"
+
+using namespace std;
+
+// Every kWh of demand is covered by the home's own panels, its battery,
+// a neighbour or the grid; every kWh produced is used, stored, shared or exported
+void test_energy_balance() {
+    SimulationConfig cfg;
+    cfg.homes = 2000;
+    cfg.days = 3;
+    cfg.threads = 2;
+    CommunitySimulation sim(cfg);
+    SimulationMetrics m = sim.run();
+
+    double tol = 1e-3 * m.demandKWh;
+    assert(m.demandKWh > 0 && m.productionKWh > 0);
+    assert(fabs(m.demandKWh - (m.directUseKWh + m.batteryOutKWh + m.sharedKWh + m.importKWh)) < tol);
+    double stored = m.batteryInKWh / 0.95;                        // drawn from the panels
+    assert(fabs(m.productionKWh - (m.directUseKWh + stored + m.sharedKWh + m.exportKWh)) < tol);
+    assert(m.sharedKWh > 0);
+    assert(m.selfSufficiency() > 0 && m.selfSufficiency() < 1);
+    assert(m.homeSteps == 2000LL * 3 * 96);
+    assert(m.peakStep >= 0 && m.peakImportKW > 0);
+}
+
+// Feeders are contiguous and are exactly the connected components
+void test_feeders_are_components() {
+    SimulationConfig cfg;
+    cfg.homes = 500;
+    CommunitySimulation sim(cfg);
+    CommunityGraph& g = sim.getGraph();
+    assert(sim.getFeederStart(0) == 0 && sim.getFeederStart(sim.getFeederCount()) == 500);
+    for (int f = 0; f < sim.getFeederCount(); f++) {
+        int a = sim.getFeederStart(f), b = sim.getFeederStart(f + 1);
+        for (int i = a; i < b; i++) assert(g.areConnected(g.getHomeByIndex(a)->homeID, g.getHomeByIndex(i)->homeID));
+        if (b < 500) assert(!g.areConnected(g.getHomeByIndex(a)->homeID, g.getHomeByIndex(b)->homeID));
+    }
+}
+
+// Same seed, same answer, whatever the number of threads
+void test_deterministic() {
+    SimulationConfig cfg;
+    cfg.homes = 800;
+    cfg.days = 2;
+    cfg.threads = 1;
+    SimulationMetrics a = CommunitySimulation(cfg).run();
+    cfg.threads = 4;
+    cfg.feedersPerChunk = 1;
+    SimulationMetrics b = CommunitySimulation(cfg).run();
+    assert(fabs(a.importKWh - b.importKWh) < 1e-6 * a.importKWh);
+    assert(fabs(a.sharedKWh - b.sharedKWh) < 1e-6 * a.sharedKWh);
+}
+
+// Every chunk runs exactly once, also when one worker's chunks are slow
+void test_work_stealing_covers_all() {
+    ThreadPool threads(4);
+    WorkStealingPool pool(threads);
+    const int N = 1003;
+    atomic<int>* hits = new atomic<int>[N];
+    for (int i = 0; i < N; i++) hits[i] = 0;
+    atomic<int> calls(0);
+    pool.parallelFor(N, 7, [&](int worker, int begin, int end) {
+        assert(end - begin <= 7 && begin < end);
+        assert(worker >= 0 && worker < threads.size());
+        if (begin < 250) this_thread::sleep_for(chrono::microseconds(200));
+        for (int i = begin; i < end; i++) hits[i]++;
+        calls++;
+    });
+    for (int i = 0; i < N; i++) assert(hits[i] == 1);
+    assert(calls == (N + 6) / 7);
+    delete[] hits;
+}
+
+// A small community with min-cost flow dispatch every hour: can only
+// move energy along lines, so it never beats free pooling on a feeder
+void test_dispatch_steps() {
+    SimulationConfig cfg;
+    cfg.homes = 120;
+    cfg.days = 1;
+    cfg.threads = 1;
+    SimulationMetrics pooled = CommunitySimulation(cfg).run();
+    cfg.dispatchEvery = 4;
+    SimulationMetrics m = CommunitySimulation(cfg).run();
+    assert(m.dispatchRuns == 24);
+    assert(m.sharedKWh <= pooled.sharedKWh + 1e-3);
+    assert(m.importKWh >= pooled.importKWh - 1e-3);
+    double tol = 1e-3 * m.demandKWh;
+    assert(fabs(m.demandKWh - (m.directUseKWh + m.batteryOutKWh + m.sharedKWh + m.importKWh)) < tol);
+}
+
+int main() {
+    test_energy_balance();
+    test_feeders_are_components();
+    test_deterministic();
+    test_work_stealing_covers_all();
+    test_dispatch_steps();
+    cout << "[test_community_simulation] All tests passed!" << endl;
+    return 0;
+}
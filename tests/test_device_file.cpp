@@ -0,0 +1,188 @@
+#include <iostream>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include "../file_manager.h"
+
+using namespace std;
+
+static Device* lookup(HashMap<string, Device*>& registry, const string& id) {
+    Device** found = registry.get(id);
+    return found ? *found : nullptr;
+}
+
+// Every persisted field comes back, and the table sees the loaded devices
+void test_round_trip() {
+    HashMap<string, Device*> registry;
+    DeviceTable table;
+    Device* fridge = new Device("D001", "Fridge", 150, true, 9);
+    Device* heater = new Device("D-with-a-much-longer-id", string(300, 'h'), 2000, false, 3);
+    Device* lamp = new Device("D003", "", 40);
+    fridge->status = STATUS_ON;
+    fridge->unitsUsed = 12.5f;
+    fridge->startTime = 1700000000;
+    heater->timestamp = 42;
+    heater->priority = 1;
+    registry.insert(fridge->deviceID, fridge);
+    registry.insert(heater->deviceID, heater);
+    registry.insert(lamp->deviceID, lamp);
+    assert(DeviceFile::save(registry, "test_devices.dat"));
+
+    HashMap<string, Device*> loaded;
+    DeviceTable loadedTable;
+    int count = 0;
+    assert(DeviceFile::load(loaded, loadedTable, count, "test_devices.dat"));
+    assert(count == 3 && loaded.size() == 3 && loadedTable.size() == 3);
+    Device* originals[3] = { fridge, heater, lamp };
+    for (int i = 0; i < 3; i++) {
+        Device* a = originals[i];
+        Device* b = lookup(loaded, a->deviceID);
+        assert(b);
+        assert(a->deviceName == b->deviceName && a->consumptionRate == b->consumptionRate);
+        assert(a->status == b->status && a->timestamp == b->timestamp && a->unitsUsed == b->unitsUsed);
+        assert(a->isCritical == b->isCritical && a->priority == b->priority && a->startTime == b->startTime);
+        assert(b->table == &loadedTable);
+    }
+    assert(loadedTable.totalLoad() == 150);
+    remove("test_devices.dat");
+}
+
+// Damaged files add nothing; a flipped byte is caught by the checksum
+void test_bad_files() {
+    HashMap<string, Device*> registry;
+    for (int i = 0; i < 40; i++) {
+        Device* d = new Device("B" + to_string(i), "dev", 100 + i);
+        registry.insert(d->deviceID, d);
+    }
+    assert(DeviceFile::save(registry, "test_devices.dat"));
+    ifstream in("test_devices.dat", ios::binary | ios::ate);
+    int size = (int)in.tellg();
+    in.seekg(0);
+    char* bytes = new char[size];
+    in.read(bytes, size);
+    in.close();
+
+    HashMap<string, Device*> empty;
+    DeviceTable table;
+    int count = 0;
+    for (int cut = 1; cut < size; cut += 53) {
+        ofstream out("test_devices.dat", ios::binary | ios::trunc);
+        out.write(bytes, cut);
+        out.close();
+        assert(!DeviceFile::load(empty, table, count, "test_devices.dat"));
+    }
+    bytes[size - 5] ^= 0x20;                             // inside the string table
+    ofstream out("test_devices.dat", ios::binary | ios::trunc);
+    out.write(bytes, size);
+    out.close();
+    assert(!DeviceFile::load(empty, table, count, "test_devices.dat"));
+    assert(empty.size() == 0 && table.size() == 0 && count == 0);
+
+    // Without a checksum the same file is taken as written
+    assert(DeviceFile::save(registry, "test_devices.dat", false));
+    assert(DeviceFile::load(empty, table, count, "test_devices.dat"));
+    assert(count == 40);
+    delete[] bytes;
+    remove("test_devices.dat");
+}
+
+// What saveDevices wrote before the fixed records still loads
+void test_legacy_file() {
+    ofstream old("devices.dat", ios::binary | ios::trunc);
+    int size = 2;
+    old.write(reinterpret_cast<char*>(&size), sizeof(int));
+    for (int i = 0; i < size; i++) {
+        string id = i == 0 ? "OLD1" : "OLD2", name = "Old device", status = i == 0 ? "ON" : "OFF";
+        float rate = 500, units = 3.5f;
+        int len, timestamp = 1234, priority = i == 0 ? 2 : 7, startTime = 99;
+        bool critical = i == 1;
+        len = id.size(); old.write(reinterpret_cast<char*>(&len), sizeof(int)); old.write(id.c_str(), len);
+        len = name.size(); old.write(reinterpret_cast<char*>(&len), sizeof(int)); old.write(name.c_str(), len);
+        old.write(reinterpret_cast<char*>(&rate), sizeof(float));
+        len = status.size(); old.write(reinterpret_cast<char*>(&len), sizeof(int)); old.write(status.c_str(), len);
+        old.write(reinterpret_cast<char*>(&timestamp), sizeof(int));
+        old.write(reinterpret_cast<char*>(&units), sizeof(float));
+        old.write(reinterpret_cast<char*>(&critical), sizeof(bool));
+        old.write(reinterpret_cast<char*>(&priority), sizeof(int));
+        old.write(reinterpret_cast<char*>(&startTime), sizeof(int));
+    }
+    old.close();
+
+    HashMap<string, Device*> registry;
+    DeviceTable table;
+    int count = 0;
+    assert(FileManager::loadDevices(registry, table, count));
+    assert(count == 2);
+    Device* d = nullptr;
+    assert((d = lookup(registry, "OLD1")) && d->isOn() && d->priority == 2 && d->timestamp == 1234);
+    assert((d = lookup(registry, "OLD2")) && !d->isOn() && d->isCritical && d->priority == 7);
+
+    // Saving rewrites it in the new format (more than the old 100-device limit)
+    for (int i = 0; i < 250; i++) {
+        Device* extra = new Device("X" + to_string(i), "extra", 10);
+        registry.insert(extra->deviceID, extra);
+    }
+    assert(FileManager::saveDevices(registry));
+    HashMap<string, Device*> again;
+    DeviceTable againTable;
+    count = 0;
+    assert(FileManager::loadDevices(again, againTable, count));
+    assert(count == 252 && (d = lookup(again, "X249")));
+
+    // A legacy file with a bogus string length is refused, not overrun
+    ofstream bad("devices.dat", ios::binary | ios::trunc);
+    size = 1;
+    int len = 100000;
+    bad.write(reinterpret_cast<char*>(&size), sizeof(int));
+    bad.write(reinterpret_cast<char*>(&len), sizeof(int));
+    bad.write("abc", 3);
+    bad.close();
+    HashMap<string, Device*> none;
+    count = 0;
+    assert(!FileManager::loadDevices(none, againTable, count));
+    assert(none.size() == 0 && count == 0);
+    remove("devices.dat");
+}
+
+// A million devices: save and load times
+void test_large_registry() {
+    const int N = 1000000;
+    HashMap<string, Device*> registry;
+    registry.reserve(N);
+    Device* block = new Device[N];
+    for (int i = 0; i < N; i++) {
+        block[i].deviceID = "DEV" + to_string(i);
+        block[i].deviceName = "Device " + to_string(i % 1000);
+        block[i].consumptionRate = 50 + i % 2000;
+        block[i].status = i % 3 == 0 ? STATUS_ON : STATUS_OFF;
+        registry.insert(block[i].deviceID, &block[i]);
+    }
+    auto start = chrono::steady_clock::now();
+    assert(DeviceFile::save(registry, "test_devices.dat"));
+    double saveMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+    HashMap<string, Device*> loaded;
+    DeviceTable table;
+    int count = 0;
+    start = chrono::steady_clock::now();
+    assert(DeviceFile::load(loaded, table, count, "test_devices.dat"));
+    double loadMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    cout << "  " << N << " devices: save " << saveMs << " ms, load " << loadMs << " ms" << endl;
+    assert(count == N && loaded.size() == N && table.size() == N);
+    Device* d = nullptr;
+    assert((d = lookup(loaded, "DEV999999")) && d->consumptionRate == block[999999].consumptionRate);
+    assert(loadMs < 5000);                               // generous for slow CI machines
+    remove("test_devices.dat");
+    delete[] block;
+}
+
+int main() {
+    test_round_trip();
+    test_bad_files();
+    test_legacy_file();
+    test_large_registry();
+    cout << "[test_device_file] All tests passed!" << endl;
+    return 0;
+}
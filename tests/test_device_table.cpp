@@ -0,0 +1,182 @@
+#include <iostream>
+#include <cassert>
+#include <cmath>
+#include <chrono>
+#include "../device.h"
+#include "../device_table.h"
+
+using namespace std;
+
+void test_aggregates_follow_device_state() {
+    DeviceTable table;
+    Device fan("D1", "Fan", 60);
+    Device fridge("D2", "Fridge", 150, true);
+    Device heater("D3", "Heater", 2000);
+
+    fan.attachTo(&table);
+    fridge.attachTo(&table);
+    heater.attachTo(&table);
+    assert(table.size() == 3);
+    assert(table.totalLoad() == 0.0f);
+
+    fan.turnOn();
+    fridge.turnOn();
+    assert(table.totalLoad() == 210.0f);
+    assert(table.criticalLoad() == 150.0f);
+    assert(table.activeCount() == 2);
+    assert(table.criticalActiveCount() == 1);
+
+    fan.turnOff();
+    assert(table.totalLoad() == 150.0f);
+    assert(table.activeCount() == 1);
+}
+
+void test_running_totals_and_audit() {
+    DeviceTable table;
+    Device tv("D1", "TV", 100, false, 3);
+    Device pump("D2", "Pump", 400, false, 3);
+    Device light("D3", "Light", 20, false, 7);
+    tv.attachTo(&table);
+    pump.attachTo(&table);
+    light.attachTo(&table);
+
+    tv.turnOn();
+    pump.turnOn();
+    light.turnOn();
+    tv.turnOn();                        // repeated ON must not double count
+    assert(table.totalLoad() == 520.0f);
+    assert(table.priorityLoad(3) == 500.0f);
+    assert(table.priorityLoad(7) == 20.0f);
+
+    pump.turnOff();
+    pump.turnOff();
+    assert(table.totalLoad() == 120.0f);
+    assert(table.priorityLoad(3) == 100.0f);
+    assert(table.activeCount() == 2);
+
+    light.detach();                     // removing an active slot drops its load
+    assert(table.totalLoad() == 100.0f);
+    assert(table.audit());
+}
+
+void test_detach_relinks_moved_slot() {
+    DeviceTable table;
+    Device a("A", "A", 10), b("B", "B", 20), c("C", "C", 30);
+    a.attachTo(&table);
+    b.attachTo(&table);
+    c.attachTo(&table);
+    c.turnOn();
+
+    a.detach();                       // C is swapped into A's old slot
+    assert(table.size() == 2);
+    assert(c.tableSlot == 0);
+    assert(table.getOwner(0) == &c);
+    assert(table.totalLoad() == 30.0f);
+
+    c.turnOff();
+    assert(table.totalLoad() == 0.0f);
+}
+
+void test_shed_order_follows_priority_then_consumption() {
+    DeviceTable table;
+    Device heater("D1", "Heater", 2000, false, 2);
+    Device lamp("D2", "Lamp", 40, false, 2);
+    Device tv("D3", "TV", 150, false, 6);
+    Device fridge("D4", "Fridge", 300, true);
+    Device idle("D5", "Idle", 500, false, 1);
+    heater.attachTo(&table);
+    lamp.attachTo(&table);
+    tv.attachTo(&table);
+    fridge.attachTo(&table);
+    idle.attachTo(&table);          // stays OFF, never a candidate
+
+    heater.turnOn();
+    lamp.turnOn();
+    tv.turnOn();
+    fridge.turnOn();
+    assert(table.shedCandidateCount() == 3);   // critical fridge excluded
+
+    // priority 2 first, larger consumer first within the same priority
+    assert(table.getOwner(table.peekShedCandidate()) == &heater);
+    heater.turnOff();
+    assert(table.getOwner(table.peekShedCandidate()) == &lamp);
+    lamp.turnOff();
+    assert(table.getOwner(table.peekShedCandidate()) == &tv);
+    tv.turnOff();
+    assert(table.peekShedCandidate() == -1);
+
+    // Detaching re-links the heap entry of the moved slot
+    tv.turnOn();
+    heater.detach();
+    assert(table.getOwner(table.peekShedCandidate()) == &tv);
+}
+
+void test_large_table_matches_scalar_sum() {
+    const int N = 1000000;
+    DeviceTable table(N);
+    Device* devices = new Device[N];
+    double expectedTotal = 0, expectedCritical = 0;
+    int expectedActive = 0;
+
+    for (int i = 0; i < N; i++) {
+        devices[i].consumptionRate = (float)(i % 97 + 1);
+        devices[i].isCritical = (i % 13 == 0);
+        devices[i].attachTo(&table);
+        if (i % 3 != 0) {
+            devices[i].turnOn();
+            expectedTotal += devices[i].consumptionRate;
+            expectedActive++;
+            if (devices[i].isCritical) expectedCritical += devices[i].consumptionRate;
+        }
+    }
+
+    auto start = chrono::steady_clock::now();
+    float total = table.computeTotalLoad();
+    float critical = table.computeCriticalLoad();
+    int active = table.computeActiveCount();
+    auto end = chrono::steady_clock::now();
+
+    assert(fabs(total - expectedTotal) / expectedTotal < 1e-5);
+    assert(fabs(critical - expectedCritical) / expectedCritical < 1e-5);
+    assert(active == expectedActive);
+
+    cout << "  1M-device aggregates: "
+         << chrono::duration<double, micro>(end - start).count() << " us" << endl;
+
+    // Running totals maintained by turnOn/turnOff must match the kernels
+    assert(fabs(table.totalLoad() - total) < 1.0f);
+    assert(table.activeCount() == active);
+    assert(table.audit());
+
+    // Shedding pops victims in non-decreasing priority without a sort
+    for (int i = 0; i < N; i++) devices[i].priority = i % 10;
+    DeviceTable shedTable;
+    for (int i = 0; i < 10000; i++) {
+        devices[i].detach();
+        devices[i].attachTo(&shedTable);
+    }
+    start = chrono::steady_clock::now();
+    int lastPriority = -1;
+    for (int k = 0; k < 100 && shedTable.peekShedCandidate() != -1; k++) {
+        Device* victim = shedTable.getOwner(shedTable.peekShedCandidate());
+        assert(victim->priority >= lastPriority);
+        lastPriority = victim->priority;
+        victim->turnOff();
+    }
+    end = chrono::steady_clock::now();
+    cout << "  shed 100 of 10k devices: "
+         << chrono::duration<double, micro>(end - start).count() << " us" << endl;
+
+    delete[] devices;
+}
+
+int main() {
+    cout << "[test_device_table] Running tests..." << endl;
+    test_aggregates_follow_device_state();
+    test_running_totals_and_audit();
+    test_detach_relinks_moved_slot();
+    test_shed_order_follows_priority_then_consumption();
+    test_large_table_matches_scalar_sum();
+    cout << "[test_device_table] All tests passed!" << endl;
+    return 0;
+}
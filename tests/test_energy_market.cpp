@@ -0,0 +1,157 @@
+#include <iostream>
+#include <cassert>
+#include <cmath>
+#include <chrono>
+#include <string>
+#include "../energy_market.h"
+
+using namespace std;
+
+// S1 (offer 5) - B1 (bid 20) : 0.2 km -> fee Rs 1
+// S2 (offer 8) - B1           : 0.4 km -> fee Rs 2
+// B2 (bid 12) next to S2 : 1 km -> fee Rs 5
+// B3 isolated
+void buildBook(CommunityGraph& g, EnergyMarket& m) {
+    g.addHome(new Home("S1", "x", 0, 0, 0));   // 0
+    g.addHome(new Home("S2", "x", 0, 0, 0));   // 1
+    g.addHome(new Home("B1", "x", 0, 0, 0));   // 2
+    g.addHome(new Home("B2", "x", 0, 0, 0));   // 3
+    g.addHome(new Home("B3", "x", 0, 0, 0));   // 4
+    g.connectHomes("S1", "B1", 0.2f);
+    g.connectHomes("S2", "B1", 0.4f);
+    g.connectHomes("S2", "B2", 1.0f);
+
+    m.submitOffer(0, 300, 5);
+    m.submitOffer(1, 500, 8);
+    m.submitBid(2, 600, 20);                   // net 19
+    m.submitBid(3, 400, 12);                   // delivered 13 from either seller
+    m.submitBid(4, 100, 30);                   // unreachable
+}
+
+void test_uniform_clearing() {
+    CommunityGraph g;
+    EnergyMarket m;
+    buildBook(g, m);
+    ClearingResult r = m.clearInterval(g, CLEAR_UNIFORM);
+
+    // B1 takes S1's 300 then 300 of S2; B2 can't cover 13 delivered
+    assert(r.trades.size() == 2);
+    assert(fabs(r.volume - 600) < 0.01f);
+    assert(r.unreachableBids == 1);
+    assert(fabs(r.unmatchedDemand - 500) < 0.01f);   // B2 400 + B3 100
+    assert(fabs(r.unmatchedSupply - 200) < 0.01f);
+    assert(fabs(r.clearingPrice - (18 + 8) / 2.0f) < 0.001f);   // S2 -> B1 nets 20 - 2
+    for (int k = 0; k < r.trades.size(); k++) {
+        const MarketTrade& t = r.trades[k];
+        assert(t.buyer == 2);
+        assert(fabs(t.networkFee - (t.seller == 0 ? 1.0f : 2.0f)) < 0.001f);
+        assert(fabs(t.sellerPrice - r.clearingPrice) < 0.001f);
+        assert(fabs(t.buyerPrice - (r.clearingPrice + t.networkFee)) < 0.001f);
+    }
+    assert(m.getBidCount() == 0 && m.getOfferCount() == 0);   // book emptied
+
+    EnergyMarket::applyTrades(g, r);
+    assert(fabs(g.getHomeByIndex(1)->excessEnergy + 300) < 0.01f);
+}
+
+void test_pay_as_bid() {
+    CommunityGraph g;
+    EnergyMarket m;
+    buildBook(g, m);
+    ClearingResult r = m.clearInterval(g, CLEAR_PAY_AS_BID);
+    assert(r.trades.size() == 2);
+    assert(r.trades[0].seller == 0 && r.trades[0].sellerPrice == 5.0f);
+    assert(r.trades[1].seller == 1 && r.trades[1].sellerPrice == 8.0f);
+    assert(r.trades[0].buyerPrice == 20.0f);
+}
+
+// Two separate communities: cheap power in one must not reach the other
+void test_components_clear_apart() {
+    CommunityGraph g;
+    EnergyMarket m;
+    g.addHome(new Home("SA", "x", 0, 0, 0));   // 0
+    g.addHome(new Home("BA", "x", 0, 0, 0));   // 1
+    g.addHome(new Home("SB", "x", 0, 0, 0));   // 2
+    g.addHome(new Home("BB", "x", 0, 0, 0));   // 3
+    g.connectHomes("SA", "BA", 0.2f);
+    g.connectHomes("SB", "BB", 0.2f);
+    m.submitOffer(0, 1000, 5);
+    m.submitBid(1, 200, 20);
+    m.submitOffer(2, 100, 10);
+    m.submitBid(3, 500, 30);
+
+    ClearingResult r = m.clearInterval(g, CLEAR_UNIFORM);
+    assert(r.trades.size() == 2);
+    assert(r.unreachableBids == 0);
+    assert(fabs(r.unmatchedDemand - 400) < 0.01f);   // BB only gets SB's 100
+    assert(fabs(r.unmatchedSupply - 800) < 0.01f);
+    for (int k = 0; k < r.trades.size(); k++) {
+        const MarketTrade& t = r.trades[k];
+        assert(g.getComponents().connected(t.buyer, t.seller));
+        assert(fabs(t.networkFee - 1.0f) < 0.001f);
+        // each side of the fence clears at its own price
+        float expected = t.seller == 0 ? (19 + 5) / 2.0f : (29 + 10) / 2.0f;
+        assert(fabs(t.sellerPrice - expected) < 0.001f);
+    }
+}
+
+// The fee is the path cost of the pair that trades, not of the nearest seller
+void test_fee_is_pair_cost() {
+    CommunityGraph g;
+    EnergyMarket m;
+    g.addHome(new Home("Far", "x", 0, 0, 0));    // 0
+    g.addHome(new Home("Near", "x", 0, 0, 0));   // 1
+    g.addHome(new Home("B", "x", 0, 0, 0));      // 2
+    g.connectHomes("Far", "Near", 0.8f);
+    g.connectHomes("Near", "B", 0.2f);
+    m.submitOffer(0, 500, 5);                    // delivered 5 + 5 = 10
+    m.submitOffer(1, 300, 10);                   // delivered 10 + 1 = 11
+    m.submitBid(2, 1000, 30);
+
+    ClearingResult r = m.clearInterval(g, CLEAR_PAY_AS_BID);
+    assert(r.trades.size() == 2);
+    assert(r.trades[0].seller == 0 && fabs(r.trades[0].energy - 500) < 0.01f);
+    assert(fabs(r.trades[0].networkFee - 5.0f) < 0.001f);
+    assert(r.trades[1].seller == 1 && fabs(r.trades[1].energy - 300) < 0.01f);
+    assert(fabs(r.trades[1].networkFee - 1.0f) < 0.001f);
+    assert(fabs(r.unmatchedDemand - 200) < 0.01f);
+}
+
+// Clearing 100k participants has to fit in one interval
+void test_large_batch() {
+    const int N = 100000;
+    CommunityGraph g;
+    EnergyMarket m;
+    for (int i = 0; i < N; i++) g.addHome(new Home("M" + to_string(i), "x", 0, 0, 0));
+    unsigned int x = 12345;
+    for (int i = 1; i < N; i++) {
+        x = x * 1103515245u + 12345u;
+        int j = (int)(x % (unsigned int)i);
+        g.connectHomesByIndex(i, j, 0.1f + (x >> 16) % 50 / 100.0f);
+        g.connectHomesByIndex(i, i - 1, 0.3f);
+    }
+    for (int i = 0; i < N; i++) {
+        x = x * 1103515245u + 12345u;
+        float energy = 100 + (x >> 16) % 900;
+        float price = 4 + (x >> 8) % 16;
+        if (i % 2) m.submitBid(i, energy, price + 6);
+        else m.submitOffer(i, energy, price);
+    }
+    g.ensureCSR();
+
+    ClearingResult r = m.clearInterval(g, CLEAR_UNIFORM);
+    cout << "  100k participants: " << r.trades.size() << " trades, "
+         << r.latencyMs << " ms" << endl;
+    assert(r.trades.size() > 0);
+    assert(r.latencyMs < 2000);
+}
+
+int main() {
+    test_uniform_clearing();
+    test_pay_as_bid();
+    test_components_clear_apart();
+    test_fee_is_pair_cost();
+    test_large_batch();
+    cout << "[test_energy_market] All tests passed!" << endl;
+    return 0;
+}
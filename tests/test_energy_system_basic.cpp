@@ -1,5 +1,6 @@
 #include <iostream>
 #include <cassert>
+#include <sstream>
 #include "../energy_system.h"
 
 // NOTE: Most EnergyOptimizationSystem methods are interactive (cin/cout),
@@ -23,6 +24,26 @@ int main() {
     // History / report functions should also not crash on empty data.
     system.generateReport();
 
+    // Repeated energy requests (menu option 9): each one is its own sharing
+    // interval, so transformer bookings must not pile up across requests.
+    // H005 (TX-South) needs more than its neighbour H004 has, so part of
+    // the first two requests crosses over from TX-North (the third finds the
+    // north drained).
+    system.setupCommunity();
+    const GridTopology& grid = system.getCommunityGrid();
+    std::istringstream answers("H005 2000\nH005 2000\nH005 2000\n");
+    std::streambuf* oldIn = std::cin.rdbuf(answers.rdbuf());
+    for (int round = 0; round < 3; round++) {
+        system.requestEnergy();
+        float booked = 0;
+        for (int v = 0; v < grid.nodeCount(); v++) {
+            assert(grid.reservedOf(v) <= 2000.0f + 0.01f);
+            if (grid.reservedOf(v) > booked) booked = grid.reservedOf(v);
+        }
+        if (round < 2) assert(booked > 0);
+    }
+    std::cin.rdbuf(oldIn);
+
     std::cout << "[test_energy_system_basic] All tests (non-interactive subset) passed!" << std::endl;
     return 0;
 }
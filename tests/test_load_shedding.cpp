@@ -0,0 +1,114 @@
+#include <iostream>
+#include <cassert>
+#include <cmath>
+#include <chrono>
+#include "../device.h"
+#include "../device_table.h"
+#include "../load_shedding.h"
+
+using namespace std;
+
+float shedLoss(DeviceTable& table, int* chosen, int count, float& freed) {
+    float loss = 0;
+    freed = 0;
+    for (int i = 0; i < count; i++) {
+        loss += LoadSheddingSolver::lossOf(table.getPriority(chosen[i]), table.getRate(chosen[i]));
+        freed += table.getRate(chosen[i]);
+    }
+    return loss;
+}
+
+void test_optimal_beats_greedy_overshoot() {
+    DeviceTable table;
+    Device boiler("X", "Boiler", 3000, false, 1);
+    Device dryer("Y", "Dryer", 500, false, 2);
+    boiler.attachTo(&table);
+    dryer.attachTo(&table);
+    boiler.turnOn();
+    dryer.turnOn();
+
+    // Greedy would shed the 3000 W boiler (loss 3.0); shedding the dryer costs 1.0
+    int chosen[4];
+    int count = 0;
+    assert(LoadSheddingSolver::solveOptimal(table, 500, 50.0, chosen, count));
+    assert(count == 1);
+    assert(table.getOwner(chosen[0]) == &dryer);
+
+    float freed = 0;
+    float loss = shedLoss(table, chosen, count, freed);
+    assert(freed >= 500);
+    assert(fabs(loss - 1.0f) < 1e-4);
+    assert(LoadSheddingSolver::lowerBound(table, 500) <= loss);
+}
+
+void test_optimal_combines_devices() {
+    DeviceTable table;
+    Device a("A", "A", 1000, false, 2);
+    Device b("B", "B", 600, false, 3);
+    Device c("C", "C", 450, false, 3);
+    Device d("D", "D", 100, false, 1);
+    Device fridge("F", "Fridge", 5000, true);
+    a.attachTo(&table); b.attachTo(&table); c.attachTo(&table);
+    d.attachTo(&table); fridge.attachTo(&table);
+    a.turnOn(); b.turnOn(); c.turnOn(); d.turnOn(); fridge.turnOn();
+
+    int chosen[8];
+    int count = 0;
+    assert(LoadSheddingSolver::solveOptimal(table, 1000, 50.0, chosen, count));
+    float freed = 0;
+    float loss = shedLoss(table, chosen, count, freed);
+    assert(freed >= 1000);
+    assert(fabs(loss - 2.0f) < 1e-4);          // A alone beats D + A (2.1)
+    for (int i = 0; i < count; i++) assert(!table.isCritical(chosen[i]));
+
+    // Infeasible request: nothing returned, caller falls back to greedy
+    assert(!LoadSheddingSolver::solveOptimal(table, 10000, 50.0, chosen, count));
+}
+
+void test_large_instance_within_budget() {
+    const int N = 10000;
+    DeviceTable table;
+    Device* devices = new Device[N];
+    for (int i = 0; i < N; i++) {
+        devices[i].consumptionRate = (float)(50 + (i * 37) % 1950);
+        devices[i].priority = 1 + (i * 7) % 9;
+        devices[i].attachTo(&table);
+        devices[i].turnOn();
+    }
+
+    int* chosen = new int[N];
+    int count = 0;
+    auto start = chrono::steady_clock::now();
+    bool ok = LoadSheddingSolver::solveOptimal(table, 25000, 2000.0, chosen, count);
+    double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    assert(ok);
+
+    float freed = 0;
+    float loss = shedLoss(table, chosen, count, freed);
+    float bound = LoadSheddingSolver::lowerBound(table, 25000);
+    assert(freed >= 25000);
+    assert(loss >= bound - 1e-3);
+    cout << "  10k devices: " << ms << " ms, gap "
+         << (bound > 0 ? (loss - bound) / bound * 100 : 0) << "%" << endl;
+
+    // The default budget fits this size with room to spare
+    bool timedOut = true;
+    assert(LoadSheddingSolver::solveOptimal(table, 25000, LoadSheddingSolver::DEFAULT_BUDGET_MS,
+                                            chosen, count, &timedOut) && !timedOut);
+
+    // A tiny budget must time out rather than overrun, and say so
+    assert(!LoadSheddingSolver::solveOptimal(table, 25000, 0.0, chosen, count, &timedOut));
+    assert(timedOut);
+
+    delete[] chosen;
+    delete[] devices;
+}
+
+int main() {
+    cout << "[test_load_shedding] Running tests..." << endl;
+    test_optimal_beats_greedy_overshoot();
+    test_optimal_combines_devices();
+    test_large_instance_within_budget();
+    cout << "[test_load_shedding] All tests passed!" << endl;
+    return 0;
+}
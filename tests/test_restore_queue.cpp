@@ -0,0 +1,50 @@
+#include <iostream>
+#include <cassert>
+#include "../device.h"
+#include "../restore_queue.h"
+
+using namespace std;
+
+void test_restores_by_priority_with_hysteresis() {
+    RestoreQueue q(0.1f, 30);          // keep 10% headroom, one restore per 30 s
+    Device washer("D1", "Washer", 1500, false, 3);
+    Device oven("D2", "Oven", 2000, false, 7);
+    q.push(&washer);
+    q.push(&oven);
+
+    // Capacity 5000, ceiling 4500: oven (priority 7) first, needs load <= 2500
+    assert(q.nextRestorable(3000, 5000, 1000) == nullptr);    // 5000 > 4500
+    Device* first = q.nextRestorable(2500, 5000, 1000);
+    assert(first == &oven);
+    first->turnOn();
+
+    // Rate limited: plenty of headroom but only 10 s later
+    assert(q.nextRestorable(0, 5000, 1010) == nullptr);
+    Device* second = q.nextRestorable(2000, 5000, 1030);
+    assert(second == &washer);
+    assert(q.isEmpty());
+}
+
+void test_manual_turn_on_makes_entry_stale() {
+    RestoreQueue q(0.1f, 0);
+    Device heater("D1", "Heater", 1000, false, 8);
+    Device lamp("D2", "Lamp", 60, false, 2);
+    q.push(&heater);
+    q.push(&lamp);
+
+    heater.turnOn();                   // user switched it back on by hand
+    heater.turnOff();                  // ...and off again: no longer pending
+    assert(!heater.shedPending);
+
+    Device* next = q.nextRestorable(0, 5000, 100);
+    assert(next == &lamp);
+    assert(q.isEmpty());
+}
+
+int main() {
+    cout << "[test_restore_queue] Running tests..." << endl;
+    test_restores_by_priority_with_hysteresis();
+    test_manual_turn_on_makes_entry_stale();
+    cout << "[test_restore_queue] All tests passed!" << endl;
+    return 0;
+}
@@ -0,0 +1,261 @@
+#include <iostream>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include "../snapshot_writer.h"
+#include "../file_manager.h"
+
+using namespace std;
+
+// What EnergyOptimizationSystem persists, kept together for the tests
+struct State {
+    HashMap<string, Device*> registry;
+    DeviceTable table;
+    UsageHistoryBST history;
+    PriorityQueue scheduler;
+    CommunityGraph community;
+    bool communitySetup;
+    int deviceCount;
+
+    State() : communitySetup(false), deviceCount(0) {}
+
+    Device* add(const string& id, float rate) {
+        Device* d = new Device(id, "Device " + id, rate);
+        d->attachTo(&table);
+        registry.insert(id, d);
+        deviceCount++;
+        return d;
+    }
+
+    Device* get(const string& id) {
+        Device** d = registry.get(id);
+        return d ? *d : nullptr;
+    }
+
+    // Same steps as EnergyOptimizationSystem::captureSnapshot
+    PersistenceSnapshot* capture(WriteAheadLog* log, unsigned long long epoch) {
+        auto start = chrono::steady_clock::now();
+        PersistenceSnapshot* s = new PersistenceSnapshot();
+        assert(DeviceFile::encode(registry, s->devices));
+        assert(CommunityFile::encode(community, communitySetup, s->community));
+        FileManager::encodeHistory(history, s->history);
+        FileManager::encodeSchedule(scheduler, s->schedule);
+        s->epoch = epoch;
+        s->walLsn = log ? log->beginCheckpoint() : 0;
+        FileManager::stampWalLsn(s->history, s->walLsn);
+        FileManager::stampWalLsn(s->schedule, s->walLsn);
+        s->captureMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        return s;
+    }
+
+    // Same steps as EnergyOptimizationSystem::loadAllData (log passed: recover it too)
+    int loadFiles(WriteAheadLog* log = nullptr) {
+        uint64_t historyLsn = 0, scheduleLsn = 0;
+        FileManager::loadDevices(registry, table, deviceCount);
+        FileManager::loadHistory(history, &historyLsn);
+        FileManager::loadSchedule(scheduler, &scheduleLsn);
+        FileManager::loadCommunity(community, communitySetup);
+        if (!log) return 0;
+        log->setCoveredLsns(historyLsn, scheduleLsn);
+        return log->recover("wal.log", registry, table, deviceCount, history, scheduler);
+    }
+};
+
+static void cleanUp() {
+    const char* files[] = { "devices.dat", "history.dat", "schedule.dat", "community.dat",
+                            "wal.log", "wal.log.old", "wal.log.ckpt" };
+    for (int i = 0; i < 7; i++) remove(files[i]);
+}
+
+// The files hold the state as it was when the snapshot was taken, even if
+// it changes while they are being written
+void test_consistent_view() {
+    cleanUp();
+    State live;
+    Device* heater = live.add("D1", 2000);
+    live.add("D2", 300);
+    live.history.insertRecord(HistoryRecord("D2", "Device D2", 300, 100, 60, 0.005f));
+    live.scheduler.enqueue(ScheduledTask("D1", "Device D1", 23, 15, 30, 5, false));
+    live.community.addHome(new Home("H001", "1 Main St", 1000, 800, 0));
+    live.communitySetup = true;
+
+    SnapshotWriter writer;
+    writer.submit(live.capture(nullptr, 1));
+    heater->turnOn();                                    // after the snapshot
+    live.history.insertRecord(HistoryRecord("D1", "Device D1", 2000, 200, 60, 0.03f));
+    writer.waitIdle();
+    assert(writer.lastWriteOk() && writer.lastWrittenEpoch() == 1);
+
+    State loaded;
+    loaded.loadFiles();
+    assert(loaded.deviceCount == 2 && !loaded.get("D1")->isOn());
+    assert(loaded.history.getCount() == 1);
+    assert(loaded.scheduler.getSize() == 1 && loaded.scheduler.peek().scheduledMinute == 15);
+    assert(loaded.communitySetup && loaded.community.getHomeCount() == 1);
+    assert(live.scheduler.getSize() == 1);               // encoding refilled the queue
+    cleanUp();
+}
+
+// Checkpoint files + the log segment started at the snapshot = the live state
+void test_checkpoint_with_log() {
+    cleanUp();
+    State live;
+    WriteAheadLog log;
+    assert(log.recover("wal.log", live.registry, live.table, live.deviceCount,
+                       live.history, live.scheduler) == 0);
+    Device* heater = live.add("D1", 2000);
+    log.logAddDevice(*heater);
+    Device* lamp = live.add("D2", 60);
+    log.logAddDevice(*lamp);
+
+    SnapshotWriter writer(&log);
+    PersistenceSnapshot* s = live.capture(&log, 1);
+    assert(s->walLsn == 2);
+    writer.submit(s);
+    lamp->turnOn();                                      // while the files are written
+    log.logDeviceState(*lamp);
+    HistoryRecord r("D1", "Device D1", 2000, 300, 60, 0.03f);
+    live.history.insertRecord(r);
+    log.logHistory(r);
+    writer.waitIdle();
+    assert(writer.lastWriteOk());
+    assert(log.lastCheckpointLsn() == 2);
+    log.close();
+
+    ifstream old("wal.log.old");
+    assert(!old.is_open());                              // sealed segment dropped
+
+    State back;
+    back.loadFiles();
+    WriteAheadLog again;
+    assert(again.recover("wal.log", back.registry, back.table, back.deviceCount,
+                         back.history, back.scheduler) == 2);
+    assert(back.deviceCount == 2 && back.get("D2")->isOn() && !back.get("D1")->isOn());
+    assert(back.history.getCount() == 1 && back.table.totalLoad() == 60);
+    again.close();
+    cleanUp();
+}
+
+// Crash after the .dat renames but before the log checkpoint completed:
+// the records the files hold are still in the log and must not be applied
+// a second time (no duplicate history, no task queued twice)
+void test_crash_before_checkpoint_marker() {
+    cleanUp();
+    {
+        State live;
+        WriteAheadLog log;
+        log.recover("wal.log", live.registry, live.table, live.deviceCount, live.history, live.scheduler);
+        HistoryRecord r("D1", "Device D1", 2000, 300, 60, 0.03f);
+        live.history.insertRecord(r);
+        log.logHistory(r);
+        ScheduledTask task("D1", "Device D1", 23, 15, 30, 5, false);
+        live.scheduler.enqueue(task);
+        log.logSchedule(task);
+
+        SnapshotWriter writer;                           // no log: the checkpoint is never completed
+        writer.submit(live.capture(&log, 1));
+        writer.waitIdle();
+        assert(writer.lastWriteOk() && log.lastCheckpointLsn() == 0);
+        HistoryRecord later("D1", "Device D1", 2000, 400, 60, 0.03f);
+        log.logHistory(later);                           // after the snapshot
+        log.sync();
+    }                                                    // crash
+
+    State back;
+    WriteAheadLog log;
+    assert(back.loadFiles(&log) == 1);                   // only the record after the snapshot
+    assert(back.history.getCount() == 2);
+    assert(back.scheduler.getSize() == 1);
+    assert(log.logHistory(HistoryRecord("D1", "Device D1", 2000, 500, 60, 0.03f)) == 4);
+    log.close();
+    cleanUp();
+}
+
+// Big registry: the control thread only pays for the snapshot; snapshots
+// that pile up behind a slow write are replaced by the newest one
+void test_large_snapshot() {
+    cleanUp();
+    const int N = 200000;
+    State live;
+    live.registry.reserve(N);
+    Device* block = new Device[N];
+    for (int i = 0; i < N; i++) {
+        block[i].deviceID = "DEV" + to_string(i);
+        block[i].deviceName = "Device " + to_string(i % 1000);
+        block[i].consumptionRate = 50 + i % 2000;
+        live.registry.insert(block[i].deviceID, &block[i]);
+    }
+    for (int i = 0; i < 2000; i++) {
+        live.history.insertRecord(HistoryRecord("DEV1", "Device 1", 50, (i * 7919) % 100000, 60, 0.001f));
+    }
+
+    SnapshotWriter writer;
+    double worstCapture = 0;
+    for (int epoch = 1; epoch <= 5; epoch++) {
+        block[epoch].consumptionRate = 9999;             // a change between snapshots
+        PersistenceSnapshot* s = live.capture(nullptr, epoch);
+        if (s->captureMs > worstCapture) worstCapture = s->captureMs;
+        writer.submit(s);
+    }
+    writer.waitIdle();
+    cout << "  " << N << " devices: snapshot " << worstCapture << " ms (worst of 5), write "
+         << writer.lastWriteDurationMs() << " ms, " << writer.writes() << " written, "
+         << writer.superseded() << " superseded" << endl;
+    assert(writer.lastWriteOk() && writer.lastWrittenEpoch() == 5);
+    assert(writer.writes() + writer.superseded() == 5);
+
+    State loaded;
+    loaded.registry.reserve(N);
+    loaded.loadFiles();
+    assert(loaded.deviceCount == N && loaded.get("DEV5")->consumptionRate == 9999);
+    assert(loaded.history.getCount() == 2000);
+    assert(worstCapture < 2000);                         // generous for slow CI machines
+    delete[] block;
+    cleanUp();
+}
+
+// Durable replace of an existing file, and a failure that leaves it alone
+void test_atomic_replace() {
+    remove("atomic_test.dat");
+    assert(writeFileAtomically("atomic_test.dat", string("first"), true));
+    assert(writeFileAtomically("atomic_test.dat", string("second!"), true));
+    assert(writeFileAtomically("./atomic_test.dat", string("third"), true));
+    assert(!writeFileAtomically("no_such_dir/atomic_test.dat", string("x"), true));
+    MappedFile file;
+    assert(file.open("atomic_test.dat") && string(file.data(), file.size()) == "third");
+    file.close();
+    ifstream temp("atomic_test.dat.tmp");
+    assert(!temp.is_open());
+    remove("atomic_test.dat");
+}
+
+// A queue bigger than the old fixed [100] task buffer
+void test_large_schedule() {
+    cleanUp();
+    const int N = 500;
+    PriorityQueue scheduler(N);
+    for (int i = 0; i < N; i++) {
+        scheduler.enqueue(ScheduledTask("D" + to_string(i), "Device", i % 24, i % 60, 10, 1 + i % 9, false));
+    }
+    string bytes;
+    FileManager::encodeSchedule(scheduler, bytes);
+    assert(scheduler.getSize() == N);
+    assert(writeFileAtomically("schedule.dat", bytes));
+    PriorityQueue loaded(N);
+    assert(FileManager::loadSchedule(loaded) && loaded.getSize() == N);
+    assert(loaded.peek().priority == scheduler.peek().priority);
+    cleanUp();
+}
+
+int main() {
+    test_consistent_view();
+    test_large_schedule();
+    test_atomic_replace();
+    test_checkpoint_with_log();
+    test_crash_before_checkpoint_marker();
+    test_large_snapshot();
+    cout << "[test_snapshot_writer] All tests passed!" << endl;
+    return 0;
+}
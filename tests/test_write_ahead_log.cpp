@@ -0,0 +1,365 @@
+#include <iostream>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <fcntl.h>
+#include <unistd.h>
+#include "../write_ahead_log.h"
+
+using namespace std;
+
+// Everything the control loop logs, kept together like EnergyOptimizationSystem does
+struct State {
+    HashMap<string, Device*> registry;
+    DeviceTable table;
+    UsageHistoryBST history;
+    PriorityQueue scheduler;
+    int deviceCount;
+
+    State() : deviceCount(0) {}
+
+    int recover(WriteAheadLog& log) {
+        return log.recover("test_wal.log", registry, table, deviceCount, history, scheduler);
+    }
+
+    Device* get(const string& id) {
+        Device** d = registry.get(id);
+        return d ? *d : nullptr;
+    }
+};
+
+static void cleanUp() {
+    remove("test_wal.log");
+    remove("test_wal.log.ckpt");
+}
+
+static long fileSize(const char* path) {
+    ifstream in(path, ios::binary | ios::ate);
+    return in.is_open() ? (long)in.tellg() : -1;
+}
+
+// A session that never checkpoints comes back from the log alone
+void test_replay() {
+    cleanUp();
+    {
+        State live;
+        WriteAheadLog log;
+        assert(live.recover(log) == 0);
+
+        Device* heater = new Device("D1", "Heater", 2000, false, 4);
+        heater->attachTo(&live.table);
+        live.registry.insert("D1", heater);
+        log.logAddDevice(*heater);
+        Device* pump = new Device("D2", "Pump", 500, true, 9);
+        pump->attachTo(&live.table);
+        live.registry.insert("D2", pump);
+        log.logAddDevice(*pump);
+
+        heater->turnOn();
+        log.logDeviceState(*heater);
+        pump->turnOn();
+        log.logDeviceState(*pump);
+        pump->turnOff();
+        pump->unitsUsed = 1.25f;
+        log.logDeviceState(*pump);
+        log.logHistory(HistoryRecord("D2", "Pump", 500, 1000, 60, 1.25f));
+
+        ScheduledTask wash("D1", "Heater", 22, 30, 45, 4, false);
+        ScheduledTask early("D2", "Pump", 6, 0, 10, 9, true);
+        log.logSchedule(wash);
+        log.logSchedule(early);
+        log.logUnschedule(early);                        // ran
+        log.sync();
+        assert(log.lastLsn() == 9);
+    }                                                    // no checkpoint: the "crash"
+
+    State back;
+    WriteAheadLog log;
+    assert(back.recover(log) == 9);
+    assert(back.deviceCount == 2 && back.table.size() == 2);
+    Device* heater = back.get("D1");
+    Device* pump = back.get("D2");
+    assert(heater && pump);
+    assert(heater->isOn() && heater->priority == 4 && heater->deviceName == "Heater");
+    assert(!pump->isOn() && pump->isCritical && pump->unitsUsed == 1.25f);
+    assert(back.table.totalLoad() == 2000);
+    assert(back.history.getCount() == 1);
+    assert(back.scheduler.getSize() == 1 && back.scheduler.peek().scheduledTime == 22);
+
+    // New records continue the sequence
+    assert(log.logDeviceState(*pump) == 10);
+    log.close();
+    cleanUp();
+}
+
+// Records after a checkpoint are the only ones replayed; the log restarts empty
+void test_checkpoint() {
+    cleanUp();
+    {
+        State live;
+        WriteAheadLog log;
+        live.recover(log);
+        for (int i = 0; i < 20; i++) log.logHistory(HistoryRecord("D1", "Heater", 100, i, 10, 0.1f));
+        assert(log.markCheckpoint());
+        assert(log.lastCheckpointLsn() == 20 && fileSize("test_wal.log") == 0);
+        log.logHistory(HistoryRecord("D1", "Heater", 100, 99, 10, 0.1f));
+        log.logHistory(HistoryRecord("D1", "Heater", 100, 100, 10, 0.1f));
+    }
+    State back;
+    WriteAheadLog log;
+    assert(back.recover(log) == 2);
+    assert(back.history.getCount() == 2);
+    assert(log.lastLsn() == 22 && log.lastCheckpointLsn() == 20);
+    log.close();
+    cleanUp();
+}
+
+// Changes logged while a checkpoint is being written survive a crash either way
+void test_checkpoint_in_flight() {
+    cleanUp();
+    remove("test_wal.log.old");
+    {
+        State live;
+        WriteAheadLog log;
+        live.recover(log);
+        for (int i = 0; i < 3; i++) log.logHistory(HistoryRecord("D1", "Heater", 100, i, 10, 0.1f));
+        assert(log.beginCheckpoint() == 3);             // snapshot taken, files not written yet
+        log.logHistory(HistoryRecord("D1", "Heater", 100, 3, 10, 0.1f));
+        log.logHistory(HistoryRecord("D1", "Heater", 100, 4, 10, 0.1f));
+    }                                                    // crash before completeCheckpoint
+    {
+        State back;
+        WriteAheadLog log;
+        assert(back.recover(log) == 5);                  // sealed segment + new one
+
+        // A second snapshot while the first is unfinished folds both into one sealed segment
+        uint64_t first = 3;
+        uint64_t second = log.beginCheckpoint();
+        assert(second == 5);
+        log.logHistory(HistoryRecord("D1", "Heater", 100, 5, 10, 0.1f));
+        assert(log.completeCheckpoint(first));           // stale: the sealed segment stays
+        assert(fileSize("test_wal.log.old") > 0);
+        assert(log.completeCheckpoint(second));
+        assert(fileSize("test_wal.log.old") == -1);
+    }
+    State back;
+    WriteAheadLog log;
+    assert(back.recover(log) == 1);
+    assert(log.lastLsn() == 6 && log.lastCheckpointLsn() == 5);
+    log.close();
+    cleanUp();
+}
+
+// Checkpoints (renames, merges, markers) run while another thread keeps
+// appending: nothing is lost and every record lands in exactly one place
+void test_checkpoint_while_appending() {
+    cleanUp();
+    remove("test_wal.log.old");
+    const int N = 3000;
+    uint64_t covered = 0;
+    {
+        State live;
+        WriteAheadLog log(2);
+        live.recover(log);
+        atomic<bool> done(false);
+        thread writer([&] {
+            for (int i = 0; i < N; i++) log.logHistory(HistoryRecord("D1", "Heater", 100, i, 10, 0.1f));
+            done = true;
+        });
+        int rounds = 0;
+        while (!done || rounds < 4) {
+            uint64_t lsn = log.beginCheckpoint();
+            if (rounds % 2 == 1) {                       // every other one folds into the sealed segment
+                assert(log.completeCheckpoint(lsn));
+                covered = lsn;
+            }
+            rounds++;
+        }
+        writer.join();
+        assert(log.sync() && log.lastLsn() == (uint64_t)N);
+    }                                                    // crash, maybe mid-checkpoint
+    State back;
+    WriteAheadLog log;
+    assert(back.recover(log) == (int)(N - covered));
+    assert(back.history.getCount() == (int)(N - covered));
+    assert(log.lastLsn() == (uint64_t)N && log.lastCheckpointLsn() == covered);
+    log.close();
+    remove("test_wal.log.old");
+    cleanUp();
+}
+
+// A record cut short by a crash is dropped, and appends resume after the good ones
+void test_torn_tail() {
+    cleanUp();
+    {
+        State live;
+        WriteAheadLog log;
+        live.recover(log);
+        for (int i = 0; i < 5; i++) log.logHistory(HistoryRecord("D1", "Heater", 100, i, 10, 0.1f));
+    }
+    long size = fileSize("test_wal.log");
+    char* bytes = new char[size];
+    ifstream in("test_wal.log", ios::binary);
+    in.read(bytes, size);
+    in.close();
+    ofstream out("test_wal.log", ios::binary | ios::trunc);
+    out.write(bytes, size - 3);
+    out.close();
+    delete[] bytes;
+
+    {
+        State back;
+        WriteAheadLog log;
+        assert(back.recover(log) == 4);
+        assert(fileSize("test_wal.log") < size - 3);     // torn record cut off
+        assert(log.logHistory(HistoryRecord("D1", "Heater", 100, 7, 10, 0.1f)) == 5);
+    }
+    State again;
+    WriteAheadLog log;
+    assert(again.recover(log) == 5);
+    log.close();
+
+    // A flipped byte in the middle stops replay there
+    size = fileSize("test_wal.log");
+    fstream patch("test_wal.log", ios::binary | ios::in | ios::out);
+    patch.seekp(size / 2);
+    patch.put('\x7f');
+    patch.close();
+    State damaged;
+    assert(damaged.recover(log) < 5);
+    log.close();
+    cleanUp();
+}
+
+// Appends that arrive together share one fsync
+void test_group_commit() {
+    cleanUp();
+    State live;
+    WriteAheadLog log(20);
+    live.recover(log);
+    Device d("D1", "Heater", 100);
+    const int N = 20000;
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < N; i++) {
+        d.unitsUsed = i;
+        log.logDeviceState(d);
+    }
+    double appendMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    log.sync();
+    cout << "  " << N << " appends in " << appendMs << " ms, " << log.flushes() << " fsyncs" << endl;
+    assert(log.appends() == N && log.lastLsn() == N);
+    assert(log.flushes() < N / 10);
+    log.close();
+
+    State back;
+    Device* target = new Device("D1", "Heater", 100);
+    target->attachTo(&back.table);
+    back.registry.insert("D1", target);
+    assert(back.recover(log) == N);
+    assert(target->unitsUsed == N - 1);
+    log.close();
+    cleanUp();
+}
+
+static string readAll(const char* path) {
+    ifstream in(path, ios::binary);
+    return string((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+}
+
+static void writeAll(const char* path, const string& bytes) {
+    ofstream out(path, ios::binary | ios::trunc);
+    out.write(bytes.data(), bytes.size());
+}
+
+// A crash while merging into wal.log.old tears it or leaves wal.log's
+// records in both segments; the live segment must survive either way
+void test_torn_old_segment() {
+    cleanUp();
+    remove("test_wal.log.old");
+    {
+        State live;
+        WriteAheadLog log;
+        live.recover(log);
+        for (int i = 0; i < 3; i++) log.logHistory(HistoryRecord("D1", "Heater", 100, i, 10, 0.1f));
+        assert(log.beginCheckpoint() == 3);
+        log.logHistory(HistoryRecord("D1", "Heater", 100, 3, 10, 0.1f));
+        log.logHistory(HistoryRecord("D1", "Heater", 100, 4, 10, 0.1f));
+    }                                                    // crash: old = 1..3, live = 4..5
+    string sealed = readAll("test_wal.log.old");
+    string current = readAll("test_wal.log");
+
+    // Merge renamed into place but wal.log not yet removed: no record twice
+    writeAll("test_wal.log.old", sealed + current);
+    {
+        State back;
+        WriteAheadLog log;
+        assert(back.recover(log) == 5 && back.history.getCount() == 5);
+        assert(log.lastLsn() == 5);
+    }
+
+    // Old segment torn in its last record
+    writeAll("test_wal.log.old", sealed.substr(0, sealed.size() - 5));
+    writeAll("test_wal.log", current);
+    {
+        State back;
+        WriteAheadLog log;
+        assert(back.recover(log) == 4);                  // 1, 2 from old + 4, 5 live
+        assert(fileSize("test_wal.log") == (long)current.size());
+        assert(fileSize("test_wal.log.old") < (long)sealed.size() - 5);
+        assert(log.logHistory(HistoryRecord("D1", "Heater", 100, 5, 10, 0.1f)) == 6);
+    }
+    State again;
+    WriteAheadLog log;
+    assert(again.recover(log) == 5);                     // old cut back cleanly, nothing lost after
+    log.close();
+    remove("test_wal.log.old");
+    cleanUp();
+}
+
+// A batch that cannot be written is not durable: sync() fails until a retry lands it
+void test_write_failure() {
+    cleanUp();
+    State live;
+    WriteAheadLog log(1);
+    live.recover(log);
+    for (int i = 0; i < 3; i++) log.logHistory(HistoryRecord("D1", "Heater", 100, i, 10, 0.1f));
+    assert(log.sync() && log.lastDurableLsn() == 3);
+    long good = fileSize("test_wal.log");
+
+    int broken = open("test_wal.log", O_RDONLY);          // writes fail with EBADF
+    assert(broken >= 0);
+    int healthy = log.swapDescriptor(broken);
+    log.logHistory(HistoryRecord("D1", "Heater", 100, 3, 10, 0.1f));
+    log.logHistory(HistoryRecord("D1", "Heater", 100, 4, 10, 0.1f));
+    assert(!log.sync());
+    assert(log.hadError() && log.lastDurableLsn() == 3);
+    assert(fileSize("test_wal.log") == good);
+
+    log.swapDescriptor(healthy);                          // disk is back: the retry lands
+    assert(log.sync() && log.lastDurableLsn() == 5 && !log.hadError());
+    close(broken);
+    log.close();
+
+    State back;
+    WriteAheadLog again;
+    assert(back.recover(again) == 5);
+    again.close();
+    cleanUp();
+}
+
+int main() {
+    test_replay();
+    test_checkpoint();
+    test_checkpoint_in_flight();
+    test_checkpoint_while_appending();
+    test_torn_tail();
+    test_torn_old_segment();
+    test_group_commit();
+    test_write_failure();
+    cout << "[test_write_ahead_log] All tests passed!" << endl;
+    return 0;
+}
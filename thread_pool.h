@@ -0,0 +1,164 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+using namespace std;
+
+// Fixed set of worker threads for data-parallel loops.
+// run(fn) calls fn(worker) once on every worker 0..size()-1 and returns
+// when all of them are done; the calling thread is worker 0, so a pool of
+// size 1 just runs fn(0) inline with no threads at all.
+class ThreadPool {
+private:
+    thread* workers;
+    int workerCount;                      // including the caller
+
+    mutex lock;
+    condition_variable wake;
+    condition_variable finished;
+    const function<void(int)>* job;
+    long long generation;                 // bumped for every run()
+    int running;                          // helpers still busy with the current job
+    bool stopping;
+
+    void workerLoop(int id) {
+        long long seen = 0;
+        while (true) {
+            const function<void(int)>* current;
+            {
+                unique_lock<mutex> guard(lock);
+                wake.wait(guard, [&] { return stopping || generation != seen; });
+                if (stopping) return;
+                seen = generation;
+                current = job;
+            }
+            (*current)(id);
+            {
+                lock_guard<mutex> guard(lock);
+                if (--running == 0) finished.notify_one();
+            }
+        }
+    }
+
+public:
+    // threads <= 0 means one per hardware thread
+    ThreadPool(int threads = 0) : job(nullptr), generation(0), running(0), stopping(false) {
+        if (threads <= 0) threads = (int)thread::hardware_concurrency();
+        if (threads <= 0) threads = 1;
+        workerCount = threads;
+        workers = new thread[workerCount > 1 ? workerCount - 1 : 1];
+        for (int i = 1; i < workerCount; i++) {
+            workers[i - 1] = thread(&ThreadPool::workerLoop, this, i);
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            lock_guard<mutex> guard(lock);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (int i = 1; i < workerCount; i++) workers[i - 1].join();
+        delete[] workers;
+    }
+
+    int size() const { return workerCount; }
+
+    void run(const function<void(int)>& fn) {
+        if (workerCount == 1) {
+            fn(0);
+            return;
+        }
+        {
+            lock_guard<mutex> guard(lock);
+            job = &fn;
+            running = workerCount - 1;
+            generation++;
+        }
+        wake.notify_all();
+        fn(0);
+        unique_lock<mutex> guard(lock);
+        finished.wait(guard, [&] { return running == 0; });
+    }
+
+    // Splits [0, count) into size() contiguous chunks: fn(worker, begin, end)
+    void parallelFor(int count, const function<void(int, int, int)>& fn) {
+        int chunks = workerCount;
+        run([&](int worker) {
+            int begin = (int)((long long)count * worker / chunks);
+            int end = (int)((long long)count * (worker + 1) / chunks);
+            if (begin < end) fn(worker, begin, end);
+        });
+    }
+};
+
+// Work-stealing loop over chunks on top of a ThreadPool. [0, count) is cut
+// into chunks of `grain`; each worker starts with a contiguous run of chunks
+// in its own deque and takes from the front of it. A worker whose deque is
+// empty steals from the back of another's, so uneven chunks (homes with
+// more work, a slow core) don't leave the others idle at the end of a step.
+class WorkStealingPool {
+private:
+    struct Deque {
+        mutex lock;
+        int front;                // next chunk for the owner
+        int back;                 // one past the last chunk (thieves take back - 1)
+    };
+
+    ThreadPool& pool;
+    Deque* deques;
+
+    bool popFront(int w, int& chunk) {
+        lock_guard<mutex> guard(deques[w].lock);
+        if (deques[w].front >= deques[w].back) return false;
+        chunk = deques[w].front++;
+        return true;
+    }
+
+    bool stealBack(int w, int& chunk) {
+        lock_guard<mutex> guard(deques[w].lock);
+        if (deques[w].front >= deques[w].back) return false;
+        chunk = --deques[w].back;
+        return true;
+    }
+
+public:
+    WorkStealingPool(ThreadPool& p) : pool(p) {
+        deques = new Deque[pool.size()];
+    }
+
+    ~WorkStealingPool() {
+        delete[] deques;
+    }
+
+    int size() const { return pool.size(); }
+
+    // fn(worker, begin, end) for every chunk; returns when all are done
+    void parallelFor(int count, int grain, const function<void(int, int, int)>& fn) {
+        if (grain < 1) grain = 1;
+        int chunks = (count + grain - 1) / grain;
+        int workers = pool.size();
+        for (int w = 0; w < workers; w++) {
+            deques[w].front = (int)((long long)chunks * w / workers);
+            deques[w].back = (int)((long long)chunks * (w + 1) / workers);
+        }
+        pool.run([&](int worker) {
+            int chunk;
+            while (true) {
+                bool got = popFront(worker, chunk);
+                for (int k = 1; !got && k < workers; k++) {
+                    got = stealBack((worker + k) % workers, chunk);
+                }
+                if (!got) return;         // no chunk is ever added, so all done
+                int begin = chunk * grain;
+                int end = begin + grain < count ? begin + grain : count;
+                fn(worker, begin, end);
+            }
+        });
+    }
+};
+
+#endif // THREAD_POOL_H
@@ -2,6 +2,7 @@
 #define UTILS_H
 
 #include <string>
+#include <cstdint>
 using namespace std;
 
 // Hash function for strings
@@ -13,6 +14,18 @@ inline unsigned int hashString(const string& str) {
     return h;
 }
 
+// FNV-1a (64-bit) over raw bytes; pass the previous result as `h` to
+// checksum several blocks as one
+const uint64_t FNV1A_OFFSET = 1469598103934665603ULL;
+
+inline uint64_t fnv1a64(const char* data, uint64_t bytes, uint64_t h = FNV1A_OFFSET) {
+    for (uint64_t i = 0; i < bytes; i++) {
+        h ^= (unsigned char)data[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
 #endif // UTILS_H
 
 
@@ -0,0 +1,671 @@
+#ifndef WRITE_AHEAD_LOG_H
+#define WRITE_AHEAD_LOG_H
+
+#include <string>
+#include <cstring>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <fcntl.h>
+#ifndef _WIN32
+#include <unistd.h>
+#else
+#include <io.h>
+#endif
+#include "device.h"
+#include "device_table.h"
+#include "hashmap.h"
+#include "history.h"
+#include "priority_queue.h"
+#include "mapped_file.h"
+#include "utils.h"
+using namespace std;
+
+// Append-only log of the changes made since the last checkpoint (wal.log).
+//
+// Every mutation the control loop makes (device added, device state after
+// a toggle / shed / restore, task scheduled or run, history record) is
+// appended as one record:
+//
+//   WalRecordHeader   payloadBytes, type, lsn, FNV-1a over type+lsn+payload
+//   payload           ints / floats / length-prefixed strings
+//
+// Appends only copy into a memory buffer. A flusher thread writes the
+// buffer and fsyncs it once per batch (group commit): whatever arrived
+// within maxDelayMs - or maxBatchBytes, whichever comes first - shares one
+// fsync. sync() waits until everything appended so far is on disk. A batch
+// whose write or fsync fails is cut back off the file and retried; until
+// it succeeds sync() returns false.
+//
+// A checkpoint is the four .dat files. When the snapshot for one is taken,
+// beginCheckpoint() seals the log as wal.log.old and starts a fresh
+// wal.log, so changes made while the files are being written keep being
+// logged. Once the files are on disk, completeCheckpoint() records the LSN
+// they cover in wal.log.ckpt and deletes wal.log.old. recover() replays
+// wal.log.old then wal.log (records past that LSN) on top of the loaded
+// files and cuts off a torn tail (a record cut short by a crash). A crash
+// between the .dat renames and the marker leaves records the files already
+// hold in the log: history.dat / schedule.dat carry the LSN they cover
+// (setCoveredLsns), and those records are skipped. Device records are
+// idempotent.
+enum WalRecordType {
+    WAL_ADD_DEVICE = 1,
+    WAL_DEVICE_STATE = 2,
+    WAL_SCHEDULE = 3,
+    WAL_UNSCHEDULE = 4,
+    WAL_HISTORY = 5
+};
+
+struct WalRecordHeader {
+    uint32_t payloadBytes;
+    uint32_t type;
+    uint64_t lsn;
+    uint64_t checksum;
+};
+
+class WriteAheadLog {
+private:
+    string path;
+    int fd;                       // -1 until recover() succeeds
+    int maxDelayMs;
+    size_t maxBatchBytes;
+
+    mutex lock;
+    condition_variable wake;      // flusher: new data / stop / sync request
+    condition_variable flushed;   // sync(): durableLsn moved
+    thread flusher;
+    string pending;               // encoded records not yet written
+    uint64_t nextLsn;
+    uint64_t durableLsn;
+    uint64_t checkpointLsn;
+    bool hasOldSegment;           // wal.log.old exists (a checkpoint is in flight)
+    uint64_t oldSegmentLsn;       // last LSN in it
+    uint64_t logBytes;            // bytes in wal.log (written)
+    uint64_t historyCoveredLsn;   // history.dat already holds records up to here
+    uint64_t scheduleCoveredLsn;  // schedule.dat likewise
+    int syncWaiters;
+    bool stopping;
+    bool flushing;                // flusher is writing a batch (outside the lock)
+    bool sealing;                 // beginCheckpoint is swapping segments: flusher holds off
+    bool checkpointBusy;          // a checkpoint step is doing file I/O (outside the lock)
+    bool ioError;                 // last write / fsync failed, batch waits for a retry
+    long long appendCount;
+    long long flushCount;
+    long long attemptCount;       // batches tried, successful or not
+
+    // Encoding helpers
+    static void putInt(string& out, int32_t v) { out.append((const char*)&v, sizeof(v)); }
+    static void putFloat(string& out, float v) { out.append((const char*)&v, sizeof(v)); }
+    static void putString(string& out, const string& s) {
+        putInt(out, (int32_t)s.size());
+        out.append(s);
+    }
+
+    struct Reader {
+        const char* p;
+        const char* end;
+
+        template <class T>
+        bool read(T& value) {
+            if (end - p < (long)sizeof(T)) return false;
+            memcpy(&value, p, sizeof(T));
+            p += sizeof(T);
+            return true;
+        }
+
+        bool readString(string& s) {
+            int32_t len;
+            if (!read(len) || len < 0 || end - p < len) return false;
+            s.assign(p, len);
+            p += len;
+            return true;
+        }
+    };
+
+    static uint64_t checksumOf(uint32_t type, uint64_t lsn, const char* payload, uint32_t bytes) {
+        uint64_t h = fnv1a64((const char*)&type, sizeof(type));
+        h = fnv1a64((const char*)&lsn, sizeof(lsn), h);
+        return fnv1a64(payload, bytes, h);
+    }
+
+    uint64_t append(WalRecordType type, const string& payload) {
+        lock_guard<mutex> guard(lock);
+        if (fd < 0) return 0;
+        WalRecordHeader header;
+        header.payloadBytes = payload.size();
+        header.type = type;
+        header.lsn = nextLsn++;
+        header.checksum = checksumOf(header.type, header.lsn, payload.data(), header.payloadBytes);
+        pending.append((const char*)&header, sizeof(header));
+        pending.append(payload);
+        appendCount++;
+        wake.notify_one();
+        return header.lsn;
+    }
+
+    static bool writeAll(int file, const char* data, size_t bytes) {
+        while (bytes > 0) {
+#ifndef _WIN32
+            long n = ::write(file, data, bytes);
+#else
+            long n = _write(file, data, (unsigned)bytes);
+#endif
+            if (n <= 0) return false;
+            data += n;
+            bytes -= n;
+        }
+        return true;
+    }
+
+    static void closeDescriptor(int file) {
+#ifndef _WIN32
+        ::close(file);
+#else
+        _close(file);
+#endif
+    }
+
+    void closeFile() {
+        if (fd < 0) return;
+        closeDescriptor(fd);
+        fd = -1;
+    }
+
+    static bool syncFile(int file) {
+#ifndef _WIN32
+        return fsync(file) == 0;
+#else
+        return _commit(file) == 0;
+#endif
+    }
+
+    static bool truncateFile(int file, uint64_t bytes) {
+#ifndef _WIN32
+        return ftruncate(file, (off_t)bytes) == 0;
+#else
+        return _chsize(file, (long)bytes) == 0;
+#endif
+    }
+
+    void flushLoop() {
+        unique_lock<mutex> guard(lock);
+        while (true) {
+            wake.wait(guard, [&] { return (stopping || !pending.empty()) && !sealing; });
+            if (pending.empty()) break;                       // stopping, nothing left
+            if (ioError) {
+                // Back off before retrying a failed batch
+                wake.wait_for(guard, chrono::milliseconds(maxDelayMs), [&] { return stopping; });
+            } else {
+                // Let the batch fill for a moment unless someone is waiting on it
+                wake.wait_for(guard, chrono::milliseconds(maxDelayMs), [&] {
+                    return stopping || syncWaiters > 0 || pending.size() >= maxBatchBytes;
+                });
+            }
+            if (sealing) continue;                            // segment swapped meanwhile
+            string batch;
+            batch.swap(pending);
+            uint64_t upTo = nextLsn - 1;
+            int file = fd;
+            uint64_t base = logBytes;
+            flushing = true;
+            guard.unlock();
+            bool ok = writeAll(file, batch.data(), batch.size()) && syncFile(file);
+            // A partly written batch must not stay in front of the retry
+            if (!ok) truncateFile(file, base);
+            guard.lock();
+            flushing = false;
+            attemptCount++;
+            if (ok) {
+                ioError = false;
+                logBytes += batch.size();
+                durableLsn = upTo;
+                flushCount++;
+            } else {
+                ioError = true;
+                if (!stopping) pending.insert(0, batch);      // retried; given up on close
+            }
+            flushed.notify_all();
+        }
+    }
+
+    static bool fileExists(const string& file) {
+        ifstream in(file.c_str(), ios::binary);
+        return in.is_open();
+    }
+
+    // Opens a segment for appending, cut to keepBytes (-1: as it is)
+    static int openSegment(const string& file, long long keepBytes) {
+#ifndef _WIN32
+        int segment = ::open(file.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+#else
+        int segment = _open(file.c_str(), _O_WRONLY | _O_CREAT | _O_APPEND | _O_BINARY, 0644);
+#endif
+        if (segment >= 0 && keepBytes >= 0 && !truncateFile(segment, keepBytes)) {
+            closeDescriptor(segment);
+            return -1;
+        }
+        return segment;
+    }
+
+    // Cuts a segment back to its intact prefix, durably
+    static bool cutSegment(const string& file, uint64_t bytes) {
+        int segment = openSegment(file, (long long)bytes);
+        if (segment < 0) return false;
+        bool ok = syncFile(segment);
+        closeDescriptor(segment);
+        return ok;
+    }
+
+    // New contents of wal.log.old when an unfinished checkpoint's segment
+    // absorbs the current one: both, back to back
+    static bool mergeInto(const string& from, const string& to) {
+        string bytes;
+        {
+            MappedFile sealed, current;                   // unmapped before the rename
+            if (sealed.open(to)) bytes.append(sealed.data(), sealed.size());
+            if (current.open(from)) bytes.append(current.data(), current.size());
+        }
+        return writeFileAtomically(to, bytes, true);
+    }
+
+    // Applies the intact records of one segment past the checkpoint LSN
+    // and past any already applied (a merge that crashed before removing
+    // wal.log leaves its records in both segments).
+    // validBytes: length of the intact prefix; returns false if the
+    // segment ends in a torn or damaged record
+    bool replaySegment(const string& file, HashMap<string, Device*>& registry, DeviceTable& table,
+                       int& deviceCount, UsageHistoryBST& history, PriorityQueue& scheduler,
+                       int& replayed, uint64_t& validBytes) {
+        MappedFile segment;
+        validBytes = 0;
+        if (!segment.open(file)) return true;
+        uint64_t offset = 0;
+        while (offset < segment.size()) {
+            const WalRecordHeader* h = segment.at<WalRecordHeader>(offset);
+            if (!h) break;
+            const char* payload = segment.at<char>(offset + sizeof(WalRecordHeader), h->payloadBytes);
+            if (!payload || checksumOf(h->type, h->lsn, payload, h->payloadBytes) != h->checksum) break;
+            if (h->lsn >= nextLsn && !coveredByFile(h->type, h->lsn)) {   // nextLsn starts past the checkpoint
+                Reader in = { payload, payload + h->payloadBytes };
+                if (!apply(h->type, in, registry, table, deviceCount, history, scheduler)) break;
+                replayed++;
+            }
+            if (h->lsn >= nextLsn) nextLsn = h->lsn + 1;
+            offset += sizeof(WalRecordHeader) + h->payloadBytes;
+        }
+        validBytes = offset;
+        return offset == segment.size();
+    }
+
+    bool coveredByFile(uint32_t type, uint64_t lsn) const {
+        if (type == WAL_HISTORY) return lsn <= historyCoveredLsn;
+        if (type == WAL_SCHEDULE || type == WAL_UNSCHEDULE) return lsn <= scheduleCoveredLsn;
+        return false;
+    }
+
+    // Checkpoint marker: magic + LSN, replaced atomically
+    bool writeMarker(uint64_t lsn) {
+        string bytes("ECWALCKP", 8);
+        bytes.append((const char*)&lsn, sizeof(lsn));
+        return writeFileAtomically(path + ".ckpt", bytes, true);
+    }
+
+    uint64_t readMarker() const {
+        MappedFile file;
+        if (!file.open(path + ".ckpt")) return 0;
+        const uint64_t* lsn = file.at<uint64_t>(8);
+        if (!lsn || memcmp(file.data(), "ECWALCKP", 8) != 0) return 0;
+        return *lsn;
+    }
+
+    static void applyDeviceState(Device* d, DeviceStatus status, float units, int timestamp, int startTime) {
+        if (d->status != status && d->table) d->table->setOn(d->tableSlot, status == STATUS_ON);
+        d->status = status;
+        d->unitsUsed = units;
+        d->timestamp = timestamp;
+        d->startTime = startTime;
+    }
+
+    static bool sameTask(const ScheduledTask& a, const ScheduledTask& b) {
+        return a.deviceID == b.deviceID && a.scheduledTime == b.scheduledTime &&
+               a.scheduledMinute == b.scheduledMinute && a.duration == b.duration;
+    }
+
+    // Takes the first task matching `task` out of the queue
+    static void removeTask(PriorityQueue& scheduler, const ScheduledTask& task) {
+        int size = scheduler.getSize();
+        ScheduledTask* tasks = new ScheduledTask[size + 1];
+        for (int i = 0; i < size; i++) tasks[i] = scheduler.dequeue();
+        bool removed = false;
+        for (int i = 0; i < size; i++) {
+            if (!removed && sameTask(tasks[i], task)) {
+                removed = true;
+                continue;
+            }
+            scheduler.enqueue(tasks[i]);
+        }
+        delete[] tasks;
+    }
+
+    static bool readTask(Reader& in, ScheduledTask& task) {
+        int32_t hour, minute, duration, priority, critical;
+        float cost;
+        if (!(in.readString(task.deviceID) && in.readString(task.deviceName) && in.read(hour) &&
+              in.read(minute) && in.read(duration) && in.read(priority) && in.read(critical) &&
+              in.read(cost))) return false;
+        task.scheduledTime = hour;
+        task.scheduledMinute = minute;
+        task.duration = duration;
+        task.priority = priority;
+        task.isCritical = critical != 0;
+        task.estimatedCost = cost;
+        return true;
+    }
+
+    static void putTask(string& out, const ScheduledTask& task) {
+        putString(out, task.deviceID);
+        putString(out, task.deviceName);
+        putInt(out, task.scheduledTime);
+        putInt(out, task.scheduledMinute);
+        putInt(out, task.duration);
+        putInt(out, task.priority);
+        putInt(out, task.isCritical ? 1 : 0);
+        putFloat(out, task.estimatedCost);
+    }
+
+    // Applies one record; false if the payload does not decode
+    static bool apply(uint32_t type, Reader in, HashMap<string, Device*>& registry, DeviceTable& table,
+                      int& deviceCount, UsageHistoryBST& history, PriorityQueue& scheduler) {
+        switch (type) {
+            case WAL_ADD_DEVICE: {
+                string id, name;
+                float rate, units;
+                int32_t critical, priority, status, timestamp, startTime;
+                if (!(in.readString(id) && in.readString(name) && in.read(rate) && in.read(critical) &&
+                      in.read(priority) && in.read(status) && in.read(units) && in.read(timestamp) &&
+                      in.read(startTime))) return false;
+                if (registry.contains(id)) return true;          // already in the checkpoint
+                Device* d = new Device(id, name, rate, critical != 0, priority);
+                d->priority = priority;
+                d->status = status ? STATUS_ON : STATUS_OFF;
+                d->unitsUsed = units;
+                d->timestamp = timestamp;
+                d->startTime = startTime;
+                d->attachTo(&table);
+                registry.insert(id, d);
+                deviceCount++;
+                return true;
+            }
+            case WAL_DEVICE_STATE: {
+                string id;
+                int32_t status, timestamp, startTime;
+                float units;
+                if (!(in.readString(id) && in.read(status) && in.read(units) && in.read(timestamp) &&
+                      in.read(startTime))) return false;
+                Device** d = registry.get(id);
+                if (d) applyDeviceState(*d, status ? STATUS_ON : STATUS_OFF, units, timestamp, startTime);
+                return true;
+            }
+            case WAL_SCHEDULE:
+            case WAL_UNSCHEDULE: {
+                ScheduledTask task;
+                if (!readTask(in, task)) return false;
+                if (type == WAL_SCHEDULE) scheduler.enqueue(task);
+                else removeTask(scheduler, task);
+                return true;
+            }
+            case WAL_HISTORY: {
+                HistoryRecord r;
+                int32_t timestamp, duration;
+                if (!(in.readString(r.deviceID) && in.readString(r.deviceName) && in.read(r.consumptionRate) &&
+                      in.read(timestamp) && in.read(duration) && in.read(r.unitsConsumed))) return false;
+                r.timestamp = timestamp;
+                r.duration = duration;
+                history.insertRecord(r);
+                return true;
+            }
+        }
+        return false;
+    }
+
+public:
+    WriteAheadLog(int groupCommitMs = 10, size_t groupCommitBytes = 64 * 1024)
+        : fd(-1), maxDelayMs(groupCommitMs), maxBatchBytes(groupCommitBytes), nextLsn(1),
+          durableLsn(0), checkpointLsn(0), hasOldSegment(false), oldSegmentLsn(0), logBytes(0),
+          historyCoveredLsn(0), scheduleCoveredLsn(0), syncWaiters(0), stopping(false),
+          flushing(false), sealing(false), checkpointBusy(false), ioError(false), appendCount(0), flushCount(0), attemptCount(0) {}
+
+    ~WriteAheadLog() {
+        close();
+    }
+
+    // Before recover(): the LSNs stamped into history.dat / schedule.dat
+    // (FileManager::loadHistory / loadSchedule); records at or below them
+    // are in the files already and are not replayed
+    void setCoveredLsns(uint64_t historyLsn, uint64_t scheduleLsn) {
+        historyCoveredLsn = historyLsn;
+        scheduleCoveredLsn = scheduleLsn;
+    }
+
+    // Replays the records after the last checkpoint on top of the state
+    // loaded from the .dat files, then opens the log for appending.
+    // Returns how many records were applied, or -1 if the log cannot be opened.
+    int recover(const string& logPath, HashMap<string, Device*>& registry, DeviceTable& table,
+                int& deviceCount, UsageHistoryBST& history, PriorityQueue& scheduler) {
+        close();
+        path = logPath;
+        checkpointLsn = readMarker();
+        nextLsn = checkpointLsn + 1;
+        hasOldSegment = fileExists(path + ".old");
+        oldSegmentLsn = 0;
+
+        // The sealed segment of an unfinished checkpoint comes first. A torn
+        // tail there (a crash mid-merge) is cut off; wal.log is still replayed
+        int replayed = 0;
+        if (hasOldSegment) {
+            uint64_t oldBytes = 0;
+            if (!replaySegment(path + ".old", registry, table, deviceCount, history, scheduler,
+                               replayed, oldBytes)) {
+                cutSegment(path + ".old", oldBytes);
+            }
+            oldSegmentLsn = nextLsn - 1;
+        }
+        uint64_t validBytes = 0;
+        replaySegment(path, registry, table, deviceCount, history, scheduler, replayed, validBytes);
+        // New records must never fall under a stamp (e.g. a log that was lost)
+        uint64_t covered = historyCoveredLsn > scheduleCoveredLsn ? historyCoveredLsn : scheduleCoveredLsn;
+        if (nextLsn <= covered) nextLsn = covered + 1;
+
+        fd = openSegment(path, validBytes);
+        if (fd < 0) return -1;
+        logBytes = validBytes;
+        durableLsn = nextLsn - 1;
+        stopping = false;
+        ioError = false;
+        flusher = thread(&WriteAheadLog::flushLoop, this);
+        return replayed;
+    }
+
+    // Flushes what is pending and stops the flusher
+    void close() {
+        if (flusher.joinable()) {
+            {
+                lock_guard<mutex> guard(lock);
+                stopping = true;
+            }
+            wake.notify_all();
+            flusher.join();
+        }
+        closeFile();
+    }
+
+    // Blocks until every record appended so far is on disk. Returns false
+    // if writing them failed (they stay queued and are retried)
+    bool sync() {
+        unique_lock<mutex> guard(lock);
+        if (fd < 0) return false;
+        uint64_t target = nextLsn - 1;
+        long long attempt = attemptCount;
+        syncWaiters++;
+        wake.notify_one();
+        // Done once the records are on disk, or a write tried after this call failed
+        flushed.wait(guard, [&] { return durableLsn >= target || (ioError && attemptCount > attempt); });
+        syncWaiters--;
+        return durableLsn >= target;
+    }
+
+    // Checkpoint, step 1 (with the state unchanged since the snapshot was
+    // taken): seals the current segment as wal.log.old and starts an empty
+    // wal.log. Returns the LSN the snapshot covers. Costs one fsync.
+    // Records still queued after a failed write go into the new segment;
+    // they are at or below the returned LSN, so the snapshot covers them.
+    // The rename / merge runs outside the lock: appends keep queueing and
+    // the flusher picks them up once the new segment is open.
+    uint64_t beginCheckpoint() {
+        sync();
+        unique_lock<mutex> guard(lock);
+        // no batch half in the old segment, no other checkpoint step running
+        flushed.wait(guard, [&] { return !flushing && !checkpointBusy; });
+        uint64_t lsn = nextLsn - 1;
+        if (fd < 0) return lsn;
+        checkpointBusy = true;
+        sealing = true;
+        int file = fd;
+        bool merge = hasOldSegment;
+        uint64_t keepBytes = logBytes;
+        guard.unlock();
+
+        closeDescriptor(file);
+        string old = path + ".old";
+        bool sealed;
+        if (merge) {
+            // An earlier checkpoint never finished: its records stay, ours go
+            // after them. The merged copy replaces wal.log.old in one rename,
+            // so a crash leaves either segment whole (recover skips repeats)
+            sealed = mergeInto(path, old) && remove(path.c_str()) == 0;
+        } else {
+            sealed = rename(path.c_str(), old.c_str()) == 0;
+        }
+        int next = openSegment(path, sealed ? 0 : (long long)keepBytes);
+
+        guard.lock();
+        fd = next;
+        if (next < 0) {
+            ioError = true;
+        } else if (sealed) {
+            hasOldSegment = true;
+            oldSegmentLsn = lsn;
+            logBytes = 0;
+        }
+        sealing = false;
+        checkpointBusy = false;
+        wake.notify_one();
+        flushed.notify_all();
+        return lsn;
+    }
+
+    // Checkpoint, step 2 (any thread), once the .dat files covering `lsn`
+    // are on disk: records the LSN and drops the sealed segment if nothing
+    // newer was sealed into it meanwhile. The marker write and the delete
+    // run outside the lock; appends are not held up by them.
+    bool completeCheckpoint(uint64_t lsn) {
+        unique_lock<mutex> guard(lock);
+        if (path.empty()) return false;
+        flushed.wait(guard, [&] { return !checkpointBusy; });
+        checkpointBusy = true;
+        bool newer = lsn > checkpointLsn;
+        guard.unlock();
+        bool ok = !newer || writeMarker(lsn);
+
+        guard.lock();
+        if (ok && newer) checkpointLsn = lsn;
+        bool dropOld = ok && hasOldSegment && oldSegmentLsn <= checkpointLsn;
+        if (dropOld) hasOldSegment = false;
+        guard.unlock();
+        if (dropOld) remove((path + ".old").c_str());   // no begin can run: still busy
+
+        guard.lock();
+        checkpointBusy = false;
+        flushed.notify_all();
+        return ok;
+    }
+
+    // Both steps at once, for callers that save on the same thread
+    bool markCheckpoint() {
+        return completeCheckpoint(beginCheckpoint());
+    }
+
+    // Mutations
+    uint64_t logAddDevice(const Device& d) {
+        string out;
+        putString(out, d.deviceID);
+        putString(out, d.deviceName);
+        putFloat(out, d.consumptionRate);
+        putInt(out, d.isCritical ? 1 : 0);
+        putInt(out, d.priority);
+        putInt(out, d.isOn() ? 1 : 0);
+        putFloat(out, d.unitsUsed);
+        putInt(out, d.timestamp);
+        putInt(out, d.startTime);
+        return append(WAL_ADD_DEVICE, out);
+    }
+
+    // Full on/off state, so replaying it twice is harmless
+    uint64_t logDeviceState(const Device& d) {
+        string out;
+        putString(out, d.deviceID);
+        putInt(out, d.isOn() ? 1 : 0);
+        putFloat(out, d.unitsUsed);
+        putInt(out, d.timestamp);
+        putInt(out, d.startTime);
+        return append(WAL_DEVICE_STATE, out);
+    }
+
+    uint64_t logSchedule(const ScheduledTask& task) {
+        string out;
+        putTask(out, task);
+        return append(WAL_SCHEDULE, out);
+    }
+
+    // Task taken off the queue (executed)
+    uint64_t logUnschedule(const ScheduledTask& task) {
+        string out;
+        putTask(out, task);
+        return append(WAL_UNSCHEDULE, out);
+    }
+
+    uint64_t logHistory(const HistoryRecord& r) {
+        string out;
+        putString(out, r.deviceID);
+        putString(out, r.deviceName);
+        putFloat(out, r.consumptionRate);
+        putInt(out, r.timestamp);
+        putInt(out, r.duration);
+        putFloat(out, r.unitsConsumed);
+        return append(WAL_HISTORY, out);
+    }
+
+    bool isOpen() const { return fd >= 0; }
+    bool hadError() { lock_guard<mutex> guard(lock); return ioError; }
+    uint64_t lastLsn() { lock_guard<mutex> guard(lock); return nextLsn - 1; }
+    uint64_t lastDurableLsn() { lock_guard<mutex> guard(lock); return durableLsn; }
+
+    // Tests: makes the log write to `file` instead; returns the old descriptor
+    int swapDescriptor(int file) {
+        unique_lock<mutex> guard(lock);
+        flushed.wait(guard, [&] { return !flushing; });
+        int old = fd;
+        fd = file;
+        return old;
+    }
+    uint64_t lastCheckpointLsn() { lock_guard<mutex> guard(lock); return checkpointLsn; }
+    uint64_t sizeBytes() { lock_guard<mutex> guard(lock); return logBytes + pending.size(); }
+    long long appends() { lock_guard<mutex> guard(lock); return appendCount; }
+    long long flushes() { lock_guard<mutex> guard(lock); return flushCount; }
+};
+
+#endif // WRITE_AHEAD_LOG_H